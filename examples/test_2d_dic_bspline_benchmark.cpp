@@ -0,0 +1,79 @@
+/*
+ This example is a micro-benchmark of the preparation of bicubic B-spline
+ interpolation, which is repeated for every target image in DIC. A random
+ speckle image of 25 megapixels is generated, the look-up table of polynomial
+ coefficients is calculated repeatedly, and the throughput is reported in
+ megapixels per second for different numbers of CPU threads.
+*/
+
+#include <fstream>
+#include <random>
+
+#include "opencorr.h"
+
+using namespace opencorr;
+using namespace std;
+
+int main()
+{
+	//set the size of image and the number of repetitions
+	int width = 5000;
+	int height = 5000;
+	int repetition = 5;
+
+	//generate a speckle image with uniformly distributed grayscale
+	Image2D image(width, height);
+	mt19937 generator(0);
+	uniform_real_distribution<float> distribution(0.f, 255.f);
+	for (int r = 0; r < height; r++)
+	{
+		for (int c = 0; c < width; c++)
+		{
+			image.eg_mat(r, c) = distribution(generator);
+		}
+	}
+
+	//create an instance to write csv file
+	string file_path = "bspline_benchmark.csv"; //replace it with the path on your computer
+	string delimiter = ",";
+	ofstream csv_out;
+	csv_out.open(file_path);
+	if (csv_out.is_open())
+	{
+		csv_out << "Thread number" << delimiter << "Time per image (sec)" << delimiter << "Throughput (Mpixel/s)" << endl;
+	}
+
+	//the look-up table is reallocated in each preparation, as it is done for each target image
+	BicubicBspline* interp = new BicubicBspline(image);
+
+	int cpu_thread_number = omp_get_num_procs();
+	for (int thread_number = 1; thread_number <= cpu_thread_number; thread_number *= 2)
+	{
+		omp_set_num_threads(thread_number);
+
+		double timer_tic = omp_get_wtime();
+		for (int i = 0; i < repetition; i++)
+		{
+			interp->prepare();
+		}
+		double timer_toc = omp_get_wtime();
+
+		double consumed_time = (timer_toc - timer_tic) / repetition;
+		double throughput = (double)width * height / consumed_time / 1e6;
+
+		//display the results on screen and save them
+		cout << thread_number << " CPU threads: " << consumed_time << " sec per image, " << throughput << " Mpixel/s" << endl;
+		if (csv_out.is_open())
+		{
+			csv_out << thread_number << delimiter << consumed_time << delimiter << throughput << endl;
+		}
+	}
+	csv_out.close();
+
+	delete interp;
+
+	cout << "Press any key to exit..." << std::endl;
+	cin.get();
+
+	return 0;
+}
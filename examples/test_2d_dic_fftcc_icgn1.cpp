@@ -78,6 +78,7 @@ int main()
 	//FFTCC
 	FFTCC2D* fftcc = new FFTCC2D(subset_radius_x, subset_radius_y, cpu_thread_number);
 	fftcc->setImages(ref_img, tar_img);
+	fftcc->setBatchSize(64); //the POIs on the regular grid are transformed in batches of 64 subsets
 	fftcc->compute(poi_queue);
 
 	//get the time of end 
@@ -0,0 +1,121 @@
+/*
+ This example measures the effect of sub-pixel peak estimation in FFT-CC on the
+ convergence of ICGN (with the 1st order shape function). The images used in
+ test_2d_dic_fftcc_icgn1.cpp are processed with each method of peak fitting,
+ the mean number of ICGN iterations and its reduction against the integer peak
+ are reported, together with the mean peak sharpness given by FFT-CC.
+*/
+
+#include <fstream>
+
+#include "opencorr.h"
+
+using namespace opencorr;
+using namespace std;
+
+int main()
+{
+	//set files to process
+	string ref_image_path = "d:/dic_tests/2d_dic/oht_cfrp_0.bmp"; //replace it with the path on your computer
+	string tar_image_path = "d:/dic_tests/2d_dic/oht_cfrp_4.bmp"; //replace it with the path on your computer
+	Image2D ref_img(ref_image_path);
+	Image2D tar_img(tar_image_path);
+
+	//set OpenMP parameters
+	int cpu_thread_number = omp_get_num_procs() - 1;
+	omp_set_num_threads(cpu_thread_number);
+
+	//set DIC parameters
+	int subset_radius_x = 16;
+	int subset_radius_y = 16;
+	int max_iteration = 10;
+	float max_deformation_norm = 0.001f;
+
+	//set POIs
+	Point2D upper_left_point(30, 30);
+	vector<POI2D> initial_queue;
+	int poi_number_x = 28;
+	int poi_number_y = 105;
+	int grid_space = 8;
+
+	//store POIs in a queue
+	for (int i = 0; i < poi_number_y; i++)
+	{
+		for (int j = 0; j < poi_number_x; j++)
+		{
+			Point2D offset(j * grid_space, i * grid_space);
+			Point2D current_point = upper_left_point + offset;
+			POI2D current_poi(current_point);
+			initial_queue.push_back(current_poi);
+		}
+	}
+
+	//create the instances of FFTCC and ICGN, the interpolation of ICGN is prepared only once
+	FFTCC2D* fftcc = new FFTCC2D(subset_radius_x, subset_radius_y, cpu_thread_number);
+	fftcc->setImages(ref_img, tar_img);
+
+	ICGN2D1* icgn1 = new ICGN2D1(subset_radius_x, subset_radius_y, max_deformation_norm, max_iteration, cpu_thread_number);
+	icgn1->setImages(ref_img, tar_img);
+	icgn1->prepare();
+
+	//create an instance to write csv file
+	string file_path = tar_image_path.substr(0, tar_image_path.find_last_of(".")) + "_fftcc_peak_fit_r16.csv";
+	string delimiter = ",";
+	ofstream csv_out;
+	csv_out.open(file_path);
+	if (csv_out.is_open())
+	{
+		csv_out << "Peak fit" << delimiter << "Mean iteration" << delimiter << "Reduction (%)" << delimiter << "Mean sharpness" << endl;
+	}
+
+	vector<PeakFit> peak_fit = { PeakFit::none, PeakFit::parabolic, PeakFit::gaussian, PeakFit::quadratic };
+	vector<string> fit_name = { "none", "parabolic", "gaussian", "quadratic" };
+	float baseline_iteration = 0;
+	for (int i = 0; i < (int)peak_fit.size(); i++)
+	{
+		vector<POI2D> poi_queue = initial_queue;
+		fftcc->setPeakFit(peak_fit[i]);
+		fftcc->compute(poi_queue);
+
+		//the peak sharpness is stored in result.feature by FFTCC, it is kept by ICGN
+		icgn1->compute(poi_queue);
+
+		//average over the POIs converged in ICGN
+		double iteration_sum = 0;
+		double sharpness_sum = 0;
+		int valid_number = 0;
+		for (auto& poi : poi_queue)
+		{
+			if (poi.result.zncc >= 0)
+			{
+				iteration_sum += poi.result.iteration;
+				sharpness_sum += poi.result.feature;
+				valid_number++;
+			}
+		}
+		float mean_iteration = valid_number > 0 ? (float)(iteration_sum / valid_number) : 0;
+		float mean_sharpness = valid_number > 0 ? (float)(sharpness_sum / valid_number) : 0;
+		if (i == 0)
+		{
+			baseline_iteration = mean_iteration;
+		}
+		float reduction = baseline_iteration > 0 ? 100.f * (baseline_iteration - mean_iteration) / baseline_iteration : 0;
+
+		//display the results on screen and save them
+		cout << fit_name[i] << ": mean iteration " << mean_iteration << ", reduction " << reduction << "%, mean sharpness " << mean_sharpness << endl;
+		if (csv_out.is_open())
+		{
+			csv_out << fit_name[i] << delimiter << mean_iteration << delimiter << reduction << delimiter << mean_sharpness << endl;
+		}
+	}
+	csv_out.close();
+
+	//destroy the instances
+	delete fftcc;
+	delete icgn1;
+
+	cout << "Press any key to exit..." << std::endl;
+	cin.get();
+
+	return 0;
+}
@@ -0,0 +1,171 @@
+/*
+ This example is a micro-benchmark of the kernels of ICGN2D1, ICGN2D2 and
+ FFTCC2D specialized for the common subset radii (15, 16, 20 and 30). A pair of
+ speckle images with uniform translation is synthesized, a grid of POIs is
+ processed with the specialized kernels switched off and on, and the time per
+ POI, the speedup and the largest difference of displacement are reported.
+*/
+
+#include <cmath>
+#include <fstream>
+#include <random>
+
+#include "opencorr.h"
+
+using namespace opencorr;
+using namespace std;
+
+//time per POI (in microseconds) of an engine processing a copy of the POI queue
+template <typename Engine>
+double timeEngine(Engine* engine, vector<POI2D>& poi_queue, vector<POI2D>& result, bool initial_guess)
+{
+	result = poi_queue;
+	if (!initial_guess)
+	{
+		for (auto& poi : result)
+		{
+			poi.deformation.u = 0.f;
+			poi.deformation.v = 0.f;
+		}
+	}
+
+	double timer_tic = omp_get_wtime();
+	engine->compute(result);
+	double timer_toc = omp_get_wtime();
+
+	return (timer_toc - timer_tic) / result.size() * 1e6;
+}
+
+int main()
+{
+	//set the size of images, the translation and the number of CPU threads
+	int width = 1000;
+	int height = 1000;
+	float shift_u = 2.37f;
+	float shift_v = -1.58f;
+	int cpu_thread_number = omp_get_num_procs() - 1;
+	cpu_thread_number = cpu_thread_number > 0 ? cpu_thread_number : 1;
+	omp_set_num_threads(cpu_thread_number);
+
+	//synthesize the speckle images with Gaussian spots at random locations
+	Image2D ref_img(width, height);
+	Image2D tar_img(width, height);
+	int speckle_number = width * height / 20;
+	float speckle_radius = 2.f;
+	mt19937 generator(0);
+	uniform_real_distribution<float> distribution_x(0.f, (float)width);
+	uniform_real_distribution<float> distribution_y(0.f, (float)height);
+	ref_img.eg_mat.setZero();
+	tar_img.eg_mat.setZero();
+	for (int i = 0; i < speckle_number; i++)
+	{
+		float x = distribution_x(generator);
+		float y = distribution_y(generator);
+		for (int r = (int)y - 8; r <= (int)y + 8; r++)
+		{
+			for (int c = (int)x - 8; c <= (int)x + 8; c++)
+			{
+				if (r < 0 || c < 0 || r >= height || c >= width)
+				{
+					continue;
+				}
+				float ref_distance = (c - x) * (c - x) + (r - y) * (r - y);
+				float tar_distance = (c - x - shift_u) * (c - x - shift_u) + (r - y - shift_v) * (r - y - shift_v);
+				ref_img.eg_mat(r, c) += 100.f * exp(-ref_distance / (speckle_radius * speckle_radius));
+				tar_img.eg_mat(r, c) += 100.f * exp(-tar_distance / (speckle_radius * speckle_radius));
+			}
+		}
+	}
+
+	//create an instance to write csv file
+	string file_path = "icgn_kernel_benchmark.csv"; //replace it with the path on your computer
+	string delimiter = ",";
+	ofstream csv_out;
+	csv_out.open(file_path);
+	if (csv_out.is_open())
+	{
+		csv_out << "Engine" << delimiter << "Subset radius" << delimiter << "Generic (us per POI)" << delimiter
+			<< "Specialized (us per POI)" << delimiter << "Speedup" << delimiter << "Max difference (pixel)" << endl;
+	}
+
+	int radius_list[4] = { 15, 16, 20, 30 };
+	for (int i = 0; i < 4; i++)
+	{
+		int subset_radius = radius_list[i];
+
+		//set POIs on a regular grid, with the integral displacement as the initial guess of ICGN
+		vector<POI2D> poi_queue;
+		int margin = subset_radius + 10;
+		for (int y = margin; y < height - margin; y += 10)
+		{
+			for (int x = margin; x < width - margin; x += 10)
+			{
+				POI2D poi((float)x, (float)y);
+				poi.deformation.u = round(shift_u);
+				poi.deformation.v = round(shift_v);
+				poi_queue.push_back(poi);
+			}
+		}
+
+		for (int engine_index = 0; engine_index < 3; engine_index++)
+		{
+			double consumed_time[2];
+			vector<POI2D> result[2];
+			for (int specialized = 0; specialized < 2; specialized++)
+			{
+				if (engine_index == 0)
+				{
+					ICGN2D1* icgn1 = new ICGN2D1(subset_radius, subset_radius, 0.001f, 10, cpu_thread_number);
+					icgn1->setSpecializedKernel(specialized == 1);
+					icgn1->setImages(ref_img, tar_img);
+					icgn1->prepare();
+					consumed_time[specialized] = timeEngine(icgn1, poi_queue, result[specialized], true);
+					delete icgn1;
+				}
+				else if (engine_index == 1)
+				{
+					ICGN2D2* icgn2 = new ICGN2D2(subset_radius, subset_radius, 0.001f, 10, cpu_thread_number);
+					icgn2->setSpecializedKernel(specialized == 1);
+					icgn2->setImages(ref_img, tar_img);
+					icgn2->prepare();
+					consumed_time[specialized] = timeEngine(icgn2, poi_queue, result[specialized], true);
+					delete icgn2;
+				}
+				else
+				{
+					FFTCC2D* fftcc = new FFTCC2D(subset_radius, subset_radius, cpu_thread_number);
+					fftcc->setSpecializedKernel(specialized == 1);
+					fftcc->setImages(ref_img, tar_img);
+					consumed_time[specialized] = timeEngine(fftcc, poi_queue, result[specialized], false);
+					delete fftcc;
+				}
+			}
+
+			//the largest difference of displacement between the two runs
+			float max_difference = 0.f;
+			for (int j = 0; j < (int)poi_queue.size(); j++)
+			{
+				max_difference = max(max_difference, abs(result[0][j].deformation.u - result[1][j].deformation.u));
+				max_difference = max(max_difference, abs(result[0][j].deformation.v - result[1][j].deformation.v));
+			}
+
+			string engine_name = engine_index == 0 ? "ICGN2D1" : (engine_index == 1 ? "ICGN2D2" : "FFTCC2D");
+			double speedup = consumed_time[0] / consumed_time[1];
+
+			//display the results on screen and save them
+			cout << engine_name << ", subset radius " << subset_radius << ": " << consumed_time[0] << " us per POI (generic), "
+				<< consumed_time[1] << " us per POI (specialized), speedup " << speedup << endl;
+			if (csv_out.is_open())
+			{
+				csv_out << engine_name << delimiter << subset_radius << delimiter << consumed_time[0] << delimiter
+					<< consumed_time[1] << delimiter << speedup << delimiter << max_difference << endl;
+			}
+		}
+	}
+	csv_out.close();
+
+	cout << "Press any key to exit..." << std::endl;
+	cin.get();
+
+	return 0;
+}
@@ -0,0 +1,120 @@
+/*
+ This example demonstrates how to use OpenCorr to process a sequence of images.
+ The loading of images, the preparation of interpolation coefficients and the
+ matching using IC-GN algorithm (with the 1st order shape function) are
+ overlapped. FFT-CC algorithm is only used at the first target frame, the
+ results of each frame are used as the initial guess of the next frame.
+*/
+
+#include <fstream>
+
+#include "opencorr.h"
+
+using namespace opencorr;
+using namespace std;
+
+int main()
+{
+	//set files to process, the first one is the reference image
+	vector<string> frame_path;
+	frame_path.push_back("d:/dic_tests/2d_dic/utn_00.bmp"); //replace it with the path on your computer
+	frame_path.push_back("d:/dic_tests/2d_dic/utn_30.bmp");
+	frame_path.push_back("d:/dic_tests/2d_dic/utn_35.bmp");
+	frame_path.push_back("d:/dic_tests/2d_dic/utn_40.bmp");
+	frame_path.push_back("d:/dic_tests/2d_dic/utn_45.bmp");
+
+	//initialize papameters for timing
+	double timer_tic, timer_toc, consumed_time;
+	vector<double> computation_time;
+
+	//get the time of start
+	timer_tic = omp_get_wtime();
+
+	//create instances to write csv files
+	string file_path;
+	string delimiter = ",";
+	ofstream csv_out; //instance for output calculation time
+
+	//set OpenMP parameters
+	int cpu_thread_number = omp_get_num_procs() - 1;
+	omp_set_num_threads(cpu_thread_number);
+
+	//set DIC parameters
+	int subset_radius_x = 16;
+	int subset_radius_y = 16;
+	int max_iteration = 10;
+	float max_deformation_norm = 0.001f;
+
+	//set POIs
+	Point2D upper_left_point(30, 30);
+	vector<POI2D> poi_queue;
+	int poi_number_x = 40;
+	int poi_number_y = 40;
+	int grid_space = 10;
+
+	//store POIs in a queue
+	for (int i = 0; i < poi_number_y; i++)
+	{
+		for (int j = 0; j < poi_number_x; j++)
+		{
+			Point2D offset(j * grid_space, i * grid_space);
+			Point2D current_point = upper_left_point + offset;
+			POI2D current_poi(current_point);
+			poi_queue.push_back(current_poi);
+		}
+	}
+
+	//get the time of end
+	timer_toc = omp_get_wtime();
+	consumed_time = timer_toc - timer_tic;
+	computation_time.push_back(consumed_time); //0
+
+	//display the time of initialization on screen
+	cout << "Initialization with " << poi_queue.size() << " POIs takes " << consumed_time << " sec, " << cpu_thread_number << " CPU threads launched." << std::endl;
+
+	//get the time of start
+	timer_tic = omp_get_wtime();
+
+	//FFTCC for the first target frame and ICGN with the 1st order shape function for all frames
+	FFTCC2D* fftcc = new FFTCC2D(subset_radius_x, subset_radius_y, cpu_thread_number);
+	ICGN2D1* icgn1 = new ICGN2D1(subset_radius_x, subset_radius_y, max_deformation_norm, max_iteration, cpu_thread_number);
+
+	//all the frames are matched with the same reference image, its data are cached in ICGN (256 MB at most)
+	icgn1->setReferenceCache((size_t)256 * 1024 * 1024);
+
+	//process the sequence, the results of each frame are saved in a csv file
+	SequenceDIC* sequence = new SequenceDIC(icgn1, cpu_thread_number);
+	sequence->setSeedEngine(fftcc);
+	sequence->setFrames(frame_path);
+	sequence->setReferenceUpdate(ReferenceUpdate::accumulative);
+	sequence->setOutputPath(frame_path[0].substr(0, frame_path[0].find_last_of(".")) + "_sequence_icgn1_r16");
+	sequence->compute(poi_queue);
+
+	//get the time of end
+	timer_toc = omp_get_wtime();
+	consumed_time = timer_toc - timer_tic;
+	computation_time.push_back(consumed_time); //1
+
+	//display the time of processing on screen
+	cout << "Processing of " << frame_path.size() - 1 << " frames takes " << consumed_time << " sec." << std::endl;
+
+	//save the computation time
+	file_path = frame_path[0].substr(0, frame_path[0].find_last_of(".")) + "_sequence_icgn1_r16_time.csv";
+	csv_out.open(file_path);
+	if (csv_out.is_open())
+	{
+		csv_out << "POI number" << delimiter << "Frame number" << delimiter << "Initialization" << delimiter << "Sequence" << endl;
+		csv_out << poi_queue.size() << delimiter << frame_path.size() - 1 << delimiter << computation_time[0] << delimiter << computation_time[1] << endl;
+	}
+	csv_out.close();
+
+	//destroy the instances
+	delete sequence;
+	delete fftcc;
+	delete icgn1;
+
+	cout << "Press any key to exit..." << std::endl;
+	cin.get();
+
+	return 0;
+}
@@ -42,6 +42,19 @@ namespace opencorr
 		hDestroyPtr(ptr);
 	}
 
+	float*** attach3D(float* data, int dimension1, int dimension2, int dimension3)
+	{
+		float*** ptr = nullptr;
+		hAttachPtr(ptr, data, dimension1, dimension2, dimension3);
+		return ptr;
+	}
+
+	void detach3D(float***& ptr)
+	{
+		if (ptr == nullptr) return;
+		hDetachPtr(ptr);
+	}
+
 	float**** new4D(int dimension1, int dimension2, int dimension3, int dimension4)
 	{
 		float**** ptr = nullptr;
@@ -24,6 +24,14 @@ typedef Eigen::Matrix<float, 12, 12> Matrix12f;
 typedef Eigen::Matrix<float, 6, 1> Vector6f;
 typedef Eigen::Matrix<float, 4, 1> Vector4f;
 
+//row-major matrix for images, gradient maps and subsets, consistent with the scan order (r outer, c inner) in 2D processing
+typedef Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> RowMatrixXf;
+typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> RowMatrixXd;
+
+//parameter-major steepest descent images, one row per parameter
+typedef Eigen::Matrix<float, 6, Eigen::Dynamic, Eigen::RowMajor> RowMatrix6Xf;
+typedef Eigen::Matrix<float, 12, Eigen::Dynamic, Eigen::RowMajor> RowMatrix12Xf;
+
 namespace opencorr
 {
 	//new and delete 2d array
@@ -34,10 +42,53 @@ namespace opencorr
 	float*** new3D(int dimension1, int dimension2, int dimension3); //array[dimension1][dimension2][dimension3]
 	void delete3D(float***& ptr);
 
+	//create and delete the pointers of 3d array over continuous data owned by others, e.g. a memory-mapped file
+	float*** attach3D(float* data, int dimension1, int dimension2, int dimension3);
+	void detach3D(float***& ptr); //the data are not released
+
 	//new and delete 4d array
 	float**** new4D(int dimension1, int dimension2, int dimension3, int dimension4); //array[dimension1][dimension2][dimension3][dimension4]
 	void delete4D(float****& ptr);
 
+	//view of a volume stored continuously in the order of z, y, x, e.g. the data of an array created by new3D().
+	//a voxel is located by index arithmetic instead of chasing the pointers of slice and row, and the strides
+	//allow a sub-volume to be viewed without copying
+	struct VolumeView
+	{
+		float* data = nullptr; //voxel (0, 0, 0) of the view
+		int dim_x = 0, dim_y = 0, dim_z = 0;
+		long long stride_y = 0, stride_z = 0; //distance between neighboring rows and slices, in voxels
+
+		VolumeView() = default;
+		VolumeView(float* data, int dim_x, int dim_y, int dim_z)
+			: data(data), dim_x(dim_x), dim_y(dim_y), dim_z(dim_z), stride_y(dim_x), stride_z((long long)dim_x * dim_y) {}
+		VolumeView(float* data, int dim_x, int dim_y, int dim_z, long long stride_y, long long stride_z)
+			: data(data), dim_x(dim_x), dim_y(dim_y), dim_z(dim_z), stride_y(stride_y), stride_z(stride_z) {}
+
+		inline float& operator()(int z, int y, int x) const
+		{
+			return data[z * stride_z + y * stride_y + x];
+		}
+
+		//pointer to the first voxel of row (z, y), the voxels in a row are always continuous
+		inline float* row(int z, int y) const
+		{
+			return data + z * stride_z + y * stride_y;
+		}
+
+		//view of the sub-volume starting at voxel (x, y, z)
+		VolumeView subVolume(int x, int y, int z, int sub_dim_x, int sub_dim_y, int sub_dim_z) const
+		{
+			return VolumeView(row(z, y) + x, sub_dim_x, sub_dim_y, sub_dim_z, stride_y, stride_z);
+		}
+
+		//check if the view covers a continuous block of memory
+		bool isContinuous() const
+		{
+			return stride_y == dim_x && stride_z == (long long)dim_x * dim_y;
+		}
+	};
+
 	//allocate memory for 2d, 3d, and 4d arrays
 	template <class Real>
 	void hCreatePtr(Real*& ptr, int dimension1)
@@ -57,23 +108,31 @@ namespace opencorr
 		}
 	}
 
+	//create the pointers of slices and rows over continuous data
 	template <class Real>
-	void hCreatePtr(Real***& ptr, int dimension1, int dimension2, int dimension3)
+	void hAttachPtr(Real***& ptr, Real* ptr1d, int dimension1, int dimension2, int dimension3)
 	{
-		Real* ptr1d = (Real*)calloc(dimension1 * dimension2 * dimension3, sizeof(Real));
-		Real** ptr2d = (Real**)malloc(dimension1 * dimension2 * sizeof(Real*));
+		Real** ptr2d = (Real**)malloc((size_t)dimension1 * dimension2 * sizeof(Real*));
 		ptr = (Real***)malloc(dimension1 * sizeof(Real**));
 
 		for (int i = 0; i < dimension1; i++)
 		{
 			for (int j = 0; j < dimension2; j++)
 			{
-				ptr2d[i * dimension2 + j] = ptr1d + (i * dimension2 + j) * dimension3;
+				ptr2d[(size_t)i * dimension2 + j] = ptr1d + ((size_t)i * dimension2 + j) * dimension3;
 			}
-			ptr[i] = ptr2d + i * dimension2;
+			ptr[i] = ptr2d + (size_t)i * dimension2;
 		}
 	}
 
+	template <class Real>
+	void hCreatePtr(Real***& ptr, int dimension1, int dimension2, int dimension3)
+	{
+		//the size of a large volume may exceed the range of int
+		Real* ptr1d = (Real*)calloc((size_t)dimension1 * dimension2 * dimension3, sizeof(Real));
+		hAttachPtr(ptr, ptr1d, dimension1, dimension2, dimension3);
+	}
+
 	template <class Real>
 	void hCreatePtr(Real****& ptr, int dimension1, int dimension2, int dimension3, int dimension4)
 	{
@@ -113,14 +172,20 @@ namespace opencorr
 	}
 
 	template<class Real>
-	void hDestroyPtr(Real***& ptr)
+	void hDetachPtr(Real***& ptr)
 	{
-		free(ptr[0][0]);
 		free(ptr[0]);
 		free(ptr);
 		ptr = nullptr;
 	}
 
+	template<class Real>
+	void hDestroyPtr(Real***& ptr)
+	{
+		free(ptr[0][0]);
+		hDetachPtr(ptr);
+	}
+
 	template <class Real>
 	void hDestroyPtr(Real****& ptr)
 	{
@@ -12,6 +12,8 @@
  * More information about OpenCorr can be found at https://www.opencorr.org/
  */
 
+#include <vector>
+
 #include "oc_cubic_bspline.h"
 
 namespace opencorr
@@ -22,6 +24,15 @@ namespace opencorr
 		interp_img = &image;
 		width = image.width;
 		height = image.height;
+		compact_storage = false;
+	}
+
+	BicubicBspline::BicubicBspline(Image2D& image, bool compact_storage) :interp_coefficient(nullptr)
+	{
+		interp_img = &image;
+		width = image.width;
+		height = image.height;
+		this->compact_storage = compact_storage;
 	}
 
 	BicubicBspline::~BicubicBspline()
@@ -43,59 +54,59 @@ namespace opencorr
 		{
 			std::cerr << "Too small image:" << width << ", " << height << std::endl;
 		}
+
+		//keep a copy of the image, as it may be released before the interpolation
+		if (compact_storage)
+		{
+			coefficient_map = interp_img->eg_mat;
+			return;
+		}
 		interp_coefficient = new4D(height, width, 4, 4);
 
-#pragma omp parallel for
-		for (int r = 1; r < height - 2; r++)
+		//the polynomial coefficients of a pixel are Q * G * Q^T, where G is the 4x4 neighborhood and Q is the product of
+		//FUNCTION_MATRIX and CONTROL_MATRIX with its rows reversed, thus the look-up table is generated by separable
+		//filtering along x-axis and then y-axis
+		float filter[16];
+		for (int i = 0; i < 4; i++)
 		{
-			for (int c = 1; c < width - 2; c++)
+			for (int j = 0; j < 4; j++)
 			{
-				float matrix_g[4][4] = { 0.f };
-				float matrix_b[4][4] = { 0.f };
-				for (int i = 0; i < 4; i++)
-				{
-					for (int j = 0; j < 4; j++) {
-						matrix_g[i][j] = interp_img->eg_mat(r - 1 + i, c - 1 + j);
-					}
-				}
-
+				double sum = 0;
 				for (int k = 0; k < 4; k++)
 				{
-					for (int l = 0; l < 4; l++)
-					{
-						for (int m = 0; m < 4; m++)
-						{
-							for (int n = 0; n < 4; n++)
-							{
-								matrix_b[k][l] += CONTROL_MATRIX[k][m] * CONTROL_MATRIX[l][n] * matrix_g[n][m];
-							}
-						}
-					}
+					sum += (double)FUNCTION_MATRIX[3 - i][k] * CONTROL_MATRIX[k][j];
 				}
+				filter[4 * i + j] = (float)sum;
+			}
+		}
 
-				for (int k = 0; k < 4; k++)
+		//the rows are processed in blocks, the four rows filtered along x-axis are kept in a ring buffer
+		const int block_height = 32;
+		int block_number = (height - 3 + block_height - 1) / block_height;
+
+#pragma omp parallel
+		{
+			std::vector<float> filtered_buffer(16 * width);
+			const float* filtered_row[4];
+
+#pragma omp for
+			for (int i = 0; i < block_number; i++)
+			{
+				int row_begin = 1 + i * block_height;
+				int row_end = getLow(row_begin + block_height, height - 2);
+				for (int r = row_begin; r < row_end; r++)
 				{
-					for (int l = 0; l < 4; l++)
+					//rows r - 1 to r + 2 are needed, only row r + 2 is new except for the first row of block
+					for (int j = (r == row_begin ? -1 : 2); j <= 2; j++)
 					{
-						interp_coefficient[r][c][k][l] = 0;
-						for (int m = 0; m < 4; m++)
-						{
-							for (int n = 0; n < 4; n++)
-							{
-								interp_coefficient[r][c][k][l] += FUNCTION_MATRIX[k][m] * FUNCTION_MATRIX[l][n] * matrix_b[n][m];
-							}
-						}
+						filterBicubicRow(filter, &interp_img->eg_mat(r + j, 0), width, filtered_buffer.data() + ((r + j) & 3) * 4 * width);
 					}
-				}
-
-				for (int k = 0; k < 2; k++)
-				{
-					for (int l = 0; l < 4; l++)
+					for (int j = 0; j < 4; j++)
 					{
-						float buffer = interp_coefficient[r][c][k][l];
-						interp_coefficient[r][c][k][l] = interp_coefficient[r][c][3 - k][3 - l];
-						interp_coefficient[r][c][3 - k][3 - l] = buffer;
+						filtered_row[j] = filtered_buffer.data() + ((r - 1 + j) & 3) * 4 * width;
 					}
+
+					combineBicubicRows(filter, filtered_row, width, interp_coefficient[r][0][0]);
 				}
 			}
 		}
@@ -110,6 +121,11 @@ namespace opencorr
 			return -1.f;
 		}
 
+		if (compact_storage)
+		{
+			return computeCompact(location);
+		}
+
 		int y_integral = (int)floor(location.y);
 		int x_integral = (int)floor(location.x);
 
@@ -148,6 +164,171 @@ namespace opencorr
 		return value;
 	}
 
+	void BicubicBspline::computeBatch(const float* x, const float* y, float* value, int n)
+	{
+		if (compact_storage)
+		{
+			Interpolation2D::computeBatch(x, y, value, n);
+		}
+		else
+		{
+			interpolateBicubic(interp_coefficient[0][0][0], width, height, x, y, value, n);
+		}
+	}
+
+	const float* BicubicBspline::getCoefficientTable() const
+	{
+		if (compact_storage || interp_coefficient == nullptr)
+		{
+			return nullptr;
+		}
+
+		return interp_coefficient[0][0][0];
+	}
+
+	float BicubicBspline::computeCompact(Point2D& location)
+	{
+		int y_integral = (int)floor(location.y);
+		int x_integral = (int)floor(location.x);
+
+		//the look-up table leaves the coefficients of border pixels zero
+		if (y_integral < 1 || x_integral < 1 || y_integral >= height - 2 || x_integral >= width - 2)
+		{
+			return 0.f;
+		}
+
+		float x_decimal = location.x - x_integral;
+		float y_decimal = location.y - y_integral;
+
+		float basis_x[4], basis_y[4];
+		basis_x[0] = basis0(x_decimal);
+		basis_x[1] = basis1(x_decimal);
+		basis_x[2] = basis2(x_decimal);
+		basis_x[3] = basis3(x_decimal);
+
+		basis_y[0] = basis0(y_decimal);
+		basis_y[1] = basis1(y_decimal);
+		basis_y[2] = basis2(y_decimal);
+		basis_y[3] = basis3(y_decimal);
+
+		//fold the local prefilter into the weights of 4x4 neighborhood
+		float weight_x[4], weight_y[4];
+		for (int i = 0; i < 4; i++)
+		{
+			weight_x[i] = CONTROL_MATRIX[0][i] * basis_x[0] + CONTROL_MATRIX[1][i] * basis_x[1]
+				+ CONTROL_MATRIX[2][i] * basis_x[2] + CONTROL_MATRIX[3][i] * basis_x[3];
+			weight_y[i] = CONTROL_MATRIX[0][i] * basis_y[0] + CONTROL_MATRIX[1][i] * basis_y[1]
+				+ CONTROL_MATRIX[2][i] * basis_y[2] + CONTROL_MATRIX[3][i] * basis_y[3];
+		}
+
+		float value = 0.f;
+		for (int i = 0; i < 4; i++)
+		{
+			int r = y_integral - 1 + i;
+			float sum_x = weight_x[0] * coefficient_map(r, x_integral - 1)
+				+ weight_x[1] * coefficient_map(r, x_integral)
+				+ weight_x[2] * coefficient_map(r, x_integral + 1)
+				+ weight_x[3] * coefficient_map(r, x_integral + 2);
+			value += weight_y[i] * sum_x;
+		}
+
+		return value;
+	}
+
+	void BicubicBspline::computeBatchGradient(const float* x, const float* y, float* value, float* gradient_x, float* gradient_y, int n)
+	{
+		if (compact_storage)
+		{
+			Point2D location;
+			for (int i = 0; i < n; i++)
+			{
+				location.x = x[i];
+				location.y = y[i];
+				if (location.x < 0 || location.y < 0 || location.x >= width || location.y >= height
+					|| std::isnan(location.x) || std::isnan(location.y))
+				{
+					value[i] = -1.f;
+					gradient_x[i] = 0.f;
+					gradient_y[i] = 0.f;
+				}
+				else
+				{
+					computeCompactGradient(location, value[i], gradient_x[i], gradient_y[i]);
+				}
+			}
+		}
+		else
+		{
+			interpolateBicubicGradient(interp_coefficient[0][0][0], width, height, x, y, value, gradient_x, gradient_y, n);
+		}
+	}
+
+	void BicubicBspline::computeCompactGradient(Point2D& location, float& value, float& gradient_x, float& gradient_y)
+	{
+		int y_integral = (int)floor(location.y);
+		int x_integral = (int)floor(location.x);
+
+		if (y_integral < 1 || x_integral < 1 || y_integral >= height - 2 || x_integral >= width - 2)
+		{
+			value = 0.f;
+			gradient_x = 0.f;
+			gradient_y = 0.f;
+			return;
+		}
+
+		float x_decimal = location.x - x_integral;
+		float y_decimal = location.y - y_integral;
+
+		//values and derivatives of the four basis functions
+		float basis_x[4], basis_y[4], derivative_x[4], derivative_y[4];
+		basis_x[0] = basis0(x_decimal);
+		basis_x[1] = basis1(x_decimal);
+		basis_x[2] = basis2(x_decimal);
+		basis_x[3] = basis3(x_decimal);
+		derivative_x[0] = -0.5f * (1.f - x_decimal) * (1.f - x_decimal);
+		derivative_x[1] = x_decimal * (1.5f * x_decimal - 2.f);
+		derivative_x[2] = x_decimal * (-1.5f * x_decimal + 1.f) + 0.5f;
+		derivative_x[3] = 0.5f * x_decimal * x_decimal;
+
+		basis_y[0] = basis0(y_decimal);
+		basis_y[1] = basis1(y_decimal);
+		basis_y[2] = basis2(y_decimal);
+		basis_y[3] = basis3(y_decimal);
+		derivative_y[0] = -0.5f * (1.f - y_decimal) * (1.f - y_decimal);
+		derivative_y[1] = y_decimal * (1.5f * y_decimal - 2.f);
+		derivative_y[2] = y_decimal * (-1.5f * y_decimal + 1.f) + 0.5f;
+		derivative_y[3] = 0.5f * y_decimal * y_decimal;
+
+		//fold the local prefilter into the weights of 4x4 neighborhood
+		float weight_x[4], weight_y[4], weight_dx[4], weight_dy[4];
+		for (int i = 0; i < 4; i++)
+		{
+			weight_x[i] = CONTROL_MATRIX[0][i] * basis_x[0] + CONTROL_MATRIX[1][i] * basis_x[1]
+				+ CONTROL_MATRIX[2][i] * basis_x[2] + CONTROL_MATRIX[3][i] * basis_x[3];
+			weight_y[i] = CONTROL_MATRIX[0][i] * basis_y[0] + CONTROL_MATRIX[1][i] * basis_y[1]
+				+ CONTROL_MATRIX[2][i] * basis_y[2] + CONTROL_MATRIX[3][i] * basis_y[3];
+			weight_dx[i] = CONTROL_MATRIX[0][i] * derivative_x[0] + CONTROL_MATRIX[1][i] * derivative_x[1]
+				+ CONTROL_MATRIX[2][i] * derivative_x[2] + CONTROL_MATRIX[3][i] * derivative_x[3];
+			weight_dy[i] = CONTROL_MATRIX[0][i] * derivative_y[0] + CONTROL_MATRIX[1][i] * derivative_y[1]
+				+ CONTROL_MATRIX[2][i] * derivative_y[2] + CONTROL_MATRIX[3][i] * derivative_y[3];
+		}
+
+		value = 0.f;
+		gradient_x = 0.f;
+		gradient_y = 0.f;
+		for (int i = 0; i < 4; i++)
+		{
+			const float* coefficient_row = &coefficient_map(y_integral - 1 + i, x_integral - 1);
+			float sum_x = weight_x[0] * coefficient_row[0] + weight_x[1] * coefficient_row[1]
+				+ weight_x[2] * coefficient_row[2] + weight_x[3] * coefficient_row[3];
+			float sum_dx = weight_dx[0] * coefficient_row[0] + weight_dx[1] * coefficient_row[1]
+				+ weight_dx[2] * coefficient_row[2] + weight_dx[3] * coefficient_row[3];
+			value += weight_y[i] * sum_x;
+			gradient_x += weight_y[i] * sum_dx;
+			gradient_y += weight_dy[i] * sum_x;
+		}
+	}
+
 
 	//tricubic B-spline interpolation
 	TricubicBspline::TricubicBspline(Image3D& image) :interp_coefficient(nullptr)
@@ -179,6 +360,9 @@ namespace opencorr
 		}
 		interp_coefficient = new3D(dim_z, dim_y, dim_x);
 		float*** conv_buffer = new3D(dim_z, dim_y, dim_x);
+		VolumeView img_view = interp_img->getView();
+		VolumeView coefficient_view(interp_coefficient[0][0], dim_x, dim_y, dim_z);
+		VolumeView buffer_view(conv_buffer[0][0], dim_x, dim_y, dim_z);
 
 		//convolution along x-axis
 #pragma omp parallel for
@@ -186,128 +370,91 @@ namespace opencorr
 		{
 			for (int j = 0; j < dim_y; j++)
 			{
+				const float* img_row = img_view.row(i, j);
+				float* coefficient_row = coefficient_view.row(i, j);
 				for (int k = 7; k < dim_x - 7; k++)
 				{
-					interp_coefficient[i][j][k] = BSPLINE_PREFILTER[0] * interp_img->vol_mat[i][j][k] +
-						BSPLINE_PREFILTER[1] * (interp_img->vol_mat[i][j][k - 1] + interp_img->vol_mat[i][j][k + 1]) +
-						BSPLINE_PREFILTER[2] * (interp_img->vol_mat[i][j][k - 2] + interp_img->vol_mat[i][j][k + 2]) +
-						BSPLINE_PREFILTER[3] * (interp_img->vol_mat[i][j][k - 3] + interp_img->vol_mat[i][j][k + 3]) +
-						BSPLINE_PREFILTER[4] * (interp_img->vol_mat[i][j][k - 4] + interp_img->vol_mat[i][j][k + 4]) +
-						BSPLINE_PREFILTER[5] * (interp_img->vol_mat[i][j][k - 5] + interp_img->vol_mat[i][j][k + 5]) +
-						BSPLINE_PREFILTER[6] * (interp_img->vol_mat[i][j][k - 6] + interp_img->vol_mat[i][j][k + 6]) +
-						BSPLINE_PREFILTER[7] * (interp_img->vol_mat[i][j][k - 7] + interp_img->vol_mat[i][j][k + 7]);
+					coefficient_row[k] = BSPLINE_PREFILTER[0] * img_row[k] +
+						BSPLINE_PREFILTER[1] * (img_row[k - 1] + img_row[k + 1]) +
+						BSPLINE_PREFILTER[2] * (img_row[k - 2] + img_row[k + 2]) +
+						BSPLINE_PREFILTER[3] * (img_row[k - 3] + img_row[k + 3]) +
+						BSPLINE_PREFILTER[4] * (img_row[k - 4] + img_row[k + 4]) +
+						BSPLINE_PREFILTER[5] * (img_row[k - 5] + img_row[k + 5]) +
+						BSPLINE_PREFILTER[6] * (img_row[k - 6] + img_row[k + 6]) +
+						BSPLINE_PREFILTER[7] * (img_row[k - 7] + img_row[k + 7]);
 				}
 				for (int k = 0; k < 7; k++)
 				{
-					interp_coefficient[i][j][k] = BSPLINE_PREFILTER[0] * interp_img->vol_mat[i][j][k] +
-						BSPLINE_PREFILTER[1] * (interp_img->vol_mat[i][j][getHigh(k - 1, 0)] + interp_img->vol_mat[i][j][k + 1]) +
-						BSPLINE_PREFILTER[2] * (interp_img->vol_mat[i][j][getHigh(k - 2, 0)] + interp_img->vol_mat[i][j][k + 2]) +
-						BSPLINE_PREFILTER[3] * (interp_img->vol_mat[i][j][getHigh(k - 3, 0)] + interp_img->vol_mat[i][j][k + 3]) +
-						BSPLINE_PREFILTER[4] * (interp_img->vol_mat[i][j][getHigh(k - 4, 0)] + interp_img->vol_mat[i][j][k + 4]) +
-						BSPLINE_PREFILTER[5] * (interp_img->vol_mat[i][j][getHigh(k - 5, 0)] + interp_img->vol_mat[i][j][k + 5]) +
-						BSPLINE_PREFILTER[6] * (interp_img->vol_mat[i][j][getHigh(k - 6, 0)] + interp_img->vol_mat[i][j][k + 6]) +
-						BSPLINE_PREFILTER[7] * (interp_img->vol_mat[i][j][getHigh(k - 7, 0)] + interp_img->vol_mat[i][j][k + 7]);
+					coefficient_row[k] = BSPLINE_PREFILTER[0] * img_row[k] +
+						BSPLINE_PREFILTER[1] * (img_row[getHigh(k - 1, 0)] + img_row[k + 1]) +
+						BSPLINE_PREFILTER[2] * (img_row[getHigh(k - 2, 0)] + img_row[k + 2]) +
+						BSPLINE_PREFILTER[3] * (img_row[getHigh(k - 3, 0)] + img_row[k + 3]) +
+						BSPLINE_PREFILTER[4] * (img_row[getHigh(k - 4, 0)] + img_row[k + 4]) +
+						BSPLINE_PREFILTER[5] * (img_row[getHigh(k - 5, 0)] + img_row[k + 5]) +
+						BSPLINE_PREFILTER[6] * (img_row[getHigh(k - 6, 0)] + img_row[k + 6]) +
+						BSPLINE_PREFILTER[7] * (img_row[getHigh(k - 7, 0)] + img_row[k + 7]);
 				}
 				for (int k = dim_x - 7; k < dim_x; k++)
 				{
-					interp_coefficient[i][j][k] = BSPLINE_PREFILTER[0] * interp_img->vol_mat[i][j][k] +
-						BSPLINE_PREFILTER[1] * (interp_img->vol_mat[i][j][k - 1] + interp_img->vol_mat[i][j][getLow(k + 1, dim_x - 1)]) +
-						BSPLINE_PREFILTER[2] * (interp_img->vol_mat[i][j][k - 2] + interp_img->vol_mat[i][j][getLow(k + 2, dim_x - 1)]) +
-						BSPLINE_PREFILTER[3] * (interp_img->vol_mat[i][j][k - 3] + interp_img->vol_mat[i][j][getLow(k + 3, dim_x - 1)]) +
-						BSPLINE_PREFILTER[4] * (interp_img->vol_mat[i][j][k - 4] + interp_img->vol_mat[i][j][getLow(k + 4, dim_x - 1)]) +
-						BSPLINE_PREFILTER[5] * (interp_img->vol_mat[i][j][k - 5] + interp_img->vol_mat[i][j][getLow(k + 5, dim_x - 1)]) +
-						BSPLINE_PREFILTER[6] * (interp_img->vol_mat[i][j][k - 6] + interp_img->vol_mat[i][j][getLow(k + 6, dim_x - 1)]) +
-						BSPLINE_PREFILTER[7] * (interp_img->vol_mat[i][j][k - 7] + interp_img->vol_mat[i][j][getLow(k + 7, dim_x - 1)]);
+					coefficient_row[k] = BSPLINE_PREFILTER[0] * img_row[k] +
+						BSPLINE_PREFILTER[1] * (img_row[k - 1] + img_row[getLow(k + 1, dim_x - 1)]) +
+						BSPLINE_PREFILTER[2] * (img_row[k - 2] + img_row[getLow(k + 2, dim_x - 1)]) +
+						BSPLINE_PREFILTER[3] * (img_row[k - 3] + img_row[getLow(k + 3, dim_x - 1)]) +
+						BSPLINE_PREFILTER[4] * (img_row[k - 4] + img_row[getLow(k + 4, dim_x - 1)]) +
+						BSPLINE_PREFILTER[5] * (img_row[k - 5] + img_row[getLow(k + 5, dim_x - 1)]) +
+						BSPLINE_PREFILTER[6] * (img_row[k - 6] + img_row[getLow(k + 6, dim_x - 1)]) +
+						BSPLINE_PREFILTER[7] * (img_row[k - 7] + img_row[getLow(k + 7, dim_x - 1)]);
 				}
 			}
 		}
 
-		//convolution along y-axis
+		//convolution along y-axis, the neighboring rows in a slice are processed as a whole
 #pragma omp parallel for
-		for (int k = 0; k < dim_x; k++)
+		for (int i = 0; i < dim_z; i++)
 		{
-			for (int i = 0; i < dim_z; i++)
+			const float* neighbor_row[15];
+			for (int j = 0; j < dim_y; j++)
 			{
-				for (int j = 7; j < dim_y - 7; j++)
+				for (int m = 0; m < 15; m++)
 				{
-					conv_buffer[i][j][k] = BSPLINE_PREFILTER[0] * interp_coefficient[i][j][k] +
-						BSPLINE_PREFILTER[1] * (interp_coefficient[i][j - 1][k] + interp_coefficient[i][j + 1][k]) +
-						BSPLINE_PREFILTER[2] * (interp_coefficient[i][j - 2][k] + interp_coefficient[i][j + 2][k]) +
-						BSPLINE_PREFILTER[3] * (interp_coefficient[i][j - 3][k] + interp_coefficient[i][j + 3][k]) +
-						BSPLINE_PREFILTER[4] * (interp_coefficient[i][j - 4][k] + interp_coefficient[i][j + 4][k]) +
-						BSPLINE_PREFILTER[5] * (interp_coefficient[i][j - 5][k] + interp_coefficient[i][j + 5][k]) +
-						BSPLINE_PREFILTER[6] * (interp_coefficient[i][j - 6][k] + interp_coefficient[i][j + 6][k]) +
-						BSPLINE_PREFILTER[7] * (interp_coefficient[i][j - 7][k] + interp_coefficient[i][j + 7][k]);
-				}
-				for (int j = 0; j < 7; j++)
-				{
-					conv_buffer[i][j][k] = BSPLINE_PREFILTER[0] * interp_coefficient[i][j][k] +
-						BSPLINE_PREFILTER[1] * (interp_coefficient[i][getHigh(j - 1, 0)][k] + interp_coefficient[i][j + 1][k]) +
-						BSPLINE_PREFILTER[2] * (interp_coefficient[i][getHigh(j - 2, 0)][k] + interp_coefficient[i][j + 2][k]) +
-						BSPLINE_PREFILTER[3] * (interp_coefficient[i][getHigh(j - 3, 0)][k] + interp_coefficient[i][j + 3][k]) +
-						BSPLINE_PREFILTER[4] * (interp_coefficient[i][getHigh(j - 4, 0)][k] + interp_coefficient[i][j + 4][k]) +
-						BSPLINE_PREFILTER[5] * (interp_coefficient[i][getHigh(j - 5, 0)][k] + interp_coefficient[i][j + 5][k]) +
-						BSPLINE_PREFILTER[6] * (interp_coefficient[i][getHigh(j - 6, 0)][k] + interp_coefficient[i][j + 6][k]) +
-						BSPLINE_PREFILTER[7] * (interp_coefficient[i][getHigh(j - 7, 0)][k] + interp_coefficient[i][j + 7][k]);
-				}
-				for (int j = dim_y - 7; j < dim_y; j++)
-				{
-					conv_buffer[i][j][k] = BSPLINE_PREFILTER[0] * interp_coefficient[i][j][k] +
-						BSPLINE_PREFILTER[1] * (interp_coefficient[i][j - 1][k] + interp_coefficient[i][getLow(j + 1, dim_y - 1)][k]) +
-						BSPLINE_PREFILTER[2] * (interp_coefficient[i][j - 2][k] + interp_coefficient[i][getLow(j + 2, dim_y - 1)][k]) +
-						BSPLINE_PREFILTER[3] * (interp_coefficient[i][j - 3][k] + interp_coefficient[i][getLow(j + 3, dim_y - 1)][k]) +
-						BSPLINE_PREFILTER[4] * (interp_coefficient[i][j - 4][k] + interp_coefficient[i][getLow(j + 4, dim_y - 1)][k]) +
-						BSPLINE_PREFILTER[5] * (interp_coefficient[i][j - 5][k] + interp_coefficient[i][getLow(j + 5, dim_y - 1)][k]) +
-						BSPLINE_PREFILTER[6] * (interp_coefficient[i][j - 6][k] + interp_coefficient[i][getLow(j + 6, dim_y - 1)][k]) +
-						BSPLINE_PREFILTER[7] * (interp_coefficient[i][j - 7][k] + interp_coefficient[i][getLow(j + 7, dim_y - 1)][k]);
+					neighbor_row[m] = coefficient_view.row(i, getLow(getHigh(j + m - 7, 0), dim_y - 1));
 				}
+				prefilterRows(neighbor_row, buffer_view.row(i, j), dim_x);
 			}
 		}
 
-		//convolution along z-axis
+		//convolution along z-axis, the rows at the same position of neighboring slices are processed as a whole
 #pragma omp parallel for
-		for (int j = 0; j < dim_y; j++)
+		for (int i = 0; i < dim_z; i++)
 		{
-			for (int k = 0; k < dim_x; k++)
+			const float* neighbor_row[15];
+			for (int j = 0; j < dim_y; j++)
 			{
-				for (int i = 7; i < dim_z - 7; i++)
+				for (int m = 0; m < 15; m++)
 				{
-					interp_coefficient[i][j][k] = BSPLINE_PREFILTER[0] * conv_buffer[i][j][k] +
-						BSPLINE_PREFILTER[1] * (conv_buffer[i - 1][j][k] + conv_buffer[i + 1][j][k]) +
-						BSPLINE_PREFILTER[2] * (conv_buffer[i - 2][j][k] + conv_buffer[i + 2][j][k]) +
-						BSPLINE_PREFILTER[3] * (conv_buffer[i - 3][j][k] + conv_buffer[i + 3][j][k]) +
-						BSPLINE_PREFILTER[4] * (conv_buffer[i - 4][j][k] + conv_buffer[i + 4][j][k]) +
-						BSPLINE_PREFILTER[5] * (conv_buffer[i - 5][j][k] + conv_buffer[i + 5][j][k]) +
-						BSPLINE_PREFILTER[6] * (conv_buffer[i - 6][j][k] + conv_buffer[i + 6][j][k]) +
-						BSPLINE_PREFILTER[7] * (conv_buffer[i - 7][j][k] + conv_buffer[i + 7][j][k]);
-				}
-				for (int i = 0; i < 7; i++)
-				{
-					interp_coefficient[i][j][k] = BSPLINE_PREFILTER[0] * conv_buffer[i][j][k] +
-						BSPLINE_PREFILTER[1] * (conv_buffer[getHigh(i - 1, 0)][j][k] + conv_buffer[i + 1][j][k]) +
-						BSPLINE_PREFILTER[2] * (conv_buffer[getHigh(i - 2, 0)][j][k] + conv_buffer[i + 2][j][k]) +
-						BSPLINE_PREFILTER[3] * (conv_buffer[getHigh(i - 3, 0)][j][k] + conv_buffer[i + 3][j][k]) +
-						BSPLINE_PREFILTER[4] * (conv_buffer[getHigh(i - 4, 0)][j][k] + conv_buffer[i + 4][j][k]) +
-						BSPLINE_PREFILTER[5] * (conv_buffer[getHigh(i - 5, 0)][j][k] + conv_buffer[i + 5][j][k]) +
-						BSPLINE_PREFILTER[6] * (conv_buffer[getHigh(i - 6, 0)][j][k] + conv_buffer[i + 6][j][k]) +
-						BSPLINE_PREFILTER[7] * (conv_buffer[getHigh(i - 7, 0)][j][k] + conv_buffer[i + 7][j][k]);
-				}
-				for (int i = dim_z - 7; i < dim_z; i++)
-				{
-					interp_coefficient[i][j][k] = BSPLINE_PREFILTER[0] * conv_buffer[i][j][k] +
-						BSPLINE_PREFILTER[1] * (conv_buffer[i - 1][j][k] + conv_buffer[getLow(i + 1, dim_z - 1)][j][k]) +
-						BSPLINE_PREFILTER[2] * (conv_buffer[i - 2][j][k] + conv_buffer[getLow(i + 2, dim_z - 1)][j][k]) +
-						BSPLINE_PREFILTER[3] * (conv_buffer[i - 3][j][k] + conv_buffer[getLow(i + 3, dim_z - 1)][j][k]) +
-						BSPLINE_PREFILTER[4] * (conv_buffer[i - 4][j][k] + conv_buffer[getLow(i + 4, dim_z - 1)][j][k]) +
-						BSPLINE_PREFILTER[5] * (conv_buffer[i - 5][j][k] + conv_buffer[getLow(i + 5, dim_z - 1)][j][k]) +
-						BSPLINE_PREFILTER[6] * (conv_buffer[i - 6][j][k] + conv_buffer[getLow(i + 6, dim_z - 1)][j][k]) +
-						BSPLINE_PREFILTER[7] * (conv_buffer[i - 7][j][k] + conv_buffer[getLow(i + 7, dim_z - 1)][j][k]);
+					neighbor_row[m] = buffer_view.row(getLow(getHigh(i + m - 7, 0), dim_z - 1), j);
 				}
+				prefilterRows(neighbor_row, coefficient_view.row(i, j), dim_x);
 			}
 		}
 		delete3D(conv_buffer);
 	}
 
+	void TricubicBspline::prefilterRows(const float* const* row, float* result, int length)
+	{
+		for (int k = 0; k < length; k++)
+		{
+			result[k] = BSPLINE_PREFILTER[0] * row[7][k] +
+				BSPLINE_PREFILTER[1] * (row[6][k] + row[8][k]) +
+				BSPLINE_PREFILTER[2] * (row[5][k] + row[9][k]) +
+				BSPLINE_PREFILTER[3] * (row[4][k] + row[10][k]) +
+				BSPLINE_PREFILTER[4] * (row[3][k] + row[11][k]) +
+				BSPLINE_PREFILTER[5] * (row[2][k] + row[12][k]) +
+				BSPLINE_PREFILTER[6] * (row[1][k] + row[13][k]) +
+				BSPLINE_PREFILTER[7] * (row[0][k] + row[14][k]);
+		}
+	}
+
 	float TricubicBspline::compute(Point3D& location)
 	{
 		if (location.x < 1 || location.y < 1 || location.z < 1
@@ -343,14 +490,16 @@ namespace opencorr
 		basis_z[2] = basis2(z_decimal);
 		basis_z[3] = basis3(z_decimal);
 
+		VolumeView coefficient_view(interp_coefficient[0][0], dim_x, dim_y, dim_z);
 		for (int i = 0; i < 4; i++)
 		{
 			for (int j = 0; j < 4; j++)
 			{
-				sum_x[j] = basis_x[0] * interp_coefficient[z_integral + i - 1][y_integral + j - 1][x_integral - 1]
-					+ basis_x[1] * interp_coefficient[z_integral + i - 1][y_integral + j - 1][x_integral]
-					+ basis_x[2] * interp_coefficient[z_integral + i - 1][y_integral + j - 1][x_integral + 1]
-					+ basis_x[3] * interp_coefficient[z_integral + i - 1][y_integral + j - 1][x_integral + 2];
+				const float* coefficient_row = coefficient_view.row(z_integral + i - 1, y_integral + j - 1) + x_integral - 1;
+				sum_x[j] = basis_x[0] * coefficient_row[0]
+					+ basis_x[1] * coefficient_row[1]
+					+ basis_x[2] * coefficient_row[2]
+					+ basis_x[3] * coefficient_row[3];
 			}
 			sum_y[i] = basis_y[0] * sum_x[0] + basis_y[1] * sum_x[1] + basis_y[2] * sum_x[2] + basis_y[3] * sum_x[3];
 		}
@@ -359,6 +508,117 @@ namespace opencorr
 		return value;
 	}
 
+	void TricubicBspline::computeBatch(const float* x, const float* y, const float* z, float* value, int n)
+	{
+		interpolateTricubic(interp_coefficient[0][0], dim_x, dim_y, dim_z, x, y, z, value, n);
+	}
+
+	void TricubicBspline::computeGradient(int x, int y, int z, float& gradient_x, float& gradient_y, float& gradient_z)
+	{
+		if (x < 1 || y < 1 || z < 1 || x > dim_x - 2 || y > dim_y - 2 || z > dim_z - 2)
+		{
+			gradient_x = 0.f;
+			gradient_y = 0.f;
+			gradient_z = 0.f;
+			return;
+		}
+
+		//at decimal 0, the fourth basis function and its derivative vanish, thus only 3x3x3 coefficients are involved
+		const float basis[3] = { 1.f / 6.f, 4.f / 6.f, 1.f / 6.f };
+		const float basis_derivative[3] = { -0.5f, 0.f, 0.5f };
+
+		VolumeView coefficient_view(interp_coefficient[0][0], dim_x, dim_y, dim_z);
+		float sum_xy[3], derivative_xy[3], derivative_yx[3]; //smoothed along x and y, differentiated along x or y
+		for (int i = 0; i < 3; i++)
+		{
+			float sum_x[3], derivative_x[3];
+			for (int j = 0; j < 3; j++)
+			{
+				const float* coefficient_row = coefficient_view.row(z + i - 1, y + j - 1) + x - 1;
+				sum_x[j] = basis[0] * coefficient_row[0] + basis[1] * coefficient_row[1] + basis[2] * coefficient_row[2];
+				derivative_x[j] = basis_derivative[0] * coefficient_row[0] + basis_derivative[2] * coefficient_row[2];
+			}
+			sum_xy[i] = basis[0] * sum_x[0] + basis[1] * sum_x[1] + basis[2] * sum_x[2];
+			derivative_xy[i] = basis[0] * derivative_x[0] + basis[1] * derivative_x[1] + basis[2] * derivative_x[2];
+			derivative_yx[i] = basis_derivative[0] * sum_x[0] + basis_derivative[2] * sum_x[2];
+		}
+
+		gradient_x = basis[0] * derivative_xy[0] + basis[1] * derivative_xy[1] + basis[2] * derivative_xy[2];
+		gradient_y = basis[0] * derivative_yx[0] + basis[1] * derivative_yx[1] + basis[2] * derivative_yx[2];
+		gradient_z = basis_derivative[0] * sum_xy[0] + basis_derivative[2] * sum_xy[2];
+	}
+
+
+	//gradients from the coefficients of bicubic B-spline
+	BicubicBsplineGradient::BicubicBsplineGradient(Image2D& image)
+	{
+		grad_img = &image;
+	}
+
+	BicubicBsplineGradient::~BicubicBsplineGradient() {}
+
+	void BicubicBsplineGradient::prepare()
+	{
+		int height = grad_img->height;
+		int width = grad_img->width;
+
+		//prefilter along x-axis and then y-axis, the borders are extended by clamping
+		RowMatrixXf buffer(height, width);
+#pragma omp parallel for
+		for (int r = 0; r < height; r++)
+		{
+			for (int c = 0; c < width; c++)
+			{
+				float value = BSPLINE_PREFILTER[0] * grad_img->eg_mat(r, c);
+				for (int i = 1; i < 8; i++)
+				{
+					value += BSPLINE_PREFILTER[i] * (grad_img->eg_mat(r, getHigh(c - i, 0)) + grad_img->eg_mat(r, getLow(c + i, width - 1)));
+				}
+				buffer(r, c) = value;
+			}
+		}
+
+		coefficient_map.resize(height, width);
+#pragma omp parallel for
+		for (int r = 0; r < height; r++)
+		{
+			for (int c = 0; c < width; c++)
+			{
+				float value = BSPLINE_PREFILTER[0] * buffer(r, c);
+				for (int i = 1; i < 8; i++)
+				{
+					value += BSPLINE_PREFILTER[i] * (buffer(getHigh(r - i, 0), c) + buffer(getLow(r + i, height - 1), c));
+				}
+				coefficient_map(r, c) = value;
+			}
+		}
+	}
+
+	void BicubicBsplineGradient::computeGradient(int x, int y, float& gradient_x, float& gradient_y)
+	{
+		if (x < 1 || y < 1 || x > grad_img->width - 2 || y > grad_img->height - 2)
+		{
+			gradient_x = 0.f;
+			gradient_y = 0.f;
+			return;
+		}
+
+		//values and derivatives of basis functions at decimal 0, the fourth ones vanish
+		const float basis[3] = { 1.f / 6.f, 4.f / 6.f, 1.f / 6.f };
+		const float basis_derivative[3] = { -0.5f, 0.f, 0.5f };
+
+		gradient_x = 0.f;
+		gradient_y = 0.f;
+		for (int i = 0; i < 3; i++)
+		{
+			int r = y - 1 + i;
+			float sum_x = basis[0] * coefficient_map(r, x - 1) + basis[1] * coefficient_map(r, x) + basis[2] * coefficient_map(r, x + 1);
+			float derivative_x = basis_derivative[0] * coefficient_map(r, x - 1) + basis_derivative[2] * coefficient_map(r, x + 1);
+			gradient_x += basis[i] * derivative_x;
+			gradient_y += basis_derivative[i] * sum_x;
+		}
+	}
+
 	int getLow(int x, int y)
 	{
 		int value;
@@ -18,6 +18,7 @@
 #define  _CUBIC_BSPLINE_H_
 
 #include "oc_interpolation.h"
+#include "oc_simd.h"
 
 namespace opencorr
 {
@@ -29,14 +30,28 @@ namespace opencorr
 	{
 	public:
 		BicubicBspline(Image2D& image);
+		BicubicBspline(Image2D& image, bool compact_storage);
 		~BicubicBspline();
 
 		void prepare();
 		float compute(Point2D& location);
+		void computeBatch(const float* x, const float* y, float* value, int n);
+
+		//estimate the grayscale values together with their gradients at n locations, the gradients are the analytic
+		//derivatives of the interpolating polynomials, thus no gradient maps or extra look-up tables are needed
+		void computeBatchGradient(const float* x, const float* y, float* value, float* gradient_x, float* gradient_y, int n);
+
+		//look-up table of 4x4 polynomial coefficients stored continuously, nullptr in compact storage or before preparation
+		const float* getCoefficientTable() const;
 
 	private:
+		bool compact_storage; //true: store one coefficient per pixel and evaluate the 4x4 basis on the fly
 
-		float**** interp_coefficient = nullptr;
+		float**** interp_coefficient = nullptr; //look-up table of 4x4 polynomial coefficients for each pixel
+		RowMatrixXf coefficient_map; //control points used in compact storage, the local prefilter is folded into the basis weights
+
+		float computeCompact(Point2D& location);
+		void computeCompactGradient(Point2D& location, float& value, float& gradient_x, float& gradient_y);
 
 		const float CONTROL_MATRIX[4][4] =
 		{
@@ -67,23 +82,48 @@ namespace opencorr
 
 		void prepare();
 		float compute(Point3D& location);
+		void computeBatch(const float* x, const float* y, const float* z, float* value, int n);
+
+		//exact gradient of the interpolant at an integer voxel, obtained from the derivatives of basis functions
+		void computeGradient(int x, int y, int z, float& gradient_x, float& gradient_y, float& gradient_z);
 
 	private:
 		float*** interp_coefficient = nullptr;
 
-		//B-spline prefilter
-		const float BSPLINE_PREFILTER[8] =
-		{
-			1.732176555412860f,  //b0
-			-0.464135309171000f, //b1
-			0.124364681271139f,  //b2
-			-0.033323415913556f, //b3
-			0.008928982383084f,  //b4
-			-0.002392513618779f, //b5
-			0.000641072092032f,  //b6
-			-0.000171774749350f, //b7
-		};
+		//convolve 15 rows with the prefilter along the direction across the rows, row[7] is the central one
+		void prefilterRows(const float* const* row, float* result, int length);
+	};
+
+	//gradients of 2D image evaluated on demand from the coefficients of cubic B-spline, which are obtained with
+	//the same prefilter as TricubicBspline. the look-up table of BicubicBspline is not used, as its local control
+	//points do not give continuous derivatives across pixels
+	class BicubicBsplineGradient
+	{
+	public:
+		BicubicBsplineGradient(Image2D& image);
+		~BicubicBsplineGradient();
+
+		void prepare(); //calculate the coefficients, one per pixel
+
+		//exact gradient of the B-spline at an integer pixel
+		void computeGradient(int x, int y, float& gradient_x, float& gradient_y);
 
+	private:
+		Image2D* grad_img = nullptr;
+		RowMatrixXf coefficient_map;
+	};
+
+	//B-spline prefilter
+	const float BSPLINE_PREFILTER[8] =
+	{
+		1.732176555412860f,  //b0
+		-0.464135309171000f, //b1
+		0.124364681271139f,  //b2
+		-0.033323415913556f, //b3
+		0.008928982383084f,  //b4
+		-0.002392513618779f, //b5
+		0.000641072092032f,  //b6
+		-0.000171774749350f, //b7
 	};
 
 	//Four cubic B-spline basis functions when input falls in different range
@@ -104,6 +104,21 @@ namespace opencorr
 		return new_location;
 	}
 
+	void Deformation2D1::warpRow(Point2D& start, int length, float* x, float* y)
+	{
+		//the warped coordinates are affine in x, thus the row is generated by adding constant increments to the first point
+		float x_start = warp_matrix(0, 0) * start.x + warp_matrix(0, 1) * start.y + warp_matrix(0, 2);
+		float y_start = warp_matrix(1, 0) * start.x + warp_matrix(1, 1) * start.y + warp_matrix(1, 2);
+		float x_increment = warp_matrix(0, 0);
+		float y_increment = warp_matrix(1, 0);
+
+		for (int i = 0; i < length; i++)
+		{
+			x[i] = x_start + x_increment * i;
+			y[i] = y_start + y_increment * i;
+		}
+	}
+
 	void Deformation2D1::setDeformation()
 	{
 		u = warp_matrix(0, 2);
@@ -281,6 +296,24 @@ namespace opencorr
 		return new_location;
 	}
 
+	void Deformation2D2::warpRow(Point2D& start, int length, float* x, float* y)
+	{
+		//along a row the warped coordinates are quadratic in x, the coefficients are collected once for the row
+		float x_coefficient2 = warp_matrix(3, 0);
+		float x_coefficient1 = warp_matrix(3, 1) * start.y + warp_matrix(3, 3);
+		float x_coefficient0 = (warp_matrix(3, 2) * start.y + warp_matrix(3, 4)) * start.y + warp_matrix(3, 5);
+		float y_coefficient2 = warp_matrix(4, 0);
+		float y_coefficient1 = warp_matrix(4, 1) * start.y + warp_matrix(4, 3);
+		float y_coefficient0 = (warp_matrix(4, 2) * start.y + warp_matrix(4, 4)) * start.y + warp_matrix(4, 5);
+
+		for (int i = 0; i < length; i++)
+		{
+			float x_local = start.x + i;
+			x[i] = (x_coefficient2 * x_local + x_coefficient1) * x_local + x_coefficient0;
+			y[i] = (y_coefficient2 * x_local + y_coefficient1) * x_local + y_coefficient0;
+		}
+	}
+
 	void Deformation2D2::setDeformation()
 	{
 		u = warp_matrix(3, 5);
@@ -529,4 +562,21 @@ namespace opencorr
 		return new_location;
 	}
 
+	void Deformation3D1::warpRow(Point3D& start, int length, float* x, float* y, float* z)
+	{
+		float x_start = warp_matrix(0, 0) * start.x + warp_matrix(0, 1) * start.y + warp_matrix(0, 2) * start.z + warp_matrix(0, 3);
+		float y_start = warp_matrix(1, 0) * start.x + warp_matrix(1, 1) * start.y + warp_matrix(1, 2) * start.z + warp_matrix(1, 3);
+		float z_start = warp_matrix(2, 0) * start.x + warp_matrix(2, 1) * start.y + warp_matrix(2, 2) * start.z + warp_matrix(2, 3);
+		float x_increment = warp_matrix(0, 0);
+		float y_increment = warp_matrix(1, 0);
+		float z_increment = warp_matrix(2, 0);
+
+		for (int i = 0; i < length; i++)
+		{
+			x[i] = x_start + x_increment * i;
+			y[i] = y_start + y_increment * i;
+			z[i] = z_start + z_increment * i;
+		}
+	}
+
 }//namespace opencorr
\ No newline at end of file
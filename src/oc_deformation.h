@@ -42,6 +42,7 @@ namespace opencorr
 
 		void setWarp(); //update warp_matrix according to deformation
 		Point2D warp(Point2D& location);
+		void warpRow(Point2D& start, int length, float* x, float* y); //warp a row of points from start with unit step along x, results are stored in x and y
 	};
 
 	//2D deformation with the 2nd order shape function
@@ -67,6 +68,7 @@ namespace opencorr
 
 		void setWarp(); //update warp_matrix according to deformation
 		Point2D warp(Point2D location);
+		void warpRow(Point2D& start, int length, float* x, float* y); //warp a row of points from start with unit step along x, results are stored in x and y
 	};
 
 	//3D deformation with the 1st order shape function
@@ -94,6 +96,7 @@ namespace opencorr
 
 		void setWarp(); //update warp_matrix according to deformation
 		Point3D warp(Point3D& point);
+		void warpRow(Point3D& start, int length, float* x, float* y, float* z); //warp a row of points from start with unit step along x, results are stored in x, y and z
 	};
 
 }//namespace opencorr
@@ -12,6 +12,10 @@
  * More information about OpenCorr can be found at https://www.opencorr.org/
  */
 
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
 #include "oc_dic.h"
 
 namespace opencorr
@@ -32,6 +36,45 @@ namespace opencorr
 
 	void DIC::prepare() {}
 
+	void DIC::prepareRef()
+	{
+		prepare();
+	}
+
+	Interpolation2D* DIC::swapTarInterpolation(Interpolation2D* tar_interp)
+	{
+		return tar_interp;
+	}
+
+	void DIC::setSchedule(int schedule_chunk)
+	{
+		this->schedule_chunk = schedule_chunk > 0 ? schedule_chunk : 0;
+	}
+
+	void DIC::computeQueue(std::vector<POI2D>& poi_queue)
+	{
+		int queue_length = (int)poi_queue.size();
+		if (schedule_chunk == 0)
+		{
+#pragma omp parallel for
+			for (int i = 0; i < queue_length; i++)
+			{
+				compute(&poi_queue[i]);
+			}
+			return;
+		}
+
+		//POIs are visited through the permutation, thus the queue itself keeps its order
+		std::vector<int> poi_order;
+		curveOrder(poi_queue, poi_order);
+		int chunk = schedule_chunk;
+#pragma omp parallel for schedule(dynamic, chunk)
+		for (int i = 0; i < queue_length; i++)
+		{
+			compute(&poi_queue[poi_order[i]]);
+		}
+	}
+
 
 	DVC::DVC() {}
 
@@ -50,6 +93,35 @@ namespace opencorr
 	}
 	void DVC::prepare() {}
 
+	void DVC::setSchedule(int schedule_chunk)
+	{
+		this->schedule_chunk = schedule_chunk > 0 ? schedule_chunk : 0;
+	}
+
+	void DVC::computeQueue(std::vector<POI3D>& poi_queue)
+	{
+		int queue_length = (int)poi_queue.size();
+		if (schedule_chunk == 0)
+		{
+#pragma omp parallel for
+			for (int i = 0; i < queue_length; i++)
+			{
+				compute(&poi_queue[i]);
+			}
+			return;
+		}
+
+		//POIs are visited through the permutation, thus the queue itself keeps its order
+		std::vector<int> poi_order;
+		curveOrder(poi_queue, poi_order);
+		int chunk = schedule_chunk;
+#pragma omp parallel for schedule(dynamic, chunk)
+		for (int i = 0; i < queue_length; i++)
+		{
+			compute(&poi_queue[poi_order[i]]);
+		}
+	}
+
 
 	bool sortByZNCC(const POI2D& p1, const POI2D& p2) {
 		return p1.result.zncc > p2.result.zncc;
@@ -60,4 +132,94 @@ namespace opencorr
 		return kp1.distance < kp2.distance;
 	}
 
+	uint64_t mortonCode(uint32_t x, uint32_t y)
+	{
+		uint64_t code = 0;
+		for (int i = 0; i < 32; i++)
+		{
+			code |= ((uint64_t)((x >> i) & 1u) << (2 * i)) | ((uint64_t)((y >> i) & 1u) << (2 * i + 1));
+		}
+
+		return code;
+	}
+
+	uint64_t mortonCode(uint32_t x, uint32_t y, uint32_t z)
+	{
+		uint64_t code = 0;
+		for (int i = 0; i < 21; i++)
+		{
+			code |= ((uint64_t)((x >> i) & 1u) << (3 * i))
+				| ((uint64_t)((y >> i) & 1u) << (3 * i + 1))
+				| ((uint64_t)((z >> i) & 1u) << (3 * i + 2));
+		}
+
+		return code;
+	}
+
+	void curveOrder(std::vector<POI2D>& poi_queue, std::vector<int>& poi_order)
+	{
+		int queue_length = (int)poi_queue.size();
+		poi_order.resize(queue_length);
+		if (queue_length == 0)
+		{
+			return;
+		}
+
+		//shift the coordinates to make them non-negative
+		float min_x = poi_queue[0].x, min_y = poi_queue[0].y;
+		for (int i = 1; i < queue_length; i++)
+		{
+			min_x = std::min(min_x, poi_queue[i].x);
+			min_y = std::min(min_y, poi_queue[i].y);
+		}
+
+		std::vector<std::pair<uint64_t, int>> code_queue(queue_length);
+		for (int i = 0; i < queue_length; i++)
+		{
+			uint32_t x = (uint32_t)std::floor(poi_queue[i].x - min_x);
+			uint32_t y = (uint32_t)std::floor(poi_queue[i].y - min_y);
+			code_queue[i] = std::make_pair(mortonCode(x, y), i);
+		}
+
+		std::sort(code_queue.begin(), code_queue.end());
+		for (int i = 0; i < queue_length; i++)
+		{
+			poi_order[i] = code_queue[i].second;
+		}
+	}
+
+	void curveOrder(std::vector<POI3D>& poi_queue, std::vector<int>& poi_order)
+	{
+		int queue_length = (int)poi_queue.size();
+		poi_order.resize(queue_length);
+		if (queue_length == 0)
+		{
+			return;
+		}
+
+		//shift the coordinates to make them non-negative
+		float min_x = poi_queue[0].x, min_y = poi_queue[0].y, min_z = poi_queue[0].z;
+		for (int i = 1; i < queue_length; i++)
+		{
+			min_x = std::min(min_x, poi_queue[i].x);
+			min_y = std::min(min_y, poi_queue[i].y);
+			min_z = std::min(min_z, poi_queue[i].z);
+		}
+
+		std::vector<std::pair<uint64_t, int>> code_queue(queue_length);
+		for (int i = 0; i < queue_length; i++)
+		{
+			uint32_t x = (uint32_t)std::floor(poi_queue[i].x - min_x);
+			uint32_t y = (uint32_t)std::floor(poi_queue[i].y - min_y);
+			uint32_t z = (uint32_t)std::floor(poi_queue[i].z - min_z);
+			code_queue[i] = std::make_pair(mortonCode(x, y, z), i);
+		}
+
+		std::sort(code_queue.begin(), code_queue.end());
+		for (int i = 0; i < queue_length; i++)
+		{
+			poi_order[i] = code_queue[i].second;
+		}
+	}
+
 }//namespace opencorr
@@ -17,8 +17,12 @@
 #ifndef _DIC_H_
 #define _DIC_H_
 
+#include <cstdint>
+#include <vector>
+
 #include "oc_array.h"
 #include "oc_image.h"
+#include "oc_interpolation.h"
 #include "oc_poi.h"
 #include "oc_subset.h"
 
@@ -47,9 +51,24 @@ namespace opencorr
 		void setSubsetRadius(int radius_x, int radius_y);
 
 		virtual void prepare();
+		virtual void prepareRef(); //prepare the data depending only on ref image, calls prepare() by default
+
+		//hand over an interpolation of tar image prepared outside the engine, the one held before is returned to the caller.
+		//an engine not supporting it returns the input directly, the caller then keeps its ownership
+		virtual Interpolation2D* swapTarInterpolation(Interpolation2D* tar_interp);
+
 		virtual void compute(POI2D* poi) = 0;
 		virtual void compute(std::vector<POI2D>& poi_queue) = 0;
 
+		//process the POIs along Z-order (Morton) curve in chunks of schedule_chunk POIs, which are dynamically
+		//assigned to threads. the neighboring POIs thus share the cached data of images. 0 to disable it
+		void setSchedule(int schedule_chunk);
+
+	protected:
+		int schedule_chunk = 0; //number of POIs in a chunk of curve scheduling, 0 for the plain loop over queue
+
+		//batch processing shared by engines, the results are written in poi_queue in the order of input
+		void computeQueue(std::vector<POI2D>& poi_queue);
 	};
 
 	class DVC
@@ -70,12 +89,29 @@ namespace opencorr
 		virtual void prepare();
 		virtual void compute(POI3D* POI) = 0;
 		virtual void compute(std::vector<POI3D>& poi_queue) = 0;
+
+		//process the POIs along Z-order (Morton) curve in chunks of schedule_chunk POIs, 0 to disable it
+		void setSchedule(int schedule_chunk);
+
+	protected:
+		int schedule_chunk = 0; //number of POIs in a chunk of curve scheduling, 0 for the plain loop over queue
+
+		//batch processing shared by engines, the results are written in poi_queue in the order of input
+		void computeQueue(std::vector<POI3D>& poi_queue);
 	};
 
 	bool sortByZNCC(const POI2D& p1, const POI2D& p2);
 
 	bool sortByDistance(const KeypointIndex& kp1, const KeypointIndex& kp2);
 
+	//Morton code of non-negative integer coordinates, 32 bits per axis in 2D and 21 bits per axis in 3D
+	uint64_t mortonCode(uint32_t x, uint32_t y);
+	uint64_t mortonCode(uint32_t x, uint32_t y, uint32_t z);
+
+	//indices of POIs sorted along Z-order curve
+	void curveOrder(std::vector<POI2D>& poi_queue, std::vector<int>& poi_order);
+	void curveOrder(std::vector<POI3D>& poi_queue, std::vector<int>& poi_order);
+
 }//namespace opencorr
 
 #endif //_DIC_H_
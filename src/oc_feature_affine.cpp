@@ -18,14 +18,25 @@
 
 namespace opencorr
 {
-	NearestNeighbor* FeatureAffine2D::getInstance(int tid)
+	NearestNeighbor* FeatureAffine2D::getInstance()
 	{
-		if (tid >= (int)instance_pool.size())
+		NearestNeighbor* instance = instance_pool.acquire();
+		if (instance == nullptr)
 		{
-			throw std::string("CPU thread ID over limit");
+			instance = new NearestNeighbor();
+			prepareInstance(instance);
+			instance_pool.add(instance);
 		}
 
-		return instance_pool[tid];
+		return instance;
+	}
+
+	void FeatureAffine2D::prepareInstance(NearestNeighbor* instance)
+	{
+		instance->assignPoints(ref_kp);
+		instance->setSearchRadius(neighbor_search_radius);
+		instance->setSearchK(min_neighbor_num);
+		instance->constructKdTree();
 	}
 
 	FeatureAffine2D::FeatureAffine2D(int radius_x, int radius_y, int thread_number)
@@ -42,13 +53,13 @@ namespace opencorr
 		for (int i = 0; i < thread_number; i++)
 		{
 			NearestNeighbor* instance = new NearestNeighbor();
-			instance_pool.push_back(instance);
+			instance_pool.addFree(instance);
 		}
 	}
 
 	FeatureAffine2D::~FeatureAffine2D()
 	{
-		for (auto& instance : instance_pool)
+		for (auto& instance : instance_pool.getWorkspaces())
 		{
 			delete instance;
 		}
@@ -89,20 +100,19 @@ namespace opencorr
 
 	void FeatureAffine2D::prepare()
 	{
+		std::vector<NearestNeighbor*>& instance_queue = instance_pool.getWorkspaces();
+		int instance_number = (int)instance_queue.size();
 #pragma omp parallel for
-		for (int i = 0; i < thread_number; i++)
+		for (int i = 0; i < instance_number; i++)
 		{
-			instance_pool[i]->assignPoints(ref_kp);
-			instance_pool[i]->setSearchRadius(neighbor_search_radius);
-			instance_pool[i]->setSearchK(min_neighbor_num);
-			instance_pool[i]->constructKdTree();
+			prepareInstance(instance_queue[i]);
 		}
 	}
 
 	void FeatureAffine2D::compute(POI2D* poi)
 	{
-		//set instance w.r.t. thread id 
-		NearestNeighbor* neighbor_search = getInstance(omp_get_thread_num());
+		//get a free instance from pool
+		NearestNeighbor* neighbor_search = getInstance();
 
 		Point3D current_point(poi->x, poi->y, 0.f);
 		std::vector<Point2D> ref_candidates, tar_candidates;
@@ -285,6 +295,9 @@ namespace opencorr
 				poi->result.zncc = 0;
 			}
 		}
+
+		//return the instance to pool
+		instance_pool.release(neighbor_search);
 	}
 
 	void FeatureAffine2D::compute(std::vector<POI2D>& poi_queue)
@@ -300,8 +313,8 @@ namespace opencorr
 	//functions for self-adaptive subset
 	void FeatureAffine2D::compute(POI2D* poi, int neighbor_k, int min_radius)
 	{
-		//set instance w.r.t. thread id 
-		NearestNeighbor* neighbor_search = getInstance(omp_get_thread_num());
+		//get a free instance from pool
+		NearestNeighbor* neighbor_search = getInstance();
 
 		Point3D current_point(poi->x, poi->y, 0.f);
 		std::vector<Point2D> ref_candidates, tar_candidates;
@@ -462,6 +475,9 @@ namespace opencorr
 				poi->result.zncc = 0;
 			}
 		}
+
+		//return the instance to pool
+		instance_pool.release(neighbor_search);
 	}
 
 	void FeatureAffine2D::compute(std::vector<POI2D>& poi_queue, int neighbor_k, int min_radius)
@@ -477,14 +493,25 @@ namespace opencorr
 	//////////////////////////////////////////////////////////////////////////////
 
 
-	NearestNeighbor* FeatureAffine3D::getInstance(int tid)
+	NearestNeighbor* FeatureAffine3D::getInstance()
 	{
-		if (tid >= (int)instance_pool.size())
+		NearestNeighbor* instance = instance_pool.acquire();
+		if (instance == nullptr)
 		{
-			throw std::string("CPU thread ID over limit");
+			instance = new NearestNeighbor();
+			prepareInstance(instance);
+			instance_pool.add(instance);
 		}
 
-		return instance_pool[tid];
+		return instance;
+	}
+
+	void FeatureAffine3D::prepareInstance(NearestNeighbor* instance)
+	{
+		instance->assignPoints(ref_kp);
+		instance->setSearchRadius(neighbor_search_radius);
+		instance->setSearchK(min_neighbor_num);
+		instance->constructKdTree();
 	}
 
 	FeatureAffine3D::FeatureAffine3D(int radius_x, int radius_y, int radius_z, int thread_number)
@@ -501,13 +528,13 @@ namespace opencorr
 		for (int i = 0; i < thread_number; i++)
 		{
 			NearestNeighbor* instance = new NearestNeighbor();
-			instance_pool.push_back(instance);
+			instance_pool.addFree(instance);
 		}
 	}
 
 	FeatureAffine3D::~FeatureAffine3D()
 	{
-		for (auto& instance : instance_pool)
+		for (auto& instance : instance_pool.getWorkspaces())
 		{
 			delete instance;
 		}
@@ -516,20 +543,19 @@ namespace opencorr
 
 	void FeatureAffine3D::prepare()
 	{
+		std::vector<NearestNeighbor*>& instance_queue = instance_pool.getWorkspaces();
+		int instance_number = (int)instance_queue.size();
 #pragma omp parallel for
-		for (int i = 0; i < thread_number; i++)
+		for (int i = 0; i < instance_number; i++)
 		{
-			instance_pool[i]->assignPoints(ref_kp);
-			instance_pool[i]->setSearchRadius(neighbor_search_radius);
-			instance_pool[i]->setSearchK(min_neighbor_num);
-			instance_pool[i]->constructKdTree();
+			prepareInstance(instance_queue[i]);
 		}
 	}
 
 	void FeatureAffine3D::compute(POI3D* poi)
 	{
-		//set instance w.r.t. thread id 
-		NearestNeighbor* neighbor_search = getInstance(omp_get_thread_num());
+		//get a free instance from pool
+		NearestNeighbor* neighbor_search = getInstance();
 
 		Point3D current_point(poi->x, poi->y, poi->z);
 		std::vector<Point3D> ref_candidates, tar_candidates;
@@ -722,6 +748,9 @@ namespace opencorr
 
 			poi->result.zncc = 0;
 		}
+
+		//return the instance to pool
+		instance_pool.release(neighbor_search);
 	}
 
 	void FeatureAffine3D::compute(std::vector<POI3D>& poi_queue)
@@ -23,6 +23,7 @@
 #include "oc_nearest_neighbor.h"
 #include "oc_poi.h"
 #include "oc_point.h"
+#include "oc_workspace.h"
 
 namespace opencorr
 {
@@ -41,8 +42,9 @@ namespace opencorr
 	class FeatureAffine2D : public DIC
 	{
 	private:
-		std::vector<NearestNeighbor*> instance_pool;
-		NearestNeighbor* getInstance(int tid);
+		WorkspacePool<NearestNeighbor> instance_pool; //pool of instances for concurrent processing
+		NearestNeighbor* getInstance(); //get a free instance, a new one is allocated if none is free
+		void prepareInstance(NearestNeighbor* instance); //build the kd-tree of matched keypoints in ref image
 
 	protected:
 		float neighbor_search_radius; //seaching radius for mached keypoints around a POI
@@ -81,8 +83,9 @@ namespace opencorr
 	class FeatureAffine3D : public DVC
 	{
 	private:
-		std::vector<NearestNeighbor*> instance_pool;
-		NearestNeighbor* getInstance(int tid);
+		WorkspacePool<NearestNeighbor> instance_pool; //pool of instances for concurrent processing
+		NearestNeighbor* getInstance(); //get a free instance, a new one is allocated if none is free
+		void prepareInstance(NearestNeighbor* instance); //build the kd-tree of matched keypoints in ref image
 
 	protected:
 		float neighbor_search_radius; //seaching radius for mached keypoints around a POI
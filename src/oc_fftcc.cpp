@@ -12,15 +12,108 @@
  * More information about OpenCorr can be found at https://www.opencorr.org/
  */
 
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
 #include "oc_fftcc.h"
 
 namespace opencorr
 {
+	std::mutex FFTWPlanCache::cache_mutex;
+	std::map<std::vector<int>, fftwf_plan> FFTWPlanCache::plan_map;
+	unsigned FFTWPlanCache::planner_flag = FFTW_ESTIMATE;
+
+	fftwf_plan FFTWPlanCache::getPlan(bool forward, const std::vector<int>& dimension, int batch_size)
+	{
+		std::vector<int> key = dimension;
+		key.push_back(batch_size);
+		key.push_back(forward ? 1 : 0);
+
+		//the planner of FFTW is not thread-safe, while the execution of plans is
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		auto iter = plan_map.find(key);
+		if (iter != plan_map.end())
+		{
+			return iter->second;
+		}
+
+		//the plan is created on temporary arrays, which are allocated by fftw_malloc with the same alignment as the arrays of instances
+		int rank = (int)dimension.size();
+		int real_length = 1;
+		for (int i = 0; i < rank; i++)
+		{
+			real_length *= dimension[i];
+		}
+		int complex_length = real_length / dimension[rank - 1] * (dimension[rank - 1] / 2 + 1);
+
+		float* real_data = (float*)fftw_malloc(sizeof(float) * real_length * batch_size);
+		fftwf_complex* complex_data = (fftwf_complex*)fftw_malloc(sizeof(fftwf_complex) * complex_length * batch_size);
+
+		fftwf_plan plan;
+		if (forward)
+		{
+			plan = fftwf_plan_many_dft_r2c(rank, dimension.data(), batch_size, real_data, nullptr, 1, real_length,
+				complex_data, nullptr, 1, complex_length, planner_flag);
+		}
+		else
+		{
+			plan = fftwf_plan_many_dft_c2r(rank, dimension.data(), batch_size, complex_data, nullptr, 1, complex_length,
+				real_data, nullptr, 1, real_length, planner_flag);
+		}
+
+		fftw_free(real_data);
+		fftw_free(complex_data);
+
+		plan_map[key] = plan;
+		return plan;
+	}
+
+	void FFTWPlanCache::setPlanner(unsigned planner_flag)
+	{
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		FFTWPlanCache::planner_flag = planner_flag;
+	}
+
+	bool FFTWPlanCache::importWisdom(const std::string& file_path)
+	{
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		if (fftwf_import_wisdom_from_filename(file_path.c_str()) == 0)
+		{
+			std::cerr << "Failed to import FFTW wisdom from: " << file_path << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	bool FFTWPlanCache::exportWisdom(const std::string& file_path)
+	{
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		if (fftwf_export_wisdom_to_filename(file_path.c_str()) == 0)
+		{
+			std::cerr << "Failed to export FFTW wisdom to: " << file_path << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	void FFTWPlanCache::clear()
+	{
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		for (auto& plan : plan_map)
+		{
+			fftwf_destroy_plan(plan.second);
+		}
+		plan_map.clear();
+	}
+
 	FFTW* FFTW::allocate(int subset_radius_x, int subset_radius_y)
 	{
 		int width = 2 * subset_radius_x;
 		int height = 2 * subset_radius_y;
-		int buffer_length = width * (subset_radius_y + 1);
+		int buffer_length = height * (subset_radius_x + 1); //the last dimension of data is halved in r2c transform
 		unsigned int subset_size = width * height;
 
 		FFTW* FFTW_instance = new FFTW;
@@ -29,16 +122,15 @@ namespace opencorr
 		FFTW_instance->tar_freq = (fftwf_complex*)fftw_malloc(sizeof(fftwf_complex) * buffer_length);
 		FFTW_instance->zncc_freq = (fftwf_complex*)fftw_malloc(sizeof(fftwf_complex) * buffer_length);
 
-		FFTW_instance->ref_subset = new float[subset_size];
-		FFTW_instance->tar_subset = new float[subset_size];
-		FFTW_instance->zncc = new float[subset_size];
+		FFTW_instance->ref_subset = (float*)fftw_malloc(sizeof(float) * subset_size);
+		FFTW_instance->tar_subset = (float*)fftw_malloc(sizeof(float) * subset_size);
+		FFTW_instance->zncc = (float*)fftw_malloc(sizeof(float) * subset_size);
 
-#pragma omp critical 
-		{
-			FFTW_instance->ref_plan = fftwf_plan_dft_r2c_2d(width, height, FFTW_instance->ref_subset, FFTW_instance->ref_freq, FFTW_ESTIMATE);
-			FFTW_instance->tar_plan = fftwf_plan_dft_r2c_2d(width, height, FFTW_instance->tar_subset, FFTW_instance->tar_freq, FFTW_ESTIMATE);
-			FFTW_instance->zncc_plan = fftwf_plan_dft_c2r_2d(width, height, FFTW_instance->zncc_freq, FFTW_instance->zncc, FFTW_ESTIMATE);
-		}
+		//the plans are shared by the instances of the same size, and executed on the arrays of each instance
+		std::vector<int> dimension = { height, width };
+		FFTW_instance->ref_plan = FFTWPlanCache::getPlan(true, dimension, 1);
+		FFTW_instance->tar_plan = FFTW_instance->ref_plan;
+		FFTW_instance->zncc_plan = FFTWPlanCache::getPlan(false, dimension, 1);
 
 		return FFTW_instance;
 	}
@@ -48,7 +140,7 @@ namespace opencorr
 		int dim_x = 2 * subset_radius_x;
 		int dim_y = 2 * subset_radius_y;
 		int dim_z = 2 * subset_radius_z;
-		int buffer_length = dim_x * dim_y * (subset_radius_z + 1);
+		int buffer_length = dim_z * dim_y * (subset_radius_x + 1);
 		unsigned int subset_size = dim_x * dim_y * dim_z;
 
 		FFTW* FFTW_instance = new FFTW;
@@ -57,31 +149,27 @@ namespace opencorr
 		FFTW_instance->tar_freq = (fftwf_complex*)fftw_malloc(sizeof(fftwf_complex) * buffer_length);
 		FFTW_instance->zncc_freq = (fftwf_complex*)fftw_malloc(sizeof(fftwf_complex) * buffer_length);
 
-		FFTW_instance->ref_subset = new float[subset_size];
-		FFTW_instance->tar_subset = new float[subset_size];
-		FFTW_instance->zncc = new float[subset_size];
+		FFTW_instance->ref_subset = (float*)fftw_malloc(sizeof(float) * subset_size);
+		FFTW_instance->tar_subset = (float*)fftw_malloc(sizeof(float) * subset_size);
+		FFTW_instance->zncc = (float*)fftw_malloc(sizeof(float) * subset_size);
 
-#pragma omp critical 
-		{
-			FFTW_instance->ref_plan = fftwf_plan_dft_r2c_3d(dim_x, dim_y, dim_z, FFTW_instance->ref_subset, FFTW_instance->ref_freq, FFTW_ESTIMATE);
-			FFTW_instance->tar_plan = fftwf_plan_dft_r2c_3d(dim_x, dim_y, dim_z, FFTW_instance->tar_subset, FFTW_instance->tar_freq, FFTW_ESTIMATE);
-			FFTW_instance->zncc_plan = fftwf_plan_dft_c2r_3d(dim_x, dim_y, dim_z, FFTW_instance->zncc_freq, FFTW_instance->zncc, FFTW_ESTIMATE);
-		}
+		//the plans are shared by the instances of the same size, and executed on the arrays of each instance
+		std::vector<int> dimension = { dim_z, dim_y, dim_x };
+		FFTW_instance->ref_plan = FFTWPlanCache::getPlan(true, dimension, 1);
+		FFTW_instance->tar_plan = FFTW_instance->ref_plan;
+		FFTW_instance->zncc_plan = FFTWPlanCache::getPlan(false, dimension, 1);
 
 		return FFTW_instance;
 	}
 
 	void FFTW::release(FFTW* instance)
 	{
-		delete[] instance->ref_subset;
-		delete[] instance->tar_subset;
-		delete[] instance->zncc;
+		fftw_free(instance->ref_subset);
+		fftw_free(instance->tar_subset);
+		fftw_free(instance->zncc);
 		fftw_free(instance->ref_freq);
 		fftw_free(instance->tar_freq);
 		fftw_free(instance->zncc_freq);
-		fftwf_destroy_plan(instance->ref_plan);
-		fftwf_destroy_plan(instance->tar_plan);
-		fftwf_destroy_plan(instance->zncc_plan);
 	}
 
 	void FFTW::reallocate(FFTW* instance, int subset_radius_x, int subset_radius_y)
@@ -90,23 +178,22 @@ namespace opencorr
 
 		int width = 2 * subset_radius_x;
 		int height = 2 * subset_radius_y;
-		int buffer_length = width * (subset_radius_y + 1);
+		int buffer_length = height * (subset_radius_x + 1); //the last dimension of data is halved in r2c transform
 		unsigned int subset_size = width * height;
 
 		instance->ref_freq = (fftwf_complex*)fftw_malloc(sizeof(fftwf_complex) * buffer_length);
 		instance->tar_freq = (fftwf_complex*)fftw_malloc(sizeof(fftwf_complex) * buffer_length);
 		instance->zncc_freq = (fftwf_complex*)fftw_malloc(sizeof(fftwf_complex) * buffer_length);
 
-		instance->ref_subset = new float[subset_size];
-		instance->tar_subset = new float[subset_size];
-		instance->zncc = new float[subset_size];
+		instance->ref_subset = (float*)fftw_malloc(sizeof(float) * subset_size);
+		instance->tar_subset = (float*)fftw_malloc(sizeof(float) * subset_size);
+		instance->zncc = (float*)fftw_malloc(sizeof(float) * subset_size);
 
-#pragma omp critical 
-		{
-			instance->ref_plan = fftwf_plan_dft_r2c_2d(width, height, instance->ref_subset, instance->ref_freq, FFTW_ESTIMATE);
-			instance->tar_plan = fftwf_plan_dft_r2c_2d(width, height, instance->tar_subset, instance->tar_freq, FFTW_ESTIMATE);
-			instance->zncc_plan = fftwf_plan_dft_c2r_2d(width, height, instance->zncc_freq, instance->zncc, FFTW_ESTIMATE);
-		}
+		//the plans are shared by the instances of the same size, and executed on the arrays of each instance
+		std::vector<int> dimension = { height, width };
+		instance->ref_plan = FFTWPlanCache::getPlan(true, dimension, 1);
+		instance->tar_plan = instance->ref_plan;
+		instance->zncc_plan = FFTWPlanCache::getPlan(false, dimension, 1);
 	}
 
 	void FFTW::reallocate(FFTW* instance, int subset_radius_x, int subset_radius_y, int subset_radius_z)
@@ -116,23 +203,285 @@ namespace opencorr
 		int dim_x = 2 * subset_radius_x;
 		int dim_y = 2 * subset_radius_y;
 		int dim_z = 2 * subset_radius_z;
-		int buffer_length = dim_x * dim_y * (subset_radius_z + 1);
+		int buffer_length = dim_z * dim_y * (subset_radius_x + 1);
 		unsigned int subset_size = dim_x * dim_y * dim_z;
 
 		instance->ref_freq = (fftwf_complex*)fftw_malloc(sizeof(fftwf_complex) * buffer_length);
 		instance->tar_freq = (fftwf_complex*)fftw_malloc(sizeof(fftwf_complex) * buffer_length);
 		instance->zncc_freq = (fftwf_complex*)fftw_malloc(sizeof(fftwf_complex) * buffer_length);
 
-		instance->ref_subset = new float[subset_size];
-		instance->tar_subset = new float[subset_size];
-		instance->zncc = new float[subset_size];
+		instance->ref_subset = (float*)fftw_malloc(sizeof(float) * subset_size);
+		instance->tar_subset = (float*)fftw_malloc(sizeof(float) * subset_size);
+		instance->zncc = (float*)fftw_malloc(sizeof(float) * subset_size);
+
+		//the plans are shared by the instances of the same size, and executed on the arrays of each instance
+		std::vector<int> dimension = { dim_z, dim_y, dim_x };
+		instance->ref_plan = FFTWPlanCache::getPlan(true, dimension, 1);
+		instance->tar_plan = instance->ref_plan;
+		instance->zncc_plan = FFTWPlanCache::getPlan(false, dimension, 1);
+	}
+
+	FFTWBatch* FFTWBatch::allocate(int subset_radius_x, int subset_radius_y, int batch_size)
+	{
+		int width = 2 * subset_radius_x;
+		int height = 2 * subset_radius_y;
+		int buffer_length = height * (subset_radius_x + 1);
+		int subset_size = width * height;
+
+		FFTWBatch* FFTW_instance = new FFTWBatch;
+		FFTW_instance->batch_size = batch_size;
+
+		FFTW_instance->ref_freq = (fftwf_complex*)fftw_malloc(sizeof(fftwf_complex) * buffer_length * batch_size);
+		FFTW_instance->tar_freq = (fftwf_complex*)fftw_malloc(sizeof(fftwf_complex) * buffer_length * batch_size);
+		FFTW_instance->zncc_freq = (fftwf_complex*)fftw_malloc(sizeof(fftwf_complex) * buffer_length * batch_size);
+
+		FFTW_instance->ref_subset = (float*)fftw_malloc(sizeof(float) * subset_size * batch_size);
+		FFTW_instance->tar_subset = (float*)fftw_malloc(sizeof(float) * subset_size * batch_size);
+		FFTW_instance->zncc = (float*)fftw_malloc(sizeof(float) * subset_size * batch_size);
+
+		//the plans are shared by the instances of the same size, and executed on the arrays of each instance
+		std::vector<int> dimension = { height, width };
+		FFTW_instance->ref_plan = FFTWPlanCache::getPlan(true, dimension, batch_size);
+		FFTW_instance->tar_plan = FFTW_instance->ref_plan;
+		FFTW_instance->zncc_plan = FFTWPlanCache::getPlan(false, dimension, batch_size);
+
+		return FFTW_instance;
+	}
+
+	void FFTWBatch::release(FFTWBatch* instance)
+	{
+		fftw_free(instance->ref_subset);
+		fftw_free(instance->tar_subset);
+		fftw_free(instance->zncc);
+		fftw_free(instance->ref_freq);
+		fftw_free(instance->tar_freq);
+		fftw_free(instance->zncc_freq);
+	}
+
+	//integral images of grayscale and squared grayscale, led by a row and a column of zeros
+	void getIntegralImage(const RowMatrixXf& image, RowMatrixXd& sum, RowMatrixXd& squared_sum)
+	{
+		int height = (int)image.rows();
+		int width = (int)image.cols();
+		sum = RowMatrixXd::Zero(height + 1, width + 1);
+		squared_sum = RowMatrixXd::Zero(height + 1, width + 1);
+
+#pragma omp parallel for
+		for (int r = 0; r < height; r++)
+		{
+			double row_sum = 0;
+			double row_squared_sum = 0;
+			for (int c = 0; c < width; c++)
+			{
+				double value = image(r, c);
+				row_sum += value;
+				row_squared_sum += value * value;
+				sum(r + 1, c + 1) = row_sum;
+				squared_sum(r + 1, c + 1) = row_squared_sum;
+			}
+		}
+
+		//accumulate along y-axis, the columns are processed in blocks to keep the access continuous
+		int block_width = 64;
+		int block_number = (width + block_width) / block_width;
+#pragma omp parallel for
+		for (int i = 0; i < block_number; i++)
+		{
+			int column_begin = i * block_width;
+			int column_end = std::min(column_begin + block_width, width + 1);
+			for (int r = 1; r <= height; r++)
+			{
+				for (int c = column_begin; c < column_end; c++)
+				{
+					sum(r, c) += sum(r - 1, c);
+					squared_sum(r, c) += squared_sum(r - 1, c);
+				}
+			}
+		}
+	}
+
+	//sum over the rectangle of which the upper left corner is (x, y)
+	inline double getRegionSum(const RowMatrixXd& integral, int x, int y, int width, int height)
+	{
+		return integral(y + height, x + width) - integral(y, x + width) - integral(y + height, x) + integral(y, x);
+	}
+
+	//sub-pixel offset of peak along an axis, estimated with the values at the peak and its two neighbors
+	float fitPeak(float left, float center, float right, PeakFit peak_fit)
+	{
+		if (peak_fit == PeakFit::gaussian && left > 0 && center > 0 && right > 0)
+		{
+			left = log(left);
+			center = log(center);
+			right = log(right);
+		}
+
+		float denominator = left - 2 * center + right;
+		if (denominator >= 0)
+		{
+			return 0;
+		}
+
+		float offset = 0.5f * (left - right) / denominator;
+		return std::max(-0.5f, std::min(0.5f, offset));
+	}
+
+	//sharpness of peak along an axis, i.e. its curvature normalized by the peak value, which is 1 for a single-pixel peak
+	//and approaches 0 for a flat one
+	float getSharpness(float left, float center, float right)
+	{
+		if (center <= 0)
+		{
+			return 0;
+		}
+
+		return std::max(0.f, std::min(1.f, (2 * center - left - right) / (2 * center)));
+	}
+
+	//refine the location (x, y) of peak in a periodic correlation map, return the sharpness of peak in the worst direction
+	float refinePeak(const float* zncc, int width, int height, int x, int y, PeakFit peak_fit, float& dx, float& dy)
+	{
+		//the neighbors wrap around the borders of map
+		float neighbor[3][3];
+		for (int r = 0; r < 3; r++)
+		{
+			int row = (y + height - 1 + r) % height;
+			for (int c = 0; c < 3; c++)
+			{
+				int col = (x + width - 1 + c) % width;
+				neighbor[r][c] = zncc[row * width + col];
+			}
+		}
+
+		dx = 0;
+		dy = 0;
+		bool surface_fitted = false;
+		if (peak_fit == PeakFit::quadratic)
+		{
+			//least-squares fit of f = a + b*x + c*y + d*x^2 + e*x*y + g*y^2, the terms are orthogonal over the 3x3 grid
+			float b = 0, c = 0, d = 0, e = 0, g = 0;
+			for (int r = 0; r < 3; r++)
+			{
+				for (int col = 0; col < 3; col++)
+				{
+					float px = (float)(col - 1);
+					float py = (float)(r - 1);
+					float value = neighbor[r][col];
+					b += px * value;
+					c += py * value;
+					d += (px * px - 2.f / 3.f) * value;
+					e += px * py * value;
+					g += (py * py - 2.f / 3.f) * value;
+				}
+			}
+			b /= 6;
+			c /= 6;
+			d /= 2;
+			e /= 4;
+			g /= 2;
+
+			//the stationary point is a maximum if the Hessian is negative definite
+			float determinant = 4 * d * g - e * e;
+			if (d < 0 && determinant > 0)
+			{
+				dx = std::max(-0.5f, std::min(0.5f, (e * c - 2 * g * b) / determinant));
+				dy = std::max(-0.5f, std::min(0.5f, (e * b - 2 * d * c) / determinant));
+				surface_fitted = true;
+			}
+		}
+
+		if (peak_fit != PeakFit::none && !surface_fitted)
+		{
+			dx = fitPeak(neighbor[1][0], neighbor[1][1], neighbor[1][2], peak_fit);
+			dy = fitPeak(neighbor[0][1], neighbor[1][1], neighbor[2][1], peak_fit);
+		}
+
+		return std::min(getSharpness(neighbor[1][0], neighbor[1][1], neighbor[1][2]),
+			getSharpness(neighbor[0][1], neighbor[1][1], neighbor[2][1]));
+	}
+
+	//refine the location (x, y, z) of peak in a periodic correlation map, return the sharpness of peak in the worst direction
+	float refinePeak(const float* zncc, int dim_x, int dim_y, int dim_z, int x, int y, int z, PeakFit peak_fit, float& dx, float& dy, float& dz)
+	{
+		float neighbor[3][3][3];
+		for (int i = 0; i < 3; i++)
+		{
+			int page = (z + dim_z - 1 + i) % dim_z;
+			for (int j = 0; j < 3; j++)
+			{
+				int row = (y + dim_y - 1 + j) % dim_y;
+				for (int k = 0; k < 3; k++)
+				{
+					int col = (x + dim_x - 1 + k) % dim_x;
+					neighbor[i][j][k] = zncc[((size_t)page * dim_y + row) * dim_x + col];
+				}
+			}
+		}
+
+		dx = 0;
+		dy = 0;
+		dz = 0;
+		bool surface_fitted = false;
+		if (peak_fit == PeakFit::quadratic)
+		{
+			//least-squares fit of quadratic surface, the terms are orthogonal over the 3x3x3 grid
+			Eigen::Vector3f gradient = Eigen::Vector3f::Zero();
+			Eigen::Matrix3f hessian = Eigen::Matrix3f::Zero();
+			for (int i = 0; i < 3; i++)
+			{
+				for (int j = 0; j < 3; j++)
+				{
+					for (int k = 0; k < 3; k++)
+					{
+						Eigen::Vector3f point((float)(k - 1), (float)(j - 1), (float)(i - 1));
+						float value = neighbor[i][j][k];
+						gradient += point * value;
+						for (int m = 0; m < 3; m++)
+						{
+							hessian(m, m) += (point(m) * point(m) - 2.f / 3.f) * value;
+							for (int n = m + 1; n < 3; n++)
+							{
+								hessian(m, n) += point(m) * point(n) * value;
+							}
+						}
+					}
+				}
+			}
+
+			//convert the coefficients to the gradient and Hessian at the center
+			gradient /= 18;
+			for (int m = 0; m < 3; m++)
+			{
+				hessian(m, m) /= 3; //twice the coefficient of quadratic term
+				for (int n = m + 1; n < 3; n++)
+				{
+					hessian(m, n) /= 12;
+					hessian(n, m) = hessian(m, n);
+				}
+			}
+
+			//the stationary point is a maximum if the Hessian is negative definite
+			Eigen::LLT<Eigen::Matrix3f> llt(-hessian);
+			if (llt.info() == Eigen::Success)
+			{
+				Eigen::Vector3f offset = llt.solve(gradient);
+				dx = std::max(-0.5f, std::min(0.5f, offset(0)));
+				dy = std::max(-0.5f, std::min(0.5f, offset(1)));
+				dz = std::max(-0.5f, std::min(0.5f, offset(2)));
+				surface_fitted = true;
+			}
+		}
 
-#pragma omp critical 
+		if (peak_fit != PeakFit::none && !surface_fitted)
 		{
-			instance->ref_plan = fftwf_plan_dft_r2c_3d(dim_x, dim_y, dim_z, instance->ref_subset, instance->ref_freq, FFTW_ESTIMATE);
-			instance->tar_plan = fftwf_plan_dft_r2c_3d(dim_x, dim_y, dim_z, instance->tar_subset, instance->tar_freq, FFTW_ESTIMATE);
-			instance->zncc_plan = fftwf_plan_dft_c2r_3d(dim_x, dim_y, dim_z, instance->zncc_freq, instance->zncc, FFTW_ESTIMATE);
+			dx = fitPeak(neighbor[1][1][0], neighbor[1][1][1], neighbor[1][1][2], peak_fit);
+			dy = fitPeak(neighbor[1][0][1], neighbor[1][1][1], neighbor[1][2][1], peak_fit);
+			dz = fitPeak(neighbor[0][1][1], neighbor[1][1][1], neighbor[2][1][1], peak_fit);
 		}
+
+		float sharpness = getSharpness(neighbor[1][1][0], neighbor[1][1][1], neighbor[1][1][2]);
+		sharpness = std::min(sharpness, getSharpness(neighbor[1][0][1], neighbor[1][1][1], neighbor[1][2][1]));
+		return std::min(sharpness, getSharpness(neighbor[0][1][1], neighbor[1][1][1], neighbor[2][1][1]));
 	}
 
 	//FFT accelerated cross correlation 2D
@@ -141,46 +490,67 @@ namespace opencorr
 		this->subset_radius_x = subset_radius_x;
 		this->subset_radius_y = subset_radius_y;
 		this->thread_number = thread_number;
+		batch_size = 0;
+		peak_fit = PeakFit::none;
+		specialized_kernel = true;
 
 		for (int i = 0; i < thread_number; i++)
 		{
 			FFTW* instance = FFTW::allocate(subset_radius_x, subset_radius_y);
-			instance_pool.push_back(instance);
+			instance_pool.addFree(instance);
 		}
 	}
 
 	FFTCC2D::~FFTCC2D()
 	{
-		for (auto& instance : instance_pool)
+		for (auto& instance : instance_pool.getWorkspaces())
 		{
 			FFTW::release(instance);
 			delete instance;
 		}
 		instance_pool.clear();
+
+		for (auto& instance : batch_pool.getWorkspaces())
+		{
+			FFTWBatch::release(instance);
+			delete instance;
+		}
+		batch_pool.clear();
 	}
 
-	FFTW* FFTCC2D::getInstance(int tid)
+	FFTW* FFTCC2D::getInstance()
 	{
-		if (tid >= (int)instance_pool.size())
+		FFTW* instance = instance_pool.acquire();
+		if (instance == nullptr)
 		{
-			std::cerr << "CPU thread ID over limit" << std::endl;
+			instance = FFTW::allocate(subset_radius_x, subset_radius_y);
+			instance_pool.add(instance);
 		}
 
-		return instance_pool[tid];
+		return instance;
 	}
 
-	void FFTCC2D::compute(POI2D* poi)
+	//FFT-CC at a POI, the subset dimension is fixed at compile time if RX > 0 and RY > 0, otherwise it is given at
+	//runtime. the former gives constant trip counts to the loops of filling subsets, combining spectra and peak search
+	template <int RX, int RY>
+	void correlateSubsets(FFTW* current_instance, Image2D* ref_img, Image2D* tar_img, POI2D* poi,
+		int radius_x, int radius_y, PeakFit peak_fit)
 	{
-		//set instance w.r.t. thread id 
-		FFTW* current_instance = getInstance(omp_get_thread_num());
-
-		int subset_width = subset_radius_x * 2;
-		int subset_height = subset_radius_y * 2;
-		int subset_size = subset_width * subset_height;
+		const int subset_radius_x = RX > 0 ? RX : radius_x;
+		const int subset_radius_y = RY > 0 ? RY : radius_y;
+		const int subset_width = subset_radius_x * 2;
+		const int subset_height = subset_radius_y * 2;
+		const int subset_size = subset_width * subset_height;
 
 		//set initial guess of displacement
 		Point2D initial_displacement(poi->deformation.u, poi->deformation.v);
 
+		//the subsets are copied row by row from their top-left corners
+		int ref_x = (int)std::floor(poi->x - subset_radius_x);
+		int ref_y = (int)std::floor(poi->y - subset_radius_y);
+		int tar_x = (int)std::floor(poi->x - subset_radius_x + initial_displacement.x);
+		int tar_y = (int)std::floor(poi->y - subset_radius_y + initial_displacement.y);
+
 		//initialize mean and norm in subsets
 		float ref_mean = 0;
 		float tar_mean = 0;
@@ -189,19 +559,16 @@ namespace opencorr
 
 		for (int r = 0; r < subset_height; r++)
 		{
+			const float* ref_row = &ref_img->eg_mat(ref_y + r, ref_x);
+			const float* tar_row = &tar_img->eg_mat(tar_y + r, tar_x);
+			float* ref_subset = current_instance->ref_subset + r * subset_width;
+			float* tar_subset = current_instance->tar_subset + r * subset_width;
 			for (int c = 0; c < subset_width; c++)
 			{
-				//fill reference subset
-				Point2D ref_point(poi->x + c - subset_radius_x, poi->y + r - subset_radius_y);
-				float value = ref_img->eg_mat((int)ref_point.y, (int)ref_point.x);
-				current_instance->ref_subset[r * subset_width + c] = value;
-				ref_mean += value;
-
-				//fill the target subset with initial guess of displacement
-				Point2D tar_point = ref_point + initial_displacement;
-				value = tar_img->eg_mat((int)tar_point.y, (int)tar_point.x);
-				current_instance->tar_subset[r * subset_width + c] = value;
-				tar_mean += value;
+				ref_subset[c] = ref_row[c];
+				tar_subset[c] = tar_row[c];
+				ref_mean += ref_row[c];
+				tar_mean += tar_row[c];
 			}
 		}
 		ref_mean /= subset_size;
@@ -216,10 +583,10 @@ namespace opencorr
 			tar_norm += current_instance->tar_subset[i] * current_instance->tar_subset[i];
 		}
 
-		fftwf_execute(current_instance->ref_plan);
-		fftwf_execute(current_instance->tar_plan);
+		fftwf_execute_dft_r2c(current_instance->ref_plan, current_instance->ref_subset, current_instance->ref_freq);
+		fftwf_execute_dft_r2c(current_instance->tar_plan, current_instance->tar_subset, current_instance->tar_freq);
 
-		int buffer_length = subset_width * (subset_radius_y + 1);
+		int buffer_length = subset_height * (subset_radius_x + 1);
 		for (int n = 0; n < buffer_length; n++)
 		{
 			current_instance->zncc_freq[n][0] = (current_instance->ref_freq[n][0] * current_instance->tar_freq[n][0])
@@ -228,7 +595,7 @@ namespace opencorr
 				- (current_instance->ref_freq[n][1] * current_instance->tar_freq[n][0]);
 		}
 
-		fftwf_execute(current_instance->zncc_plan);
+		fftwf_execute_dft_c2r(current_instance->zncc_plan, current_instance->zncc_freq, current_instance->zncc);
 
 		//search for max ZCC
 		float max_zncc = -2;
@@ -244,6 +611,10 @@ namespace opencorr
 		int local_displacement_u = max_zncc_index % subset_width;
 		int local_displacement_v = max_zncc_index / subset_width;
 
+		float subpixel_u, subpixel_v;
+		float sharpness = refinePeak(current_instance->zncc, subset_width, subset_height,
+			local_displacement_u, local_displacement_v, peak_fit, subpixel_u, subpixel_v);
+
 		if (local_displacement_u > subset_radius_x)
 		{
 			local_displacement_u -= subset_width;
@@ -254,21 +625,240 @@ namespace opencorr
 		}
 
 		//store the final results
-		poi->deformation.u = (float)local_displacement_u + initial_displacement.x;
-		poi->deformation.v = (float)local_displacement_v + initial_displacement.y;
+		poi->deformation.u = (float)local_displacement_u + subpixel_u + initial_displacement.x;
+		poi->deformation.v = (float)local_displacement_v + subpixel_v + initial_displacement.y;
 
 		poi->result.u0 = initial_displacement.x;
 		poi->result.v0 = initial_displacement.y;
 		poi->result.zncc = max_zncc / (sqrt(ref_norm * tar_norm) * subset_size); //convert ZCC to ZNCC
+		poi->result.feature = sharpness;
 	}
 
-	void FFTCC2D::compute(std::vector<POI2D>& poi_queue)
+	void FFTCC2D::compute(POI2D* poi)
 	{
+		//get a free instance from pool
+		FFTW* current_instance = getInstance();
+
+		//the kernels of fixed subset dimension are used for the common radii of square subsets
+		int fixed_radius = specialized_kernel && subset_radius_x == subset_radius_y ? subset_radius_x : 0;
+		switch (fixed_radius)
+		{
+		case 15:
+			correlateSubsets<15, 15>(current_instance, ref_img, tar_img, poi, subset_radius_x, subset_radius_y, peak_fit);
+			break;
+		case 16:
+			correlateSubsets<16, 16>(current_instance, ref_img, tar_img, poi, subset_radius_x, subset_radius_y, peak_fit);
+			break;
+		case 20:
+			correlateSubsets<20, 20>(current_instance, ref_img, tar_img, poi, subset_radius_x, subset_radius_y, peak_fit);
+			break;
+		case 30:
+			correlateSubsets<30, 30>(current_instance, ref_img, tar_img, poi, subset_radius_x, subset_radius_y, peak_fit);
+			break;
+		default:
+			correlateSubsets<0, 0>(current_instance, ref_img, tar_img, poi, subset_radius_x, subset_radius_y, peak_fit);
+			break;
+		}
+
+		//return the instance to pool
+		instance_pool.release(current_instance);
+	}
+
+	void FFTCC2D::setBatchSize(int batch_size)
+	{
+		if (batch_size < 0)
+		{
+			batch_size = 0;
+		}
+		if (batch_size == this->batch_size)
+		{
+			return;
+		}
+
+		//the plans of batch instances depend on the batch size
+		for (auto& instance : batch_pool.getWorkspaces())
+		{
+			FFTWBatch::release(instance);
+			delete instance;
+		}
+		batch_pool.clear();
+
+		this->batch_size = batch_size;
+	}
+
+	FFTWBatch* FFTCC2D::getBatchInstance()
+	{
+		FFTWBatch* instance = batch_pool.acquire();
+		if (instance == nullptr)
+		{
+			instance = FFTWBatch::allocate(subset_radius_x, subset_radius_y, batch_size);
+			batch_pool.add(instance);
+		}
+
+		return instance;
+	}
+
+	void FFTCC2D::computeBatch(std::vector<POI2D>& poi_queue)
+	{
+		int subset_width = subset_radius_x * 2;
+		int subset_height = subset_radius_y * 2;
+		int subset_size = subset_width * subset_height;
+		int buffer_length = subset_height * (subset_radius_x + 1);
+
+		//the means and norms of all the subsets are obtained from integral images
+		RowMatrixXd ref_sum, ref_squared_sum, tar_sum, tar_squared_sum;
+		getIntegralImage(ref_img->eg_mat, ref_sum, ref_squared_sum);
+		getIntegralImage(tar_img->eg_mat, tar_sum, tar_squared_sum);
+
 		int queue_length = (int)poi_queue.size();
-#pragma omp parallel for
-		for (int i = 0; i < queue_length; i++)
+		int batch_number = (queue_length + batch_size - 1) / batch_size;
+
+#pragma omp parallel for schedule(dynamic)
+		for (int b = 0; b < batch_number; b++)
 		{
-			compute(&poi_queue[i]);
+			FFTWBatch* current_instance = getBatchInstance();
+			int batch_begin = b * batch_size;
+			int batch_length = std::min(batch_size, queue_length - batch_begin);
+
+			std::vector<int> outside_poi; //POIs of which the subsets are not fully inside the images
+			std::vector<float> ref_norm(batch_size, 0.f), tar_norm(batch_size, 0.f);
+			std::vector<bool> in_batch(batch_size, false);
+
+			//fill the zero-mean subsets, the slots without POI are left zero
+			for (int i = 0; i < batch_size; i++)
+			{
+				float* ref_subset = current_instance->ref_subset + (size_t)i * subset_size;
+				float* tar_subset = current_instance->tar_subset + (size_t)i * subset_size;
+				std::fill(ref_subset, ref_subset + subset_size, 0.f);
+				std::fill(tar_subset, tar_subset + subset_size, 0.f);
+				if (i >= batch_length)
+				{
+					continue;
+				}
+
+				POI2D* poi = &poi_queue[batch_begin + i];
+				if (std::isnan(poi->deformation.u) || std::isnan(poi->deformation.v))
+				{
+					outside_poi.push_back(batch_begin + i);
+					continue;
+				}
+
+				int ref_x = (int)std::floor(poi->x - subset_radius_x);
+				int ref_y = (int)std::floor(poi->y - subset_radius_y);
+				int tar_x = (int)std::floor(poi->x - subset_radius_x + poi->deformation.u);
+				int tar_y = (int)std::floor(poi->y - subset_radius_y + poi->deformation.v);
+				if (ref_x < 0 || ref_y < 0 || ref_x + subset_width > ref_img->width || ref_y + subset_height > ref_img->height
+					|| tar_x < 0 || tar_y < 0 || tar_x + subset_width > tar_img->width || tar_y + subset_height > tar_img->height)
+				{
+					outside_poi.push_back(batch_begin + i);
+					continue;
+				}
+
+				double ref_mean = getRegionSum(ref_sum, ref_x, ref_y, subset_width, subset_height) / subset_size;
+				double tar_mean = getRegionSum(tar_sum, tar_x, tar_y, subset_width, subset_height) / subset_size;
+				ref_norm[i] = (float)std::max(getRegionSum(ref_squared_sum, ref_x, ref_y, subset_width, subset_height) - ref_mean * ref_mean * subset_size, 0.);
+				tar_norm[i] = (float)std::max(getRegionSum(tar_squared_sum, tar_x, tar_y, subset_width, subset_height) - tar_mean * tar_mean * subset_size, 0.);
+
+				for (int r = 0; r < subset_height; r++)
+				{
+					const float* ref_row = &ref_img->eg_mat(ref_y + r, ref_x);
+					const float* tar_row = &tar_img->eg_mat(tar_y + r, tar_x);
+					for (int c = 0; c < subset_width; c++)
+					{
+						ref_subset[r * subset_width + c] = ref_row[c] - (float)ref_mean;
+						tar_subset[r * subset_width + c] = tar_row[c] - (float)tar_mean;
+					}
+				}
+				in_batch[i] = true;
+			}
+
+			fftwf_execute_dft_r2c(current_instance->ref_plan, current_instance->ref_subset, current_instance->ref_freq);
+			fftwf_execute_dft_r2c(current_instance->tar_plan, current_instance->tar_subset, current_instance->tar_freq);
+
+			long long batch_buffer_length = (long long)buffer_length * batch_size;
+			for (long long n = 0; n < batch_buffer_length; n++)
+			{
+				current_instance->zncc_freq[n][0] = (current_instance->ref_freq[n][0] * current_instance->tar_freq[n][0])
+					+ (current_instance->ref_freq[n][1] * current_instance->tar_freq[n][1]);
+				current_instance->zncc_freq[n][1] = (current_instance->ref_freq[n][0] * current_instance->tar_freq[n][1])
+					- (current_instance->ref_freq[n][1] * current_instance->tar_freq[n][0]);
+			}
+
+			fftwf_execute_dft_c2r(current_instance->zncc_plan, current_instance->zncc_freq, current_instance->zncc);
+
+			//search for max ZCC of each subset and store the results in queue
+			for (int i = 0; i < batch_length; i++)
+			{
+				if (!in_batch[i])
+				{
+					continue;
+				}
+
+				const float* zncc = current_instance->zncc + (size_t)i * subset_size;
+				float max_zncc = -2;
+				int max_zncc_index = 0;
+				for (int j = 0; j < subset_size; j++)
+				{
+					if (zncc[j] > max_zncc)
+					{
+						max_zncc = zncc[j];
+						max_zncc_index = j;
+					}
+				}
+				int local_displacement_u = max_zncc_index % subset_width;
+				int local_displacement_v = max_zncc_index / subset_width;
+
+				float subpixel_u, subpixel_v;
+				float sharpness = refinePeak(zncc, subset_width, subset_height,
+					local_displacement_u, local_displacement_v, peak_fit, subpixel_u, subpixel_v);
+
+				if (local_displacement_u > subset_radius_x)
+				{
+					local_displacement_u -= subset_width;
+				}
+				if (local_displacement_v > subset_radius_y)
+				{
+					local_displacement_v -= subset_height;
+				}
+
+				POI2D* poi = &poi_queue[batch_begin + i];
+				poi->result.u0 = poi->deformation.u;
+				poi->result.v0 = poi->deformation.v;
+				poi->deformation.u += (float)local_displacement_u + subpixel_u;
+				poi->deformation.v += (float)local_displacement_v + subpixel_v;
+				poi->result.zncc = max_zncc / (sqrt(ref_norm[i] * tar_norm[i]) * subset_size); //convert ZCC to ZNCC
+				poi->result.feature = sharpness;
+			}
+
+			batch_pool.release(current_instance);
+
+			//the POIs near the borders are processed one by one
+			for (int idx : outside_poi)
+			{
+				compute(&poi_queue[idx]);
+			}
+		}
+	}
+
+	void FFTCC2D::setPeakFit(PeakFit peak_fit)
+	{
+		this->peak_fit = peak_fit;
+	}
+
+	void FFTCC2D::setSpecializedKernel(bool specialized_kernel)
+	{
+		this->specialized_kernel = specialized_kernel;
+	}
+
+	void FFTCC2D::compute(std::vector<POI2D>& poi_queue)
+	{
+		if (batch_size > 0)
+		{
+			computeBatch(poi_queue);
+		}
+		else
+		{
+			computeQueue(poi_queue);
 		}
 	}
 
@@ -281,17 +871,18 @@ namespace opencorr
 		this->subset_radius_y = subset_radius_y;
 		this->subset_radius_z = subset_radius_z;
 		this->thread_number = thread_number;
+		peak_fit = PeakFit::none;
 
 		for (int i = 0; i < thread_number; i++)
 		{
 			FFTW* instance = FFTW::allocate(subset_radius_x, subset_radius_y, subset_radius_z);
-			instance_pool.push_back(instance);
+			instance_pool.addFree(instance);
 		}
 	}
 
 	FFTCC3D::~FFTCC3D()
 	{
-		for (auto& instance : instance_pool)
+		for (auto& instance : instance_pool.getWorkspaces())
 		{
 			FFTW::release(instance);
 			delete instance;
@@ -299,20 +890,22 @@ namespace opencorr
 		instance_pool.clear();
 	}
 
-	FFTW* FFTCC3D::getInstance(int tid)
+	FFTW* FFTCC3D::getInstance()
 	{
-		if (tid >= (int)instance_pool.size())
+		FFTW* instance = instance_pool.acquire();
+		if (instance == nullptr)
 		{
-			std::cerr << "CPU thread ID over limit" << std::endl;
+			instance = FFTW::allocate(subset_radius_x, subset_radius_y, subset_radius_z);
+			instance_pool.add(instance);
 		}
 
-		return instance_pool[tid];
+		return instance;
 	}
 
 	void FFTCC3D::compute(POI3D* poi)
 	{
-		//set instance w.r.t. thread id 
-		FFTW* current_instance = getInstance(omp_get_thread_num());
+		//get a free instance from pool
+		FFTW* current_instance = getInstance();
 
 		int subset_dim_x = subset_radius_x * 2;
 		int subset_dim_y = subset_radius_y * 2;
@@ -328,6 +921,8 @@ namespace opencorr
 		float ref_norm = 0;
 		float tar_norm = 0;
 
+		VolumeView ref_view = ref_img->getView();
+		VolumeView tar_view = tar_img->getView();
 		for (int i = 0; i < subset_dim_z; i++)
 		{
 			for (int j = 0; j < subset_dim_y; j++)
@@ -336,13 +931,13 @@ namespace opencorr
 				{
 					//fill the reference subset
 					Point3D ref_point(poi->x + k - subset_radius_x, poi->y + j - subset_radius_y, poi->z + i - subset_radius_z);
-					float value = ref_img->vol_mat[(int)ref_point.z][(int)ref_point.y][(int)ref_point.x];
+					float value = ref_view((int)ref_point.z, (int)ref_point.y, (int)ref_point.x);
 					current_instance->ref_subset[(i * subset_dim_y + j) * subset_dim_x + k] = value;
 					ref_mean += value;
 
 					//fill the target subset with initial guess of displacement
 					Point3D tar_point = ref_point + initial_displacement;
-					value = tar_img->vol_mat[(int)tar_point.z][(int)tar_point.y][(int)tar_point.x];
+					value = tar_view((int)tar_point.z, (int)tar_point.y, (int)tar_point.x);
 					current_instance->tar_subset[(i * subset_dim_y + j) * subset_dim_x + k] = value;
 					tar_mean += value;
 				}
@@ -360,10 +955,10 @@ namespace opencorr
 			tar_norm += current_instance->tar_subset[i] * current_instance->tar_subset[i];
 		}
 
-		fftwf_execute(current_instance->ref_plan);
-		fftwf_execute(current_instance->tar_plan);
+		fftwf_execute_dft_r2c(current_instance->ref_plan, current_instance->ref_subset, current_instance->ref_freq);
+		fftwf_execute_dft_r2c(current_instance->tar_plan, current_instance->tar_subset, current_instance->tar_freq);
 
-		unsigned int buffer_length = subset_dim_x * subset_dim_y * (subset_radius_z + 1);
+		unsigned int buffer_length = subset_dim_z * subset_dim_y * (subset_radius_x + 1);
 		for (unsigned int n = 0; n < buffer_length; n++)
 		{
 			current_instance->zncc_freq[n][0] = (current_instance->ref_freq[n][0] * current_instance->tar_freq[n][0])
@@ -372,7 +967,7 @@ namespace opencorr
 				- (current_instance->ref_freq[n][1] * current_instance->tar_freq[n][0]);
 		}
 
-		fftwf_execute(current_instance->zncc_plan);
+		fftwf_execute_dft_c2r(current_instance->zncc_plan, current_instance->zncc_freq, current_instance->zncc);
 
 		//search for max ZCC
 		float max_zncc = -2;
@@ -389,6 +984,10 @@ namespace opencorr
 		int local_displacement_v = (max_zncc_index / subset_dim_x) % subset_dim_y;
 		int local_displacement_w = max_zncc_index / (subset_dim_x * subset_dim_y);
 
+		float subpixel_u, subpixel_v, subpixel_w;
+		float sharpness = refinePeak(current_instance->zncc, subset_dim_x, subset_dim_y, subset_dim_z,
+			local_displacement_u, local_displacement_v, local_displacement_w, peak_fit, subpixel_u, subpixel_v, subpixel_w);
+
 		if (local_displacement_u > subset_radius_x)
 		{
 			local_displacement_u -= subset_dim_x;
@@ -403,24 +1002,28 @@ namespace opencorr
 		}
 
 		//store the final results
-		poi->deformation.u = (float)local_displacement_u + initial_displacement.x;
-		poi->deformation.v = (float)local_displacement_v + initial_displacement.y;
-		poi->deformation.w = (float)local_displacement_w + initial_displacement.z;
+		poi->deformation.u = (float)local_displacement_u + subpixel_u + initial_displacement.x;
+		poi->deformation.v = (float)local_displacement_v + subpixel_v + initial_displacement.y;
+		poi->deformation.w = (float)local_displacement_w + subpixel_w + initial_displacement.z;
 
 		poi->result.u0 = initial_displacement.x;
 		poi->result.v0 = initial_displacement.y;
 		poi->result.w0 = initial_displacement.z;
 		poi->result.zncc = max_zncc / (sqrt(ref_norm * tar_norm) * subset_size); //convert ZCC to ZNCC
+		poi->result.feature = sharpness;
+
+		//return the instance to pool
+		instance_pool.release(current_instance);
 	}
 
 	void FFTCC3D::compute(std::vector<POI3D>& poi_queue)
 	{
-		int queue_length = (int)poi_queue.size();
-#pragma omp parallel for
-		for (int i = 0; i < queue_length; i++)
-		{
-			compute(&poi_queue[i]);
-		}
+		computeQueue(poi_queue);
+	}
+
+	void FFTCC3D::setPeakFit(PeakFit peak_fit)
+	{
+		this->peak_fit = peak_fit;
 	}
 
 }//namespace opencorr
\ No newline at end of file
@@ -17,6 +17,9 @@
 #ifndef _FFTCC_H_
 #define _FFTCC_H_
 
+#include <map>
+#include <mutex>
+#include <string>
 #include <vector>
 #include "fftw3.h"
 
@@ -26,9 +29,33 @@
 #include "oc_poi.h"
 #include "oc_point.h"
 #include "oc_subset.h"
+#include "oc_workspace.h"
 
 namespace opencorr
 {
+	//process-wide cache of FFTW plans keyed by the shape of transform, shared by FFTCC2D and FFTCC3D. a plan is created
+	//once for all the threads and instances, and executed on the arrays of each instance through the new-array execute
+	//functions of FFTW, thus the arrays are allocated by fftw_malloc to keep the alignment. the wisdom of FFTW may be
+	//imported before and exported after the processing, so that the plans of FFTW_MEASURE quality are reused between runs
+	class FFTWPlanCache
+	{
+	private:
+		static std::mutex cache_mutex;
+		static std::map<std::vector<int>, fftwf_plan> plan_map;
+		static unsigned planner_flag;
+
+	public:
+		//get the plan of r2c (forward is true) or c2r transform of batch_size arrays, the dimensions are in row-major order
+		static fftwf_plan getPlan(bool forward, const std::vector<int>& dimension, int batch_size);
+
+		static void setPlanner(unsigned planner_flag); //FFTW_ESTIMATE by default, FFTW_MEASURE or FFTW_PATIENT for faster plans
+		static bool importWisdom(const std::string& file_path);
+		static bool exportWisdom(const std::string& file_path);
+
+		//destroy all the plans, to be called only when no FFTCC instance exists
+		static void clear();
+	};
+
 	class FFTW
 	{
 	public:
@@ -51,6 +78,34 @@ namespace opencorr
 		static void reallocate(FFTW* instance, int subset_radius_x, int subset_radius_y, int subset_radius_z);
 	};
 
+	//estimation of the sub-pixel location of correlation peak
+	enum class PeakFit
+	{
+		none, //integer location of the maximum
+		parabolic, //three-point parabolic fit along each axis
+		gaussian, //three-point Gaussian fit along each axis, parabolic one is used if any of the points is not positive
+		quadratic //least-squares quadratic surface over the 3x3 (3x3x3) neighborhood, parabolic fit is used if it has no maximum
+	};
+
+	//FFTW plans transforming a batch of 2D subsets in one execution, the subsets are stored one after another
+	class FFTWBatch
+	{
+	public:
+		int batch_size;
+		float* ref_subset;
+		float* tar_subset;
+		float* zncc;
+		fftwf_complex* ref_freq;
+		fftwf_complex* tar_freq;
+		fftwf_complex* zncc_freq;
+		fftwf_plan ref_plan;
+		fftwf_plan tar_plan;
+		fftwf_plan zncc_plan;
+
+		static FFTWBatch* allocate(int subset_radius_x, int subset_radius_y, int batch_size);
+		static void release(FFTWBatch* instance);
+	};
+
 
 	//the 2D part of module is the implementation of
 	//Z. Jiang et al, Optics and Lasers in Engineering (2015) 65: 93-102.
@@ -59,8 +114,17 @@ namespace opencorr
 	class FFTCC2D : public DIC
 	{
 	private:
-		std::vector<FFTW*> instance_pool; //pool of FFTW instances for multi-thread processing
-		FFTW* getInstance(int tid); //get an instance according to the number of current thread id
+		WorkspacePool<FFTW> instance_pool; //pool of FFTW instances for concurrent processing
+		FFTW* getInstance(); //get a free instance, a new one is allocated if none is free
+
+		int batch_size; //number of subsets transformed in one execution of FFTW plans, 0 for POI-wise processing
+		PeakFit peak_fit; //sub-pixel estimation of correlation peak
+		bool specialized_kernel; //use the kernels specialized at compile time for the common subset radii
+		WorkspacePool<FFTWBatch> batch_pool; //pool of batch instances for concurrent processing
+		FFTWBatch* getBatchInstance();
+
+		//process the queue in batches, the means and norms of subsets are obtained from integral images
+		void computeBatch(std::vector<POI2D>& poi_queue);
 
 	public:
 		FFTCC2D(int subset_radius_x, int subset_radius_y, int thread_number);
@@ -68,6 +132,16 @@ namespace opencorr
 
 		void compute(POI2D* poi);
 		void compute(std::vector<POI2D>& poi_queue);
+
+		//set the number of subsets in a batch for a dense grid of POIs, e.g. 64, 0 to process the POIs one by one
+		void setBatchSize(int batch_size);
+
+		//set the sub-pixel estimation of peak, the peak sharpness is stored in result.feature of POIs in any case
+		void setPeakFit(PeakFit peak_fit);
+
+		//true: process the POIs one by one with the kernels of fixed subset dimension if the radius is 15, 16, 20 or 30,
+		//on any target, whereas the flag of ICGN2D1 and ICGN2D2 has no effect unless built with AVX-512
+		void setSpecializedKernel(bool specialized_kernel);
 	};
 
 
@@ -78,8 +152,10 @@ namespace opencorr
 	class FFTCC3D : public DVC
 	{
 	private:
-		std::vector<FFTW*> instance_pool; //pool of FFTW instances for multi-thread processing
-		FFTW* getInstance(int tid); //get an instance according to the number of current thread id
+		WorkspacePool<FFTW> instance_pool; //pool of FFTW instances for concurrent processing
+		FFTW* getInstance(); //get a free instance, a new one is allocated if none is free
+
+		PeakFit peak_fit; //sub-pixel estimation of correlation peak
 
 	public:
 		FFTCC3D(int subset_radius_x, int subset_radius_y, int subset_radius_z, int thread_number);
@@ -87,6 +163,9 @@ namespace opencorr
 
 		void compute(POI3D* poi);
 		void compute(std::vector<POI3D>& poi_queue);
+
+		//set the sub-pixel estimation of peak, the peak sharpness is stored in result.feature of POIs in any case
+		void setPeakFit(PeakFit peak_fit);
 	};
 
 }//namespace opencorr
@@ -29,7 +29,7 @@ namespace opencorr
 		int height = grad_img->height;
 		int width = grad_img->width;
 
-		gradient_x = Eigen::MatrixXf::Zero(height, width);
+		gradient_x = RowMatrixXf::Zero(height, width);
 
 #pragma omp parallel for
 		for (int r = 0; r < height; r++)
@@ -51,7 +51,7 @@ namespace opencorr
 		int height = grad_img->height;
 		int width = grad_img->width;
 
-		gradient_y = Eigen::MatrixXf::Zero(height, width);
+		gradient_y = RowMatrixXf::Zero(height, width);
 
 #pragma omp parallel for
 		for (int r = 2; r < height - 2; r++)
@@ -73,7 +73,7 @@ namespace opencorr
 		int height = grad_img->height;
 		int width = grad_img->width;
 
-		gradient_xy = Eigen::MatrixXf::Zero(height, width);
+		gradient_xy = RowMatrixXf::Zero(height, width);
 
 		if (gradient_x.rows() != height || gradient_x.cols() != width)
 		{
@@ -127,20 +127,24 @@ namespace opencorr
 			delete3D(gradient_x);
 		}
 		gradient_x = new3D(dim_z, dim_y, dim_x);
+		VolumeView img_view = grad_img->getView();
+		VolumeView gradient_view(gradient_x[0][0], dim_x, dim_y, dim_z);
 
 #pragma omp parallel for
 		for (int i = 0; i < dim_z; i++)
 		{
 			for (int j = 0; j < dim_y; j++)
 			{
+				const float* img_row = img_view.row(i, j);
+				float* gradient_row = gradient_view.row(i, j);
 				for (int k = 2; k < dim_x - 2; k++)
 				{
 					float result = 0.0f;
-					result -= grad_img->vol_mat[i][j][k + 2] / 12.f;
-					result += grad_img->vol_mat[i][j][k + 1] * (2.f / 3.f);
-					result -= grad_img->vol_mat[i][j][k - 1] * (2.f / 3.f);
-					result += grad_img->vol_mat[i][j][k - 2] / 12.f;
-					gradient_x[i][j][k] = result;
+					result -= img_row[k + 2] / 12.f;
+					result += img_row[k + 1] * (2.f / 3.f);
+					result -= img_row[k - 1] * (2.f / 3.f);
+					result += img_row[k - 2] / 12.f;
+					gradient_row[k] = result;
 				}
 			}
 		}
@@ -157,20 +161,28 @@ namespace opencorr
 			delete3D(gradient_y);
 		}
 		gradient_y = new3D(dim_z, dim_y, dim_x);
+		VolumeView img_view = grad_img->getView();
+		VolumeView gradient_view(gradient_y[0][0], dim_x, dim_y, dim_z);
 
+		//the neighboring rows are processed as a whole, thus the voxels are accessed continuously
 #pragma omp parallel for
-		for (int k = 0; k < dim_x; k++)
+		for (int i = 0; i < dim_z; i++)
 		{
-			for (int i = 0; i < dim_z; i++)
+			for (int j = 2; j < dim_y - 2; j++)
 			{
-				for (int j = 2; j < dim_y - 2; j++)
+				const float* row_m2 = img_view.row(i, j - 2);
+				const float* row_m1 = img_view.row(i, j - 1);
+				const float* row_p1 = img_view.row(i, j + 1);
+				const float* row_p2 = img_view.row(i, j + 2);
+				float* gradient_row = gradient_view.row(i, j);
+				for (int k = 0; k < dim_x; k++)
 				{
 					float result = 0.0f;
-					result -= grad_img->vol_mat[i][j + 2][k] / 12.f;
-					result += grad_img->vol_mat[i][j + 1][k] * (2.f / 3.f);
-					result -= grad_img->vol_mat[i][j - 1][k] * (2.f / 3.f);
-					result += grad_img->vol_mat[i][j - 2][k] / 12.f;
-					gradient_y[i][j][k] = result;
+					result -= row_p2[k] / 12.f;
+					result += row_p1[k] * (2.f / 3.f);
+					result -= row_m1[k] * (2.f / 3.f);
+					result += row_m2[k] / 12.f;
+					gradient_row[k] = result;
 				}
 			}
 		}
@@ -187,20 +199,28 @@ namespace opencorr
 			delete3D(gradient_z);
 		}
 		gradient_z = new3D(dim_z, dim_y, dim_x);
+		VolumeView img_view = grad_img->getView();
+		VolumeView gradient_view(gradient_z[0][0], dim_x, dim_y, dim_z);
 
+		//the rows at the same position of neighboring slices are processed as a whole
 #pragma omp parallel for
-		for (int j = 0; j < dim_y; j++)
+		for (int i = 2; i < dim_z - 2; i++)
 		{
-			for (int k = 0; k < dim_x; k++)
+			for (int j = 0; j < dim_y; j++)
 			{
-				for (int i = 2; i < dim_z - 2; i++)
+				const float* row_m2 = img_view.row(i - 2, j);
+				const float* row_m1 = img_view.row(i - 1, j);
+				const float* row_p1 = img_view.row(i + 1, j);
+				const float* row_p2 = img_view.row(i + 2, j);
+				float* gradient_row = gradient_view.row(i, j);
+				for (int k = 0; k < dim_x; k++)
 				{
 					float result = 0.0f;
-					result -= grad_img->vol_mat[i + 2][j][k] / 12.f;
-					result += grad_img->vol_mat[i + 1][j][k] * (2.f / 3.f);
-					result -= grad_img->vol_mat[i - 1][j][k] * (2.f / 3.f);
-					result += grad_img->vol_mat[i - 2][j][k] / 12.f;
-					gradient_z[i][j][k] = result;
+					result -= row_p2[k] / 12.f;
+					result += row_p1[k] * (2.f / 3.f);
+					result -= row_m1[k] * (2.f / 3.f);
+					result += row_m2[k] / 12.f;
+					gradient_row[k] = result;
 				}
 			}
 		}
@@ -32,9 +32,9 @@ namespace opencorr
 		Image2D* grad_img = nullptr;
 
 	public:
-		Eigen::MatrixXf gradient_x;
-		Eigen::MatrixXf gradient_y;
-		Eigen::MatrixXf gradient_xy;
+		RowMatrixXf gradient_x;
+		RowMatrixXf gradient_y;
+		RowMatrixXf gradient_xy;
 
 		Gradient2D4(Image2D& image);
 		~Gradient2D4();
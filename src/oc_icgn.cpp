@@ -25,25 +25,25 @@ namespace opencorr
 		ICGN2D1_* ICGN_instance = new ICGN2D1_;
 		ICGN_instance->ref_subset = new Subset2D(subset_center, subset_radius_x, subset_radius_y);
 		ICGN_instance->tar_subset = new Subset2D(subset_center, subset_radius_x, subset_radius_y);
-		ICGN_instance->error_img = Eigen::MatrixXf::Zero(subset_height, subset_width);
-		ICGN_instance->sd_img = new3D(subset_height, subset_width, 6);
+		ICGN_instance->sd_img = RowMatrix6Xf::Zero(6, subset_height * subset_width);
+		ICGN_instance->warped_x = Eigen::VectorXf::Zero(subset_height * subset_width);
+		ICGN_instance->warped_y = Eigen::VectorXf::Zero(subset_height * subset_width);
 
 		return ICGN_instance;
 	}
 
 	void ICGN2D1_::release(ICGN2D1_* instance)
 	{
-		delete3D(instance->sd_img);
 		delete instance->ref_subset;
 		delete instance->tar_subset;
 	}
 
 	void ICGN2D1_::update(ICGN2D1_* instance, int subset_radius_x, int subset_radius_y)
 	{
-		if (instance->sd_img != nullptr)
+		//the instance is reused as it is if the dimension of subset does not change
+		if (instance->ref_subset != nullptr && instance->ref_subset->radius_x == subset_radius_x && instance->ref_subset->radius_y == subset_radius_y)
 		{
-			delete3D(instance->sd_img);
-			instance->sd_img = nullptr;
+			return;
 		}
 
 		if (instance->ref_subset != nullptr)
@@ -64,47 +64,98 @@ namespace opencorr
 
 		instance->ref_subset = new Subset2D(subset_center, subset_radius_x, subset_radius_y);
 		instance->tar_subset = new Subset2D(subset_center, subset_radius_x, subset_radius_y);
-		instance->error_img.resize(subset_height, subset_width);
-		instance->sd_img = new3D(subset_height, subset_width, 6);
+		instance->sd_img.resize(6, subset_height * subset_width);
+		instance->warped_x.resize(subset_height * subset_width);
+		instance->warped_y.resize(subset_height * subset_width);
 	}
 
-	ICGN2D1_* ICGN2D1::getInstance(int tid)
+	ICGN2D1_* ICGN2D1::getInstance()
 	{
-		if (tid >= (int)instance_pool.size())
+		ICGN2D1_* instance = instance_pool.acquire();
+		if (instance == nullptr)
 		{
-			throw std::string("CPU thread ID over limit");
+			instance = ICGN2D1_::allocate(subset_radius_x, subset_radius_y);
+			instance_pool.add(instance);
 		}
 
-		return instance_pool[tid];
+		return instance;
+	}
+
+	ICGN2D1_* ICGN2D1::getInstance(int subset_radius_x, int subset_radius_y)
+	{
+		ICGN2D1_* instance = bucket_pool.acquire([subset_radius_x, subset_radius_y](ICGN2D1_* candidate)
+			{
+				return candidate->ref_subset->radius_x == subset_radius_x && candidate->ref_subset->radius_y == subset_radius_y;
+			});
+
+		if (instance == nullptr)
+		{
+			instance = bucket_pool.addBelow(bucket_number, [subset_radius_x, subset_radius_y]()
+				{
+					return ICGN2D1_::allocate(subset_radius_x, subset_radius_y);
+				});
+		}
+
+		if (instance == nullptr)
+		{
+			//reuse the least recently released instance
+			instance = bucket_pool.acquire([](ICGN2D1_*) { return true; });
+			if (instance == nullptr)
+			{
+				//all the instances are in use, the pool exceeds the bucket number until it is trimmed
+				instance = ICGN2D1_::allocate(subset_radius_x, subset_radius_y);
+				bucket_pool.add(instance);
+			}
+			else
+			{
+				ICGN2D1_::update(instance, subset_radius_x, subset_radius_y);
+			}
+		}
+
+		return instance;
 	}
 
 	ICGN2D1::ICGN2D1(int subset_radius_x, int subset_radius_y, float conv_criterion, float stop_condition, int thread_number)
-		: ref_gradient(nullptr), tar_interp(nullptr)
+		: ref_gradient(nullptr), ref_bspline(nullptr), tar_interp(nullptr), ref_cache(nullptr)
 	{
 		this->subset_radius_x = subset_radius_x;
 		this->subset_radius_y = subset_radius_y;
 		this->conv_criterion = conv_criterion;
 		this->stop_condition = stop_condition;
+		compact_interp = false;
+		bspline_gradient = false;
+		specialized_kernel = true;
 		this->thread_number = thread_number;
 
 		for (int i = 0; i < thread_number; i++)
 		{
 			ICGN2D1_* instance = ICGN2D1_::allocate(subset_radius_x, subset_radius_y);
-			instance_pool.push_back(instance);
+			instance_pool.addFree(instance);
 		}
+
+		bucket_number = 8 * thread_number;
 	}
 
 	ICGN2D1::~ICGN2D1()
 	{
 		delete ref_gradient;
+		delete ref_bspline;
 		delete tar_interp;
+		delete ref_cache;
 
-		for (auto& instance : instance_pool)
+		for (auto& instance : instance_pool.getWorkspaces())
 		{
 			ICGN2D1_::release(instance);
 			delete instance;
 		}
 		instance_pool.clear();
+
+		for (auto& instance : bucket_pool.getWorkspaces())
+		{
+			ICGN2D1_::release(instance);
+			delete instance;
+		}
+		bucket_pool.clear();
 	}
 
 	void ICGN2D1::setIteration(float conv_criterion, float stop_condition)
@@ -113,12 +164,58 @@ namespace opencorr
 		this->stop_condition = stop_condition;
 	}
 
+	void ICGN2D1::setBucketNumber(int bucket_number)
+	{
+		this->bucket_number = bucket_number > 0 ? bucket_number : 1;
+
+		//release the surplus instances not in use
+		for (auto& instance : bucket_pool.removeAbove(this->bucket_number))
+		{
+			ICGN2D1_::release(instance);
+			delete instance;
+		}
+	}
+
+	void ICGN2D1::setCompactInterpolation(bool compact_interp)
+	{
+		this->compact_interp = compact_interp;
+	}
+
+	void ICGN2D1::setBsplineGradient(bool bspline_gradient)
+	{
+		this->bspline_gradient = bspline_gradient;
+	}
+
+	void ICGN2D1::setSpecializedKernel(bool specialized_kernel)
+	{
+		this->specialized_kernel = specialized_kernel;
+	}
+
 	void ICGN2D1::setIteration(POI2D* poi)
 	{
 		conv_criterion = poi->result.convergence;
 		stop_condition = (int)poi->result.iteration;
 	}
 
+	void ICGN2D1::setReferenceCache(size_t memory_budget)
+	{
+		if (ref_cache != nullptr)
+		{
+			delete ref_cache;
+			ref_cache = nullptr;
+		}
+
+		if (memory_budget > 0)
+		{
+			ref_cache = new ReferenceCache(memory_budget);
+		}
+	}
+
+	ReferenceCache* ICGN2D1::getReferenceCache() const
+	{
+		return ref_cache;
+	}
+
 	void ICGN2D1::prepareRef()
 	{
 		if (ref_gradient != nullptr)
@@ -127,9 +224,30 @@ namespace opencorr
 			ref_gradient = nullptr;
 		}
 
-		ref_gradient = new Gradient2D4(*ref_img);
-		ref_gradient->getGradientX();
-		ref_gradient->getGradientY();
+		if (ref_bspline != nullptr)
+		{
+			delete ref_bspline;
+			ref_bspline = nullptr;
+		}
+
+		if (bspline_gradient)
+		{
+			//the gradients are evaluated only at the pixels in reference subsets
+			ref_bspline = new BicubicBsplineGradient(*ref_img);
+			ref_bspline->prepare();
+		}
+		else
+		{
+			ref_gradient = new Gradient2D4(*ref_img);
+			ref_gradient->getGradientX();
+			ref_gradient->getGradientY();
+		}
+
+		//the cached reference data are out of date
+		if (ref_cache != nullptr)
+		{
+			ref_cache->clear();
+		}
 	}
 
 	void ICGN2D1::prepareTar()
@@ -140,7 +258,7 @@ namespace opencorr
 			tar_interp = nullptr;
 		}
 
-		tar_interp = new BicubicBspline(*tar_img);
+		tar_interp = new BicubicBspline(*tar_img, compact_interp);
 		tar_interp->prepare();
 	}
 
@@ -150,10 +268,17 @@ namespace opencorr
 		prepareTar();
 	}
 
+	Interpolation2D* ICGN2D1::swapTarInterpolation(Interpolation2D* tar_interp)
+	{
+		Interpolation2D* previous_interp = this->tar_interp;
+		this->tar_interp = tar_interp;
+		return previous_interp;
+	}
+
 	void ICGN2D1::compute(POI2D* poi)
 	{
-		//set instance w.r.t. thread id 
-		ICGN2D1_* cur_instance = getInstance(omp_get_thread_num());
+		//get a free instance from pool
+		ICGN2D1_* cur_instance = getInstance();
 
 		if (poi->y - subset_radius_y < 0 || poi->x - subset_radius_x < 0
 			|| poi->y + subset_radius_y > ref_img->height - 1 || poi->x + subset_radius_x > ref_img->width - 1
@@ -167,43 +292,85 @@ namespace opencorr
 			int subset_width = 2 * subset_radius_x + 1;
 			int subset_height = 2 * subset_radius_y + 1;
 
-			//set reference subset
-			cur_instance->ref_subset->center = (Point2D)*poi;
-			cur_instance->ref_subset->fill(ref_img);
-			float ref_mean_norm = cur_instance->ref_subset->zeroMeanNorm();
-
-			//build the Hessian matrix
-			cur_instance->hessian.setZero();
-			for (int r = 0; r < subset_height; r++)
+			//get the reference data from cache if available
+			ReferenceKey ref_key = { poi->x, poi->y, 0.f, subset_radius_x, subset_radius_y, 0 };
+			std::shared_ptr<ReferenceEntry> ref_entry;
+			if (ref_cache != nullptr)
 			{
-				for (int c = 0; c < subset_width; c++)
-				{
-					int x_local = c - subset_radius_x;
-					int y_local = r - subset_radius_y;
-					int x_global = (int)poi->x + x_local;
-					int y_global = (int)poi->y + y_local;
-					float ref_gradient_x = ref_gradient->gradient_x(y_global, x_global);
-					float ref_gradient_y = ref_gradient->gradient_y(y_global, x_global);
+				ref_entry = ref_cache->find(ref_key);
+			}
 
-					cur_instance->sd_img[r][c][0] = ref_gradient_x;
-					cur_instance->sd_img[r][c][1] = ref_gradient_x * x_local;
-					cur_instance->sd_img[r][c][2] = ref_gradient_x * y_local;
-					cur_instance->sd_img[r][c][3] = ref_gradient_y;
-					cur_instance->sd_img[r][c][4] = ref_gradient_y * x_local;
-					cur_instance->sd_img[r][c][5] = ref_gradient_y * y_local;
+			float ref_mean_norm;
+			const float* ref_data = cur_instance->ref_subset->eg_mat.data();
+			const float* sd_data = cur_instance->sd_img.data();
+			if (ref_entry != nullptr)
+			{
+				ref_mean_norm = ref_entry->mean_norm;
+				ref_data = ref_entry->subset.data();
+				sd_data = ref_entry->sd_img.data();
+				cur_instance->inv_hessian = ref_entry->inv_hessian;
+			}
+			else
+			{
+				//set reference subset
+				cur_instance->ref_subset->center = (Point2D)*poi;
+				cur_instance->ref_subset->fill(ref_img);
+				ref_mean_norm = cur_instance->ref_subset->zeroMeanNorm();
 
-					for (int i = 0; i < 6; i++)
+				//build the steepest descent image
+				for (int r = 0; r < subset_height; r++)
+				{
+					for (int c = 0; c < subset_width; c++)
 					{
-						for (int j = 0; j < 6; j++)
+						int x_local = c - subset_radius_x;
+						int y_local = r - subset_radius_y;
+						int x_global = (int)poi->x + x_local;
+						int y_global = (int)poi->y + y_local;
+						float ref_gradient_x, ref_gradient_y;
+						if (ref_bspline != nullptr)
+						{
+							ref_bspline->computeGradient(x_global, y_global, ref_gradient_x, ref_gradient_y);
+						}
+						else
 						{
-							cur_instance->hessian(i, j) += (cur_instance->sd_img[r][c][i] * cur_instance->sd_img[r][c][j]);
+							ref_gradient_x = ref_gradient->gradient_x(y_global, x_global);
+							ref_gradient_y = ref_gradient->gradient_y(y_global, x_global);
 						}
+
+						int pixel_index = r * subset_width + c;
+						cur_instance->sd_img(0, pixel_index) = ref_gradient_x;
+						cur_instance->sd_img(1, pixel_index) = ref_gradient_x * x_local;
+						cur_instance->sd_img(2, pixel_index) = ref_gradient_x * y_local;
+						cur_instance->sd_img(3, pixel_index) = ref_gradient_y;
+						cur_instance->sd_img(4, pixel_index) = ref_gradient_y * x_local;
+						cur_instance->sd_img(5, pixel_index) = ref_gradient_y * y_local;
 					}
 				}
-			}
 
-			//calculate the inversed Hessian matrix
-			cur_instance->inv_hessian = cur_instance->hessian.inverse();
+				//build the Hessian matrix, only the upper triangle is calculated as the matrix is symmetric
+				for (int i = 0; i < 6; i++)
+				{
+					for (int j = i; j < 6; j++)
+					{
+						cur_instance->hessian(i, j) = cur_instance->sd_img.row(i).dot(cur_instance->sd_img.row(j));
+						cur_instance->hessian(j, i) = cur_instance->hessian(i, j);
+					}
+				}
+
+				//calculate the inversed Hessian matrix
+				cur_instance->inv_hessian = cur_instance->hessian.inverse();
+
+				//store the reference data in cache
+				if (ref_cache != nullptr)
+				{
+					ref_entry = std::make_shared<ReferenceEntry>();
+					ref_entry->mean_norm = ref_mean_norm;
+					ref_entry->subset = Eigen::Map<Eigen::VectorXf>(cur_instance->ref_subset->eg_mat.data(), subset_width * subset_height);
+					ref_entry->sd_img = cur_instance->sd_img;
+					ref_entry->inv_hessian = cur_instance->inv_hessian;
+					ref_cache->insert(ref_key, ref_entry);
+				}
+			}
 
 			//set target subset
 			cur_instance->tar_subset->center = (Point2D)*poi;
@@ -212,50 +379,52 @@ namespace opencorr
 			Deformation2D1 p_initial(poi->deformation.u, poi->deformation.ux, poi->deformation.uy,
 				poi->deformation.v, poi->deformation.vx, poi->deformation.vy);
 
+			//the kernels of fixed subset dimension work on the look-up table of BicubicBspline
+			const float* coefficient_table = nullptr;
+			if (specialized_kernel)
+			{
+				BicubicBspline* tar_bspline = dynamic_cast<BicubicBspline*>(tar_interp);
+				coefficient_table = tar_bspline != nullptr ? tar_bspline->getCoefficientTable() : nullptr;
+			}
+
 			//IC-GN iteration
 			int iteration_counter = 0; //initialize iteration counter
 			Deformation2D1 p_current, p_increment;
 			p_current.setDeformation(p_initial);
 			float dp_norm_max, znssd;
-			Point2D local_coor, warped_coor, global_coor;
 			do
 			{
 				iteration_counter++;
-				//reconstruct target subset
-				for (int r = 0; r < subset_height; r++)
-				{
-					for (int c = 0; c < subset_width; c++)
-					{
-						int x_local = c - subset_radius_x;
-						int y_local = r - subset_radius_y;
-						local_coor.x = x_local;
-						local_coor.y = y_local;
-						warped_coor = p_current.warp(local_coor);
-						global_coor = cur_instance->tar_subset->center + warped_coor;
-						cur_instance->tar_subset->eg_mat(r, c) = tar_interp->compute(global_coor);
-					}
-				}
-				float tar_mean_norm = cur_instance->tar_subset->zeroMeanNorm();
-
-				//calculate error image
-				cur_instance->error_img = cur_instance->tar_subset->eg_mat * (ref_mean_norm / tar_mean_norm)
-					- (cur_instance->ref_subset->eg_mat);
-
-				//calculate ZNSSD
-				znssd = cur_instance->error_img.squaredNorm() / (ref_mean_norm * ref_mean_norm);
-
-				//calculate numerator
-				float numerator[6] = { 0.f };
-				for (int r = 0; r < subset_height; r++)
+				float numerator[6];
+				float tar_mean_norm, squared_sum;
+
+				//the kernel of fixed subset dimension goes through the steps below in one call
+				float warp[6] = { p_current.warp_matrix(0, 0), p_current.warp_matrix(0, 1), p_current.warp_matrix(0, 2),
+					p_current.warp_matrix(1, 0), p_current.warp_matrix(1, 1), p_current.warp_matrix(1, 2) };
+				if (coefficient_table == nullptr
+					|| !iterateSubset2D(coefficient_table, tar_img->width, tar_img->height, 1, warp,
+						cur_instance->tar_subset->center.x, cur_instance->tar_subset->center.y, subset_radius_x, subset_radius_y,
+						ref_data, ref_mean_norm, sd_data, subset_width * subset_height, numerator, squared_sum, tar_mean_norm))
 				{
-					for (int c = 0; c < subset_width; c++)
+					//reconstruct target subset, the warped coordinates are generated row by row
+					for (int r = 0; r < subset_height; r++)
 					{
-						for (int i = 0; i < 6; i++)
-						{
-							numerator[i] += (cur_instance->sd_img[r][c][i] * cur_instance->error_img(r, c));
-						}
+						Point2D row_start(-subset_radius_x, r - subset_radius_y);
+						int row_index = r * subset_width;
+						p_current.warpRow(row_start, subset_width, cur_instance->warped_x.data() + row_index, cur_instance->warped_y.data() + row_index);
 					}
+					cur_instance->warped_x.array() += cur_instance->tar_subset->center.x;
+					cur_instance->warped_y.array() += cur_instance->tar_subset->center.y;
+					tar_interp->computeBatch(cur_instance->warped_x.data(), cur_instance->warped_y.data(),
+						cur_instance->tar_subset->eg_mat.data(), subset_width * subset_height);
+					tar_mean_norm = cur_instance->tar_subset->zeroMeanNorm();
+
+					//calculate error image, ZNSSD and numerator in one pass
+					squared_sum = fuseErrorNumerator(cur_instance->tar_subset->eg_mat.data(), ref_data,
+						ref_mean_norm / tar_mean_norm, sd_data, subset_width * subset_height,
+						subset_width * subset_height, 6, numerator);
 				}
+				znssd = squared_sum / (ref_mean_norm * ref_mean_norm);
 
 				//calculate dp
 				float dp[6] = { 0.f };
@@ -312,26 +481,21 @@ namespace opencorr
 			poi->deformation.v = poi->result.v0;
 			poi->result.zncc = -5;
 		}
+
+		//return the instance to pool
+		instance_pool.release(cur_instance);
 	}
 
 	void ICGN2D1::compute(std::vector<POI2D>& poi_queue)
 	{
-		int queue_length = (int)poi_queue.size();
-#pragma omp parallel for
-		for (int i = 0; i < queue_length; i++)
-		{
-			compute(&poi_queue[i]);
-		}
+		computeQueue(poi_queue);
 	}
 
 	//functions for self-adaptive subset
 	void ICGN2D1::compute(POI2D* poi, Point2D subset_radius)
 	{
-		//set instance w.r.t. thread id
-		ICGN2D1_* cur_instance = getInstance(omp_get_thread_num());
-
-		//update the instance according to the subset dimension of current POI
-		ICGN2D1_::update(cur_instance, poi->subset_radius.x, poi->subset_radius.y);
+		//get a free instance matching the subset dimension of current POI, it is allocated only if no such one is kept
+		ICGN2D1_* cur_instance = getInstance((int)poi->subset_radius.x, (int)poi->subset_radius.y);
 
 		if (poi->y - subset_radius_y < 0 || poi->x - subset_radius_x < 0
 			|| poi->y + subset_radius_y > ref_img->height - 1 || poi->x + subset_radius_x > ref_img->width - 1
@@ -350,8 +514,7 @@ namespace opencorr
 			cur_instance->ref_subset->fill(ref_img);
 			float ref_mean_norm = cur_instance->ref_subset->zeroMeanNorm();
 
-			//build the hessian matrix
-			cur_instance->hessian.setZero();
+			//build the steepest descent image
 			for (int r = 0; r < subset_height; r++)
 			{
 				for (int c = 0; c < subset_width; c++)
@@ -360,23 +523,34 @@ namespace opencorr
 					int y_local = r - poi->subset_radius.y;
 					int x_global = (int)poi->x + x_local;
 					int y_global = (int)poi->y + y_local;
-					float ref_gradient_x = ref_gradient->gradient_x(y_global, x_global);
-					float ref_gradient_y = ref_gradient->gradient_y(y_global, x_global);
-
-					cur_instance->sd_img[r][c][0] = ref_gradient_x;
-					cur_instance->sd_img[r][c][1] = ref_gradient_x * x_local;
-					cur_instance->sd_img[r][c][2] = ref_gradient_x * y_local;
-					cur_instance->sd_img[r][c][3] = ref_gradient_y;
-					cur_instance->sd_img[r][c][4] = ref_gradient_y * x_local;
-					cur_instance->sd_img[r][c][5] = ref_gradient_y * y_local;
-
-					for (int i = 0; i < 6; i++)
+					float ref_gradient_x, ref_gradient_y;
+					if (ref_bspline != nullptr)
 					{
-						for (int j = 0; j < 6; j++)
-						{
-							cur_instance->hessian(i, j) += (cur_instance->sd_img[r][c][i] * cur_instance->sd_img[r][c][j]);
-						}
+						ref_bspline->computeGradient(x_global, y_global, ref_gradient_x, ref_gradient_y);
 					}
+					else
+					{
+						ref_gradient_x = ref_gradient->gradient_x(y_global, x_global);
+						ref_gradient_y = ref_gradient->gradient_y(y_global, x_global);
+					}
+
+					int pixel_index = r * subset_width + c;
+					cur_instance->sd_img(0, pixel_index) = ref_gradient_x;
+					cur_instance->sd_img(1, pixel_index) = ref_gradient_x * x_local;
+					cur_instance->sd_img(2, pixel_index) = ref_gradient_x * y_local;
+					cur_instance->sd_img(3, pixel_index) = ref_gradient_y;
+					cur_instance->sd_img(4, pixel_index) = ref_gradient_y * x_local;
+					cur_instance->sd_img(5, pixel_index) = ref_gradient_y * y_local;
+				}
+			}
+
+			//build the Hessian matrix, only the upper triangle is calculated as the matrix is symmetric
+			for (int i = 0; i < 6; i++)
+			{
+				for (int j = i; j < 6; j++)
+				{
+					cur_instance->hessian(i, j) = cur_instance->sd_img.row(i).dot(cur_instance->sd_img.row(j));
+					cur_instance->hessian(j, i) = cur_instance->hessian(i, j);
 				}
 			}
 
@@ -395,45 +569,28 @@ namespace opencorr
 			Deformation2D1 p_current, p_increment;
 			p_current.setDeformation(p_initial);
 			float dp_norm_max, znssd;
-			Point2D local_coor, warped_coor, global_coor;
 			do
 			{
 				iteration++;
-				//reconstruct target subset
+				//reconstruct target subset, the warped coordinates are generated row by row
 				for (int r = 0; r < subset_height; r++)
 				{
-					for (int c = 0; c < subset_width; c++)
-					{
-						int x_local = c - poi->subset_radius.x;
-						int y_local = r - poi->subset_radius.y;
-						local_coor.x = x_local;
-						local_coor.y = y_local;
-						warped_coor = p_current.warp(local_coor);
-						global_coor = cur_instance->tar_subset->center + warped_coor;
-						cur_instance->tar_subset->eg_mat(r, c) = tar_interp->compute(global_coor);
-					}
+					Point2D row_start(-poi->subset_radius.x, r - poi->subset_radius.y);
+					int row_index = r * subset_width;
+					p_current.warpRow(row_start, subset_width, cur_instance->warped_x.data() + row_index, cur_instance->warped_y.data() + row_index);
 				}
+				cur_instance->warped_x.array() += cur_instance->tar_subset->center.x;
+				cur_instance->warped_y.array() += cur_instance->tar_subset->center.y;
+				tar_interp->computeBatch(cur_instance->warped_x.data(), cur_instance->warped_y.data(),
+					cur_instance->tar_subset->eg_mat.data(), subset_width * subset_height);
 				float tar_mean_norm = cur_instance->tar_subset->zeroMeanNorm();
 
-				//compute error image
-				cur_instance->error_img = cur_instance->tar_subset->eg_mat * (ref_mean_norm / tar_mean_norm)
-					- (cur_instance->ref_subset->eg_mat);
-
-				//calculate ZNSSD
-				znssd = cur_instance->error_img.squaredNorm() / (ref_mean_norm * ref_mean_norm);
-
-				//compute numerator
-				float numerator[6] = { 0 };
-				for (int r = 0; r < subset_height; r++)
-				{
-					for (int c = 0; c < subset_width; c++)
-					{
-						for (int i = 0; i < 6; i++)
-						{
-							numerator[i] += (cur_instance->sd_img[r][c][i] * cur_instance->error_img(r, c));
-						}
-					}
-				}
+				//compute error image, ZNSSD and numerator in one pass
+				float numerator[6];
+				float squared_sum = fuseErrorNumerator(cur_instance->tar_subset->eg_mat.data(), cur_instance->ref_subset->eg_mat.data(),
+					ref_mean_norm / tar_mean_norm, cur_instance->sd_img.data(), (int)cur_instance->sd_img.outerStride(),
+					subset_width * subset_height, 6, numerator);
+				znssd = squared_sum / (ref_mean_norm * ref_mean_norm);
 
 				//compute dp
 				float dp[6] = { 0 };
@@ -482,6 +639,9 @@ namespace opencorr
 			poi->result.iteration = (float)iteration;
 			poi->result.convergence = dp_norm_max;
 		}
+
+		//return the instance to pool
+		bucket_pool.release(cur_instance);
 	}
 
 	void ICGN2D1::compute(std::vector<POI2D>& poi_queue, Point2D subset_radius)
@@ -505,25 +665,25 @@ namespace opencorr
 		ICGN2D2_* ICGN_instance = new ICGN2D2_;
 		ICGN_instance->ref_subset = new Subset2D(subset_center, subset_radius_x, subset_radius_y);
 		ICGN_instance->tar_subset = new Subset2D(subset_center, subset_radius_x, subset_radius_y);
-		ICGN_instance->error_img = Eigen::MatrixXf::Zero(subset_height, subset_width);
-		ICGN_instance->sd_img = new3D(subset_height, subset_width, 12);
+		ICGN_instance->sd_img = RowMatrix12Xf::Zero(12, subset_height * subset_width);
+		ICGN_instance->warped_x = Eigen::VectorXf::Zero(subset_height * subset_width);
+		ICGN_instance->warped_y = Eigen::VectorXf::Zero(subset_height * subset_width);
 
 		return ICGN_instance;
 	}
 
 	void ICGN2D2_::release(ICGN2D2_* instance)
 	{
-		delete3D(instance->sd_img);
 		delete instance->ref_subset;
 		delete instance->tar_subset;
 	}
 
 	void ICGN2D2_::update(ICGN2D2_* instance, int subset_radius_x, int subset_radius_y)
 	{
-		if (instance->sd_img != nullptr)
+		//the instance is reused as it is if the dimension of subset does not change
+		if (instance->ref_subset != nullptr && instance->ref_subset->radius_x == subset_radius_x && instance->ref_subset->radius_y == subset_radius_y)
 		{
-			delete3D(instance->sd_img);
-			instance->sd_img = nullptr;
+			return;
 		}
 
 		if (instance->ref_subset != nullptr)
@@ -544,42 +704,50 @@ namespace opencorr
 
 		instance->ref_subset = new Subset2D(subset_center, subset_radius_x, subset_radius_y);
 		instance->tar_subset = new Subset2D(subset_center, subset_radius_x, subset_radius_y);
-		instance->error_img.resize(subset_height, subset_width);
-		instance->sd_img = new3D(subset_height, subset_width, 12);
+		instance->sd_img.resize(12, subset_height * subset_width);
+		instance->warped_x.resize(subset_height * subset_width);
+		instance->warped_y.resize(subset_height * subset_width);
 	}
 
-	ICGN2D2_* ICGN2D2::getInstance(int tid)
+	ICGN2D2_* ICGN2D2::getInstance()
 	{
-		if (tid >= (int)instance_pool.size())
+		ICGN2D2_* instance = instance_pool.acquire();
+		if (instance == nullptr)
 		{
-			throw std::string("CPU thread ID over limit");
+			instance = ICGN2D2_::allocate(subset_radius_x, subset_radius_y);
+			instance_pool.add(instance);
 		}
 
-		return instance_pool[tid];
+		return instance;
 	}
 
 	ICGN2D2::ICGN2D2(int subset_radius_x, int subset_radius_y, float conv_criterion, float stop_condition, int thread_number)
-		: ref_gradient(nullptr), tar_interp(nullptr)
+		: ref_gradient(nullptr), ref_bspline(nullptr), tar_interp(nullptr), ref_cache(nullptr)
 	{
 		this->subset_radius_x = subset_radius_x;
 		this->subset_radius_y = subset_radius_y;
 		this->conv_criterion = conv_criterion;
 		this->stop_condition = stop_condition;
+		compact_interp = false;
+		bspline_gradient = false;
+		specialized_kernel = true;
 
 		this->thread_number = thread_number;
 		for (int i = 0; i < thread_number; i++)
 		{
 			ICGN2D2_* instance = ICGN2D2_::allocate(subset_radius_x, subset_radius_y);
-			instance_pool.push_back(instance);
+			instance_pool.addFree(instance);
 		}
 	}
 
 	ICGN2D2::~ICGN2D2()
 	{
 		delete ref_gradient;
+		delete ref_bspline;
 		delete tar_interp;
+		delete ref_cache;
 
-		for (auto& instance : instance_pool)
+		for (auto& instance : instance_pool.getWorkspaces())
 		{
 			ICGN2D2_::release(instance);
 			delete instance;
@@ -593,12 +761,46 @@ namespace opencorr
 		this->stop_condition = stop_condition;
 	}
 
+	void ICGN2D2::setCompactInterpolation(bool compact_interp)
+	{
+		this->compact_interp = compact_interp;
+	}
+
+	void ICGN2D2::setBsplineGradient(bool bspline_gradient)
+	{
+		this->bspline_gradient = bspline_gradient;
+	}
+
+	void ICGN2D2::setSpecializedKernel(bool specialized_kernel)
+	{
+		this->specialized_kernel = specialized_kernel;
+	}
+
 	void ICGN2D2::setIteration(POI2D* poi)
 	{
 		conv_criterion = poi->result.convergence;
 		stop_condition = poi->result.iteration;
 	}
 
+	void ICGN2D2::setReferenceCache(size_t memory_budget)
+	{
+		if (ref_cache != nullptr)
+		{
+			delete ref_cache;
+			ref_cache = nullptr;
+		}
+
+		if (memory_budget > 0)
+		{
+			ref_cache = new ReferenceCache(memory_budget);
+		}
+	}
+
+	ReferenceCache* ICGN2D2::getReferenceCache() const
+	{
+		return ref_cache;
+	}
+
 	void ICGN2D2::prepareRef()
 	{
 		if (ref_gradient != nullptr)
@@ -607,9 +809,30 @@ namespace opencorr
 			ref_gradient = nullptr;
 		}
 
-		ref_gradient = new Gradient2D4(*ref_img);
-		ref_gradient->getGradientX();
-		ref_gradient->getGradientY();
+		if (ref_bspline != nullptr)
+		{
+			delete ref_bspline;
+			ref_bspline = nullptr;
+		}
+
+		if (bspline_gradient)
+		{
+			//the gradients are evaluated only at the pixels in reference subsets
+			ref_bspline = new BicubicBsplineGradient(*ref_img);
+			ref_bspline->prepare();
+		}
+		else
+		{
+			ref_gradient = new Gradient2D4(*ref_img);
+			ref_gradient->getGradientX();
+			ref_gradient->getGradientY();
+		}
+
+		//the cached reference data are out of date
+		if (ref_cache != nullptr)
+		{
+			ref_cache->clear();
+		}
 	}
 
 	void ICGN2D2::prepareTar()
@@ -620,7 +843,7 @@ namespace opencorr
 			tar_interp = nullptr;
 		}
 
-		tar_interp = new BicubicBspline(*tar_img);
+		tar_interp = new BicubicBspline(*tar_img, compact_interp);
 		tar_interp->prepare();
 	}
 
@@ -630,10 +853,17 @@ namespace opencorr
 		prepareTar();
 	}
 
+	Interpolation2D* ICGN2D2::swapTarInterpolation(Interpolation2D* tar_interp)
+	{
+		Interpolation2D* previous_interp = this->tar_interp;
+		this->tar_interp = tar_interp;
+		return previous_interp;
+	}
+
 	void ICGN2D2::compute(POI2D* poi)
 	{
-		//set instance w.r.t. thread id 
-		ICGN2D2_* cur_instance = getInstance(omp_get_thread_num());
+		//get a free instance from pool
+		ICGN2D2_* cur_instance = getInstance();
 
 		if (poi->y - subset_radius_y < 0 || poi->x - subset_radius_x < 0
 			|| poi->y + subset_radius_y > ref_img->height - 1 || poi->x + subset_radius_x > ref_img->width - 1
@@ -647,53 +877,95 @@ namespace opencorr
 			int subset_width = 2 * subset_radius_x + 1;
 			int subset_height = 2 * subset_radius_y + 1;
 
-			//set reference subset
-			cur_instance->ref_subset->center = (Point2D)*poi;
-			cur_instance->ref_subset->fill(ref_img);
-			float ref_mean_norm = cur_instance->ref_subset->zeroMeanNorm();
+			//get the reference data from cache if available
+			ReferenceKey ref_key = { poi->x, poi->y, 0.f, subset_radius_x, subset_radius_y, 0 };
+			std::shared_ptr<ReferenceEntry> ref_entry;
+			if (ref_cache != nullptr)
+			{
+				ref_entry = ref_cache->find(ref_key);
+			}
 
-			//build the Hessian matrix
-			cur_instance->hessian.setZero();
-			for (int r = 0; r < subset_height; r++)
+			float ref_mean_norm;
+			const float* ref_data = cur_instance->ref_subset->eg_mat.data();
+			const float* sd_data = cur_instance->sd_img.data();
+			if (ref_entry != nullptr)
 			{
-				for (int c = 0; c < subset_width; c++)
+				ref_mean_norm = ref_entry->mean_norm;
+				ref_data = ref_entry->subset.data();
+				sd_data = ref_entry->sd_img.data();
+				cur_instance->inv_hessian = ref_entry->inv_hessian;
+			}
+			else
+			{
+				//set reference subset
+				cur_instance->ref_subset->center = (Point2D)*poi;
+				cur_instance->ref_subset->fill(ref_img);
+				ref_mean_norm = cur_instance->ref_subset->zeroMeanNorm();
+
+				//build the steepest descent image
+				for (int r = 0; r < subset_height; r++)
 				{
-					int x_local = c - subset_radius_x;
-					int y_local = r - subset_radius_y;
-					float xx_local = (x_local * x_local) * 0.5f;
-					float xy_local = (float)(x_local * y_local);
-					float yy_local = (y_local * y_local) * 0.5f;
-					int x_global = (int)poi->x + x_local;
-					int y_global = (int)poi->y + y_local;
-					float ref_gradient_x = ref_gradient->gradient_x(y_global, x_global);
-					float ref_gradient_y = ref_gradient->gradient_y(y_global, x_global);
-
-					cur_instance->sd_img[r][c][0] = ref_gradient_x;
-					cur_instance->sd_img[r][c][1] = ref_gradient_x * x_local;
-					cur_instance->sd_img[r][c][2] = ref_gradient_x * y_local;
-					cur_instance->sd_img[r][c][3] = ref_gradient_x * xx_local;
-					cur_instance->sd_img[r][c][4] = ref_gradient_x * xy_local;
-					cur_instance->sd_img[r][c][5] = ref_gradient_x * yy_local;
-
-					cur_instance->sd_img[r][c][6] = ref_gradient_y;
-					cur_instance->sd_img[r][c][7] = ref_gradient_y * x_local;
-					cur_instance->sd_img[r][c][8] = ref_gradient_y * y_local;
-					cur_instance->sd_img[r][c][9] = ref_gradient_y * xx_local;
-					cur_instance->sd_img[r][c][10] = ref_gradient_y * xy_local;
-					cur_instance->sd_img[r][c][11] = ref_gradient_y * yy_local;
-
-					for (int i = 0; i < 12; i++)
+					for (int c = 0; c < subset_width; c++)
 					{
-						for (int j = 0; j < 12; j++)
+						int x_local = c - subset_radius_x;
+						int y_local = r - subset_radius_y;
+						float xx_local = (x_local * x_local) * 0.5f;
+						float xy_local = (float)(x_local * y_local);
+						float yy_local = (y_local * y_local) * 0.5f;
+						int x_global = (int)poi->x + x_local;
+						int y_global = (int)poi->y + y_local;
+						float ref_gradient_x, ref_gradient_y;
+						if (ref_bspline != nullptr)
 						{
-							cur_instance->hessian(i, j) += (cur_instance->sd_img[r][c][i] * cur_instance->sd_img[r][c][j]);
+							ref_bspline->computeGradient(x_global, y_global, ref_gradient_x, ref_gradient_y);
 						}
+						else
+						{
+							ref_gradient_x = ref_gradient->gradient_x(y_global, x_global);
+							ref_gradient_y = ref_gradient->gradient_y(y_global, x_global);
+						}
+
+						int pixel_index = r * subset_width + c;
+						cur_instance->sd_img(0, pixel_index) = ref_gradient_x;
+						cur_instance->sd_img(1, pixel_index) = ref_gradient_x * x_local;
+						cur_instance->sd_img(2, pixel_index) = ref_gradient_x * y_local;
+						cur_instance->sd_img(3, pixel_index) = ref_gradient_x * xx_local;
+						cur_instance->sd_img(4, pixel_index) = ref_gradient_x * xy_local;
+						cur_instance->sd_img(5, pixel_index) = ref_gradient_x * yy_local;
+
+						cur_instance->sd_img(6, pixel_index) = ref_gradient_y;
+						cur_instance->sd_img(7, pixel_index) = ref_gradient_y * x_local;
+						cur_instance->sd_img(8, pixel_index) = ref_gradient_y * y_local;
+						cur_instance->sd_img(9, pixel_index) = ref_gradient_y * xx_local;
+						cur_instance->sd_img(10, pixel_index) = ref_gradient_y * xy_local;
+						cur_instance->sd_img(11, pixel_index) = ref_gradient_y * yy_local;
 					}
 				}
-			}
 
-			//calculate the inversed Hessian matrix
-			cur_instance->inv_hessian = cur_instance->hessian.inverse();
+				//build the Hessian matrix, only the upper triangle is calculated as the matrix is symmetric
+				for (int i = 0; i < 12; i++)
+				{
+					for (int j = i; j < 12; j++)
+					{
+						cur_instance->hessian(i, j) = cur_instance->sd_img.row(i).dot(cur_instance->sd_img.row(j));
+						cur_instance->hessian(j, i) = cur_instance->hessian(i, j);
+					}
+				}
+
+				//calculate the inversed Hessian matrix
+				cur_instance->inv_hessian = cur_instance->hessian.inverse();
+
+				//store the reference data in cache
+				if (ref_cache != nullptr)
+				{
+					ref_entry = std::make_shared<ReferenceEntry>();
+					ref_entry->mean_norm = ref_mean_norm;
+					ref_entry->subset = Eigen::Map<Eigen::VectorXf>(cur_instance->ref_subset->eg_mat.data(), subset_width * subset_height);
+					ref_entry->sd_img = cur_instance->sd_img;
+					ref_entry->inv_hessian = cur_instance->inv_hessian;
+					ref_cache->insert(ref_key, ref_entry);
+				}
+			}
 
 			//set target subset
 			cur_instance->tar_subset->center = (Point2D)*poi;
@@ -702,50 +974,56 @@ namespace opencorr
 			Deformation2D1 p_initial(poi->deformation.u, poi->deformation.ux, poi->deformation.uy,
 				poi->deformation.v, poi->deformation.vx, poi->deformation.vy);
 
+			//the kernels of fixed subset dimension work on the look-up table of BicubicBspline
+			const float* coefficient_table = nullptr;
+			if (specialized_kernel)
+			{
+				BicubicBspline* tar_bspline = dynamic_cast<BicubicBspline*>(tar_interp);
+				coefficient_table = tar_bspline != nullptr ? tar_bspline->getCoefficientTable() : nullptr;
+			}
+
 			//IC-GN iteration
 			int iteration_counter = 0; //initialize iteration counter
 			Deformation2D2 p_current, p_increment;
 			p_current.setDeformation(p_initial);
 			float dp_norm_max, znssd;
-			Point2D local_coor, warped_coor, global_coor;
 			do
 			{
 				iteration_counter++;
-				//reconstruct target subset
-				for (int r = 0; r < subset_height; r++)
+				float numerator[12];
+				float tar_mean_norm, squared_sum;
+
+				//the kernel of fixed subset dimension goes through the steps below in one call
+				float warp[12];
+				for (int i = 0; i < 6; i++)
 				{
-					for (int c = 0; c < subset_width; c++)
-					{
-						int x_local = c - subset_radius_x;
-						int y_local = r - subset_radius_y;
-						local_coor.x = x_local;
-						local_coor.y = y_local;
-						warped_coor = p_current.warp(local_coor);
-						global_coor = cur_instance->tar_subset->center + warped_coor;
-						cur_instance->tar_subset->eg_mat(r, c) = tar_interp->compute(global_coor);
-					}
+					warp[i] = p_current.warp_matrix(3, i);
+					warp[i + 6] = p_current.warp_matrix(4, i);
 				}
-				float tar_mean_norm = cur_instance->tar_subset->zeroMeanNorm();
-
-				//calculate error image
-				cur_instance->error_img = cur_instance->tar_subset->eg_mat * (ref_mean_norm / tar_mean_norm)
-					- (cur_instance->ref_subset->eg_mat);
-
-				//calculate ZNSSD
-				znssd = cur_instance->error_img.squaredNorm() / (ref_mean_norm * ref_mean_norm);
-
-				//calculate numerator
-				float numerator[12] = { 0.f };
-				for (int r = 0; r < subset_height; r++)
+				if (coefficient_table == nullptr
+					|| !iterateSubset2D(coefficient_table, tar_img->width, tar_img->height, 2, warp,
+						cur_instance->tar_subset->center.x, cur_instance->tar_subset->center.y, subset_radius_x, subset_radius_y,
+						ref_data, ref_mean_norm, sd_data, subset_width * subset_height, numerator, squared_sum, tar_mean_norm))
 				{
-					for (int c = 0; c < subset_width; c++)
+					//reconstruct target subset, the warped coordinates are generated row by row
+					for (int r = 0; r < subset_height; r++)
 					{
-						for (int i = 0; i < 12; i++)
-						{
-							numerator[i] += (cur_instance->sd_img[r][c][i] * cur_instance->error_img(r, c));
-						}
+						Point2D row_start(-subset_radius_x, r - subset_radius_y);
+						int row_index = r * subset_width;
+						p_current.warpRow(row_start, subset_width, cur_instance->warped_x.data() + row_index, cur_instance->warped_y.data() + row_index);
 					}
+					cur_instance->warped_x.array() += cur_instance->tar_subset->center.x;
+					cur_instance->warped_y.array() += cur_instance->tar_subset->center.y;
+					tar_interp->computeBatch(cur_instance->warped_x.data(), cur_instance->warped_y.data(),
+						cur_instance->tar_subset->eg_mat.data(), subset_width * subset_height);
+					tar_mean_norm = cur_instance->tar_subset->zeroMeanNorm();
+
+					//calculate error image, ZNSSD and numerator in one pass
+					squared_sum = fuseErrorNumerator(cur_instance->tar_subset->eg_mat.data(), ref_data,
+						ref_mean_norm / tar_mean_norm, sd_data, subset_width * subset_height,
+						subset_width * subset_height, 12, numerator);
 				}
+				znssd = squared_sum / (ref_mean_norm * ref_mean_norm);
 
 				//calculate dp
 				float dp[12] = { 0.f };
@@ -817,16 +1095,14 @@ namespace opencorr
 			poi->deformation.v = poi->result.v0;
 			poi->result.zncc = -5;
 		}
+
+		//return the instance to pool
+		instance_pool.release(cur_instance);
 	}
 
 	void ICGN2D2::compute(std::vector<POI2D>& poi_queue)
 	{
-		int queue_length = (int)poi_queue.size();
-#pragma omp parallel for
-		for (int i = 0; i < queue_length; i++)
-		{
-			compute(&poi_queue[i]);
-		}
+		computeQueue(poi_queue);
 	}
 
 
@@ -844,6 +1120,9 @@ namespace opencorr
 		ICGN_instance->tar_subset = new Subset3D(subset_center, subset_radius_x, subset_radius_y, subset_radius_z);
 		ICGN_instance->error_img = new3D(dim_z, dim_y, dim_x);
 		ICGN_instance->sd_img = new4D(dim_z, dim_y, dim_x, 12);
+		ICGN_instance->warped_x = Eigen::VectorXf::Zero(dim_z * dim_y * dim_x);
+		ICGN_instance->warped_y = Eigen::VectorXf::Zero(dim_z * dim_y * dim_x);
+		ICGN_instance->warped_z = Eigen::VectorXf::Zero(dim_z * dim_y * dim_x);
 
 		return ICGN_instance;
 	}
@@ -858,6 +1137,13 @@ namespace opencorr
 
 	void ICGN3D1_::update(ICGN3D1_* instance, int subset_radius_x, int subset_radius_y, int subset_radius_z)
 	{
+		//the instance is reused as it is if the dimension of subset does not change
+		if (instance->ref_subset != nullptr && instance->ref_subset->radius_x == subset_radius_x
+			&& instance->ref_subset->radius_y == subset_radius_y && instance->ref_subset->radius_z == subset_radius_z)
+		{
+			return;
+		}
+
 		if (instance->error_img != nullptr)
 		{
 			delete3D(instance->error_img);
@@ -891,40 +1177,49 @@ namespace opencorr
 		instance->tar_subset = new Subset3D(subset_center, subset_radius_x, subset_radius_y, subset_radius_z);
 		instance->error_img = new3D(dim_z, dim_y, dim_x);
 		instance->sd_img = new4D(dim_z, dim_y, dim_x, 12);
+		instance->warped_x.resize(dim_z * dim_y * dim_x);
+		instance->warped_y.resize(dim_z * dim_y * dim_x);
+		instance->warped_z.resize(dim_z * dim_y * dim_x);
 	}
 
-	ICGN3D1_* ICGN3D1::getInstance(int tid)
+	ICGN3D1_* ICGN3D1::getInstance()
 	{
-		if (tid >= (int)instance_pool.size())
+		ICGN3D1_* instance = instance_pool.acquire();
+		if (instance == nullptr)
 		{
-			throw std::string("CPU thread ID over limit");
+			instance = ICGN3D1_::allocate(subset_radius_x, subset_radius_y, subset_radius_z);
+			instance_pool.add(instance);
 		}
-		return instance_pool[tid];
+
+		return instance;
 	}
 
 	ICGN3D1::ICGN3D1(int subset_radius_x, int subset_radius_y, int subset_radius_z, float conv_criterion, float stop_condition, int thread_number)
-		: ref_gradient(nullptr), tar_interp(nullptr)
+		: ref_gradient(nullptr), ref_bspline(nullptr), tar_interp(nullptr), ref_cache(nullptr)
 	{
 		this->subset_radius_x = subset_radius_x;
 		this->subset_radius_y = subset_radius_y;
 		this->subset_radius_z = subset_radius_z;
 		this->conv_criterion = conv_criterion;
 		this->stop_condition = stop_condition;
+		bspline_gradient = false;
 		this->thread_number = thread_number;
 
 		for (int i = 0; i < thread_number; i++)
 		{
 			ICGN3D1_* instance = ICGN3D1_::allocate(subset_radius_x, subset_radius_y, subset_radius_z);
-			instance_pool.push_back(instance);
+			instance_pool.addFree(instance);
 		}
 	}
 
 	ICGN3D1::~ICGN3D1()
 	{
 		delete ref_gradient;
+		delete ref_bspline;
 		delete tar_interp;
+		delete ref_cache;
 
-		for (auto& instance : instance_pool)
+		for (auto& instance : instance_pool.getWorkspaces())
 		{
 			ICGN3D1_::release(instance);
 			delete instance;
@@ -944,6 +1239,30 @@ namespace opencorr
 		stop_condition = (int)poi->result.iteration;
 	}
 
+	void ICGN3D1::setBsplineGradient(bool bspline_gradient)
+	{
+		this->bspline_gradient = bspline_gradient;
+	}
+
+	void ICGN3D1::setReferenceCache(size_t memory_budget)
+	{
+		if (ref_cache != nullptr)
+		{
+			delete ref_cache;
+			ref_cache = nullptr;
+		}
+
+		if (memory_budget > 0)
+		{
+			ref_cache = new ReferenceCache(memory_budget);
+		}
+	}
+
+	ReferenceCache* ICGN3D1::getReferenceCache() const
+	{
+		return ref_cache;
+	}
+
 	void ICGN3D1::prepareRef()
 	{
 		if (ref_gradient != nullptr)
@@ -952,10 +1271,31 @@ namespace opencorr
 			ref_gradient = nullptr;
 		}
 
-		ref_gradient = new Gradient3D4(*ref_img);
-		ref_gradient->getGradientX();
-		ref_gradient->getGradientY();
-		ref_gradient->getGradientZ();
+		if (ref_bspline != nullptr)
+		{
+			delete ref_bspline;
+			ref_bspline = nullptr;
+		}
+
+		if (bspline_gradient)
+		{
+			//the gradients are evaluated only at the voxels in reference subsets
+			ref_bspline = new TricubicBspline(*ref_img);
+			ref_bspline->prepare();
+		}
+		else
+		{
+			ref_gradient = new Gradient3D4(*ref_img);
+			ref_gradient->getGradientX();
+			ref_gradient->getGradientY();
+			ref_gradient->getGradientZ();
+		}
+
+		//the cached reference data are out of date
+		if (ref_cache != nullptr)
+		{
+			ref_cache->clear();
+		}
 	}
 
 	void ICGN3D1::prepareTar()
@@ -978,8 +1318,13 @@ namespace opencorr
 
 	void ICGN3D1::compute(POI3D* poi)
 	{
-		//set instance w.r.t. thread id 
-		ICGN3D1_* cur_instance = getInstance(omp_get_thread_num());
+		computeIntraPOI(poi, 1);
+	}
+
+	void ICGN3D1::computeIntraPOI(POI3D* poi, int team_size)
+	{
+		//get a free instance from pool
+		ICGN3D1_* cur_instance = getInstance();
 
 		if ((poi->x - subset_radius_x) < 0 || (poi->y - subset_radius_y) < 0 || (poi->z - subset_radius_z) < 0
 			|| (poi->x + subset_radius_x) > (ref_img->dim_x - 1) || (poi->y + subset_radius_y) > (ref_img->dim_y - 1) || (poi->z + subset_radius_z) > (ref_img->dim_z - 1)
@@ -994,54 +1339,110 @@ namespace opencorr
 			int subset_dim_y = 2 * subset_radius_y + 1;
 			int subset_dim_z = 2 * subset_radius_z + 1;
 
-			//set reference subset
-			cur_instance->ref_subset->center = (Point3D)*poi;
-			cur_instance->ref_subset->fill(ref_img);
-			float ref_mean_norm = cur_instance->ref_subset->zeroMeanNorm();
+			int subset_size = subset_dim_x * subset_dim_y * subset_dim_z;
+
+			//get the reference data from cache if available
+			ReferenceKey ref_key = { poi->x, poi->y, poi->z, subset_radius_x, subset_radius_y, subset_radius_z };
+			std::shared_ptr<ReferenceEntry> ref_entry;
+			if (ref_cache != nullptr)
+			{
+				ref_entry = ref_cache->find(ref_key);
+			}
 
-			//build the hessian matrix
-			cur_instance->hessian.setZero();
-			for (int i = 0; i < subset_dim_z; i++)
+			float ref_mean_norm;
+			const float* ref_data = cur_instance->ref_subset->vol_mat[0][0];
+			const float* sd_data = cur_instance->sd_img[0][0][0];
+			if (ref_entry != nullptr)
 			{
-				for (int j = 0; j < subset_dim_y; j++)
+				ref_mean_norm = ref_entry->mean_norm;
+				ref_data = ref_entry->subset.data();
+				sd_data = ref_entry->sd_img.data();
+				cur_instance->inv_hessian = ref_entry->inv_hessian;
+			}
+			else
+			{
+				//set reference subset
+				cur_instance->ref_subset->center = (Point3D)*poi;
+				cur_instance->ref_subset->fill(ref_img);
+				ref_mean_norm = cur_instance->ref_subset->zeroMeanNorm();
+
+				//build the hessian matrix, the slices of subset are shared by the team
+				VolumeView gradient_x_view, gradient_y_view, gradient_z_view;
+				if (ref_gradient != nullptr)
+				{
+					gradient_x_view = VolumeView(ref_gradient->gradient_x[0][0], ref_img->dim_x, ref_img->dim_y, ref_img->dim_z);
+					gradient_y_view = VolumeView(ref_gradient->gradient_y[0][0], ref_img->dim_x, ref_img->dim_y, ref_img->dim_z);
+					gradient_z_view = VolumeView(ref_gradient->gradient_z[0][0], ref_img->dim_x, ref_img->dim_y, ref_img->dim_z);
+				}
+				cur_instance->hessian.setZero();
+#pragma omp parallel num_threads(team_size) if(team_size > 1)
 				{
-					for (int k = 0; k < subset_dim_x; k++)
+					Matrix12f local_hessian = Matrix12f::Zero();
+#pragma omp for
+					for (int i = 0; i < subset_dim_z; i++)
 					{
-						int x_local = k - subset_radius_x;
-						int y_local = j - subset_radius_y;
-						int z_local = i - subset_radius_z;
-						int x_global = (int)poi->x + x_local;
-						int y_global = (int)poi->y + y_local;
-						int z_global = (int)poi->z + z_local;
-						float ref_gradient_x = ref_gradient->gradient_x[z_global][y_global][x_global];
-						float ref_gradient_y = ref_gradient->gradient_y[z_global][y_global][x_global];
-						float ref_gradient_z = ref_gradient->gradient_z[z_global][y_global][x_global];
-
-						cur_instance->sd_img[i][j][k][0] = ref_gradient_x;
-						cur_instance->sd_img[i][j][k][1] = ref_gradient_x * x_local;
-						cur_instance->sd_img[i][j][k][2] = ref_gradient_x * y_local;
-						cur_instance->sd_img[i][j][k][3] = ref_gradient_x * z_local;
-						cur_instance->sd_img[i][j][k][4] = ref_gradient_y;
-						cur_instance->sd_img[i][j][k][5] = ref_gradient_y * x_local;
-						cur_instance->sd_img[i][j][k][6] = ref_gradient_y * y_local;
-						cur_instance->sd_img[i][j][k][7] = ref_gradient_y * z_local;
-						cur_instance->sd_img[i][j][k][8] = ref_gradient_z;
-						cur_instance->sd_img[i][j][k][9] = ref_gradient_z * x_local;
-						cur_instance->sd_img[i][j][k][10] = ref_gradient_z * y_local;
-						cur_instance->sd_img[i][j][k][11] = ref_gradient_z * z_local;
-
-						for (int r = 0; r < 12; r++)
+						for (int j = 0; j < subset_dim_y; j++)
 						{
-							for (int c = 0; c < 12; c++)
+							for (int k = 0; k < subset_dim_x; k++)
 							{
-								cur_instance->hessian(r, c) += (cur_instance->sd_img[i][j][k][r] * cur_instance->sd_img[i][j][k][c]);
+								int x_local = k - subset_radius_x;
+								int y_local = j - subset_radius_y;
+								int z_local = i - subset_radius_z;
+								int x_global = (int)poi->x + x_local;
+								int y_global = (int)poi->y + y_local;
+								int z_global = (int)poi->z + z_local;
+								float ref_gradient_x, ref_gradient_y, ref_gradient_z;
+								if (ref_bspline != nullptr)
+								{
+									ref_bspline->computeGradient(x_global, y_global, z_global, ref_gradient_x, ref_gradient_y, ref_gradient_z);
+								}
+								else
+								{
+									ref_gradient_x = gradient_x_view(z_global, y_global, x_global);
+									ref_gradient_y = gradient_y_view(z_global, y_global, x_global);
+									ref_gradient_z = gradient_z_view(z_global, y_global, x_global);
+								}
+
+								cur_instance->sd_img[i][j][k][0] = ref_gradient_x;
+								cur_instance->sd_img[i][j][k][1] = ref_gradient_x * x_local;
+								cur_instance->sd_img[i][j][k][2] = ref_gradient_x * y_local;
+								cur_instance->sd_img[i][j][k][3] = ref_gradient_x * z_local;
+								cur_instance->sd_img[i][j][k][4] = ref_gradient_y;
+								cur_instance->sd_img[i][j][k][5] = ref_gradient_y * x_local;
+								cur_instance->sd_img[i][j][k][6] = ref_gradient_y * y_local;
+								cur_instance->sd_img[i][j][k][7] = ref_gradient_y * z_local;
+								cur_instance->sd_img[i][j][k][8] = ref_gradient_z;
+								cur_instance->sd_img[i][j][k][9] = ref_gradient_z * x_local;
+								cur_instance->sd_img[i][j][k][10] = ref_gradient_z * y_local;
+								cur_instance->sd_img[i][j][k][11] = ref_gradient_z * z_local;
+
+								for (int r = 0; r < 12; r++)
+								{
+									for (int c = 0; c < 12; c++)
+									{
+										local_hessian(r, c) += (cur_instance->sd_img[i][j][k][r] * cur_instance->sd_img[i][j][k][c]);
+									}
+								}
 							}
 						}
 					}
+#pragma omp critical(icgn3d1_hessian)
+					cur_instance->hessian += local_hessian;
+				}
+				//calculate the inversed Hessian matrix
+				cur_instance->inv_hessian = cur_instance->hessian.inverse();
+
+				//store the reference data in cache
+				if (ref_cache != nullptr)
+				{
+					ref_entry = std::make_shared<ReferenceEntry>();
+					ref_entry->mean_norm = ref_mean_norm;
+					ref_entry->subset = Eigen::Map<Eigen::VectorXf>(cur_instance->ref_subset->vol_mat[0][0], subset_size);
+					ref_entry->sd_img = Eigen::Map<RowMatrixXf>(cur_instance->sd_img[0][0][0], subset_size, 12);
+					ref_entry->inv_hessian = cur_instance->inv_hessian;
+					ref_cache->insert(ref_key, ref_entry);
 				}
 			}
-			//calculate the inversed Hessian matrix
-			cur_instance->inv_hessian = cur_instance->hessian.inverse();
 
 			//set target subset
 			cur_instance->tar_subset->center = (Point3D)*poi;
@@ -1056,65 +1457,60 @@ namespace opencorr
 			Deformation3D1 p_current, p_increment;
 			p_current.setDeformation(p_initial);
 			float dp_norm_max, znssd;
-			Point3D local_coor, warped_coor, global_coor;
 			do
 			{
 				iteration_counter++;
-				//reconstruct target subset
+				//reconstruct target subset slice by slice, the warped coordinates are generated row by row
+				int slice_size = subset_dim_x * subset_dim_y;
+#pragma omp parallel for num_threads(team_size) if(team_size > 1)
 				for (int i = 0; i < subset_dim_z; i++)
 				{
 					for (int j = 0; j < subset_dim_y; j++)
 					{
-						for (int k = 0; k < subset_dim_x; k++)
-						{
-							int x_local = k - subset_radius_x;
-							int y_local = j - subset_radius_y;
-							int z_local = i - subset_radius_z;
-							local_coor.x = x_local;
-							local_coor.y = y_local;
-							local_coor.z = z_local;
-							warped_coor = p_current.warp(local_coor);
-							global_coor = cur_instance->tar_subset->center + warped_coor;
-							cur_instance->tar_subset->vol_mat[i][j][k] = tar_interp->compute(global_coor);
-						}
+						Point3D row_start(-subset_radius_x, j - subset_radius_y, i - subset_radius_z);
+						int row_index = (i * subset_dim_y + j) * subset_dim_x;
+						p_current.warpRow(row_start, subset_dim_x, cur_instance->warped_x.data() + row_index,
+							cur_instance->warped_y.data() + row_index, cur_instance->warped_z.data() + row_index);
 					}
+
+					int slice_index = i * slice_size;
+					cur_instance->warped_x.segment(slice_index, slice_size).array() += cur_instance->tar_subset->center.x;
+					cur_instance->warped_y.segment(slice_index, slice_size).array() += cur_instance->tar_subset->center.y;
+					cur_instance->warped_z.segment(slice_index, slice_size).array() += cur_instance->tar_subset->center.z;
+					tar_interp->computeBatch(cur_instance->warped_x.data() + slice_index, cur_instance->warped_y.data() + slice_index,
+						cur_instance->warped_z.data() + slice_index, cur_instance->tar_subset->vol_mat[i][0], slice_size);
 				}
 				float tar_mean_norm = cur_instance->tar_subset->zeroMeanNorm();
 
-				//calculate error image
+				//calculate error image and numerator in one pass, the subsets are stored continuously
 				float error_factor = ref_mean_norm / tar_mean_norm;
 				float squared_sum = 0;
-				for (int i = 0; i < subset_dim_z; i++)
+				float numerator[12] = { 0.f };
+				const float* tar_data = cur_instance->tar_subset->vol_mat[0][0];
+				float* error_data = cur_instance->error_img[0][0];
+#pragma omp parallel num_threads(team_size) if(team_size > 1)
 				{
-					for (int j = 0; j < subset_dim_y; j++)
+					float local_numerator[12] = { 0.f };
+#pragma omp for reduction(+:squared_sum)
+					for (int i = 0; i < subset_size; i++)
 					{
-						for (int k = 0; k < subset_dim_x; k++)
+						error_data[i] = error_factor * tar_data[i] - ref_data[i];
+						squared_sum += (error_data[i] * error_data[i]);
+						for (int l = 0; l < 12; l++)
 						{
-							cur_instance->error_img[i][j][k] = error_factor * cur_instance->tar_subset->vol_mat[i][j][k] - cur_instance->ref_subset->vol_mat[i][j][k];
-							squared_sum += (cur_instance->error_img[i][j][k] * cur_instance->error_img[i][j][k]);
+							local_numerator[l] += (sd_data[i * 12 + l] * error_data[i]);
 						}
 					}
+#pragma omp critical(icgn3d1_numerator)
+					for (int l = 0; l < 12; l++)
+					{
+						numerator[l] += local_numerator[l];
+					}
 				}
 
 				//calculate ZNSSD
 				znssd = squared_sum / (ref_mean_norm * ref_mean_norm);
 
-				//calculate numerator
-				float numerator[12] = { 0.f };
-				for (int i = 0; i < subset_dim_z; i++)
-				{
-					for (int j = 0; j < subset_dim_y; j++)
-					{
-						for (int k = 0; k < subset_dim_x; k++)
-						{
-							for (int l = 0; l < 12; l++)
-							{
-								numerator[l] += (cur_instance->sd_img[i][j][k][l] * cur_instance->error_img[i][j][k]);
-							}
-						}
-					}
-				}
-
 				//calculate dp
 				float dp[12] = { 0.f };
 				for (int i = 0; i < 12; i++)
@@ -1168,16 +1564,27 @@ namespace opencorr
 			poi->deformation.w = poi->result.w0;
 			poi->result.zncc = -5;
 		}
+
+		//return the instance to pool
+		instance_pool.release(cur_instance);
 	}
 
 	void ICGN3D1::compute(std::vector<POI3D>& poi_queue)
 	{
+		//when POIs are fewer than threads, all the threads work together on one POI after another. the team is
+		//limited by the OpenMP setting of calling thread, e.g. the share of each engine set by TiledDVC
 		int queue_length = (int)poi_queue.size();
-#pragma omp parallel for
-		for (int i = 0; i < queue_length; i++)
+		int team_size = std::min(thread_number, omp_get_max_threads());
+		if (queue_length < team_size)
 		{
-			compute(&poi_queue[i]);
+			for (int i = 0; i < queue_length; i++)
+			{
+				computeIntraPOI(&poi_queue[i], team_size);
+			}
+			return;
 		}
+
+		computeQueue(poi_queue);
 	}
 
 }//namespace opencorr
\ No newline at end of file
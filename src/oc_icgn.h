@@ -23,8 +23,11 @@
 #include "oc_image.h"
 #include "oc_interpolation.h"
 #include "oc_poi.h"
+#include "oc_simd.h"
 #include "oc_point.h"
+#include "oc_reference_cache.h"
 #include "oc_subset.h"
+#include "oc_workspace.h"
 
 namespace opencorr
 {
@@ -37,9 +40,9 @@ namespace opencorr
 	public:
 		Subset2D* ref_subset;
 		Subset2D* tar_subset;
-		Eigen::MatrixXf error_img;
 		Matrix6f hessian, inv_hessian;
-		float*** sd_img; //steepest descent image
+		RowMatrix6Xf sd_img; //steepest descent image, the pixels of subset are stored continuously for each parameter
+		Eigen::VectorXf warped_x, warped_y; //coordinates of warped subset points in target image, input of batch interpolation
 
 		static ICGN2D1_* allocate(int subset_radius_x, int subset_radius_y);
 		static void release(ICGN2D1_* instance);
@@ -51,12 +54,22 @@ namespace opencorr
 	private:
 		Interpolation2D* tar_interp; //interpolation for generating target subset during iteration
 		Gradient2D4* ref_gradient; //gradient for calculating Hessian matrix of reference subset
+		BicubicBsplineGradient* ref_bspline; //B-spline coefficients of ref image, provide the gradients instead of ref_gradient
 
 		float conv_criterion; //convergence criterion: norm of maximum deformation increment in subset
 		float stop_condition; //stop condition: max iteration
+		bool compact_interp; //use compact storage of interpolation coefficients
+		bool bspline_gradient; //get gradients of ref image from B-spline coefficients
+		bool specialized_kernel; //use the kernels specialized at compile time for the common subset radii
+		ReferenceCache* ref_cache; //optional cache of reference data, which are reused for the following target images
 
-		std::vector<ICGN2D1_*> instance_pool; //pool of instances for multi-thread processing
-		ICGN2D1_* getInstance(int tid); //get an instance according to the number of current thread id
+		WorkspacePool<ICGN2D1_> instance_pool; //pool of instances for concurrent processing
+		ICGN2D1_* getInstance(); //get a free instance, a new one is allocated if none is free
+
+		//instances for self-adaptive subset, an instance matching the subset radius of POI is preferred
+		WorkspacePool<ICGN2D1_> bucket_pool;
+		int bucket_number; //max number of instances kept for self-adaptive subset
+		ICGN2D1_* getInstance(int subset_radius_x, int subset_radius_y);
 
 	public:
 		ICGN2D1(int subset_radius_x, int subset_radius_y, float conv_criterion, float stop_condition, int thread_number);
@@ -65,14 +78,21 @@ namespace opencorr
 		void prepareRef(); //calculate gradient maps of ref image
 		void prepareTar(); //calculate interpolation coefficient look_up table of tar image
 		void prepare(); //calculate gradient maps of ref image and interpolation coefficient look_up table of tar image
+		Interpolation2D* swapTarInterpolation(Interpolation2D* tar_interp); //take over an interpolation prepared outside, return the previous one
 
 		void compute(POI2D* poi);
 		void compute(std::vector<POI2D>& poi_queue);
 
 		void setIteration(float conv_criterion, float stop_condition);
 		void setIteration(POI2D* poi);
+		void setCompactInterpolation(bool compact_interp); //true: keep one coefficient per pixel, less memory but slower interpolation
+		void setBsplineGradient(bool bspline_gradient); //true: calculate gradients of ref image from one B-spline coefficient per pixel instead of two gradient maps
+		void setSpecializedKernel(bool specialized_kernel); //true: iterate with the kernels of fixed subset dimension if the radius is 15, 16, 20 or 30, no effect unless built with AVX-512
+		void setReferenceCache(size_t memory_budget); //memory budget in bytes, 0 to disable the cache
+		ReferenceCache* getReferenceCache() const;
 
 		//functions for self-adaptive subset
+		void setBucketNumber(int bucket_number); //number of instances of different subset sizes kept without reallocation, the surplus free ones are released
 		void compute(POI2D* poi, Point2D subset_radius);
 		void compute(std::vector<POI2D>& poi_queue, Point2D subset_radius);
 	};
@@ -88,9 +108,9 @@ namespace opencorr
 	public:
 		Subset2D* ref_subset;
 		Subset2D* tar_subset;
-		Eigen::MatrixXf error_img;
 		Matrix12f hessian, inv_hessian;
-		float*** sd_img;
+		RowMatrix12Xf sd_img;
+		Eigen::VectorXf warped_x, warped_y;
 
 		static ICGN2D2_* allocate(int subset_radius_x, int subset_radius_y);
 		static void release(ICGN2D2_* instance);
@@ -102,12 +122,17 @@ namespace opencorr
 	private:
 		Interpolation2D* tar_interp;
 		Gradient2D4* ref_gradient;
+		BicubicBsplineGradient* ref_bspline;
 
 		float conv_criterion;
 		float stop_condition;
+		bool compact_interp;
+		bool bspline_gradient;
+		bool specialized_kernel;
+		ReferenceCache* ref_cache;
 
-		std::vector<ICGN2D2_*> instance_pool;
-		ICGN2D2_* getInstance(int tid);
+		WorkspacePool<ICGN2D2_> instance_pool;
+		ICGN2D2_* getInstance();
 
 	public:
 		ICGN2D2(int subset_radius_x, int subset_radius_y, float conv_criterion, float stop_condition, int thread_number);
@@ -116,12 +141,18 @@ namespace opencorr
 		void prepareRef();
 		void prepareTar();
 		void prepare();
+		Interpolation2D* swapTarInterpolation(Interpolation2D* tar_interp);
 
 		void compute(POI2D* poi);
 		void compute(std::vector<POI2D>& poi_queue);
 
 		void setIteration(float conv_criterion, float stop_condition);
 		void setIteration(POI2D* poi);
+		void setCompactInterpolation(bool compact_interp); //true: keep one coefficient per pixel, less memory but slower interpolation
+		void setBsplineGradient(bool bspline_gradient); //true: calculate gradients of ref image from one B-spline coefficient per pixel instead of two gradient maps
+		void setSpecializedKernel(bool specialized_kernel); //true: iterate with the kernels of fixed subset dimension if the radius is 15, 16, 20 or 30, no effect unless built with AVX-512
+		void setReferenceCache(size_t memory_budget); //memory budget in bytes, 0 to disable the cache
+		ReferenceCache* getReferenceCache() const;
 	};
 
 
@@ -138,6 +169,7 @@ namespace opencorr
 		float*** error_img;
 		Matrix12f hessian, inv_hessian;
 		float**** sd_img; //steepest descent image
+		Eigen::VectorXf warped_x, warped_y, warped_z; //coordinates of warped subset points in target image, input of batch interpolation
 
 		static ICGN3D1_* allocate(int subset_radius_x, int subset_radius_y, int subset_radius_z);
 		static void release(ICGN3D1_* instance);
@@ -149,12 +181,18 @@ namespace opencorr
 	private:
 		Interpolation3D* tar_interp; //interpolation for generating target subset during iteration
 		Gradient3D4* ref_gradient; //gradient for calculating Hessian matrix of reference subset
+		TricubicBspline* ref_bspline; //B-spline coefficients of ref image, provide the gradients instead of ref_gradient
+		bool bspline_gradient; //get gradients of ref image from B-spline coefficients
 
 		float conv_criterion; //convergence criterion: norm of maximum displacement increment in subset
 		float stop_condition; //stop condition: max iteration
+		ReferenceCache* ref_cache; //optional cache of reference data, which are reused for the following target images
+
+		WorkspacePool<ICGN3D1_> instance_pool; //pool of instances for concurrent processing
+		ICGN3D1_* getInstance(); //get a free instance, a new one is allocated if none is free
 
-		std::vector<ICGN3D1_*> instance_pool; //pool of instances for multi-thread processing
-		ICGN3D1_* getInstance(int tid); //get an instance according to the number of current thread id
+		//process a POI with a team of team_size threads sharing the subset, used when POIs are fewer than threads
+		void computeIntraPOI(POI3D* poi, int team_size);
 
 	public:
 		ICGN3D1(int subset_radius_x, int subset_radius_y, int subset_radius_z,
@@ -170,6 +208,9 @@ namespace opencorr
 
 		void setIteration(float conv_criterion, float stop_condition);
 		void setIteration(POI3D* poi);
+		void setBsplineGradient(bool bspline_gradient); //true: calculate gradients of ref image from one B-spline coefficient volume instead of three gradient volumes
+		void setReferenceCache(size_t memory_budget); //memory budget in bytes, 0 to disable the cache
+		ReferenceCache* getReferenceCache() const;
 	};
 
 }//namespace opencorr
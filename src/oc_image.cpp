@@ -12,8 +12,21 @@
  * More information about OpenCorr can be found at https://www.opencorr.org/
  */
 
+#include <algorithm>
 #include <fstream>
 
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include "oc_image.h"
 
 namespace opencorr
@@ -21,7 +34,7 @@ namespace opencorr
 	//2D image
 	Image2D::Image2D(int width, int height)
 	{
-		eg_mat = Eigen::MatrixXf::Zero(height, width);
+		eg_mat = RowMatrixXf::Zero(height, width);
 		this->width = width;
 		this->height = height;
 	}
@@ -93,20 +106,28 @@ namespace opencorr
 		}
 	}
 
-	Image3D::~Image3D()
+	Image3D::Image3D(std::string file_path, bool memory_mapped)
 	{
-		if (vol_mat != nullptr)
+		size_t dot_pos = file_path.find_last_of(".");
+		std::string file_ext = file_path.substr(dot_pos + 1);
+		if (memory_mapped && (file_ext == "bin" || file_ext == "BIN"))
 		{
-			delete3D(vol_mat);
+			mapBin(file_path);
+		}
+		else
+		{
+			load(file_path);
 		}
 	}
 
+	Image3D::~Image3D()
+	{
+		releaseData();
+	}
+
 	void Image3D::loadBin(std::string file_path)
 	{
-		if (vol_mat != nullptr)
-		{
-			delete3D(vol_mat);
-		}
+		releaseData();
 
 		std::ifstream file_in;
 		file_in.open(file_path, std::ios::in | std::ios::binary);
@@ -120,9 +141,9 @@ namespace opencorr
 
 		//get the length of data
 		file_in.seekg(0, file_in.end);
-		int file_length = file_in.tellg();
+		long long file_length = (long long)file_in.tellg();
 		file_in.seekg(0, file_in.beg);
-		int data_length = file_length - sizeof(int) * 3;
+		long long data_length = file_length - sizeof(int) * 3;
 
 		//head information is an array of int[3]: dimension of x, y, and z
 		int img_dimension[3];
@@ -133,7 +154,7 @@ namespace opencorr
 
 		//create a 3D matrix and fill it with the data (float) in binary file
 		vol_mat = new3D(dim_z, dim_y, dim_x);
-		int matrix_size = dim_z * dim_y * dim_x;
+		size_t matrix_size = (size_t)dim_z * dim_y * dim_x;
 		file_in.read((char*)**vol_mat, sizeof(float) * matrix_size);
 
 		file_in.close();
@@ -141,10 +162,7 @@ namespace opencorr
 
 	void Image3D::loadTiff(std::string file_path)
 	{
-		if (vol_mat != nullptr)
-		{
-			delete3D(vol_mat);
-		}
+		releaseData();
 
 		//read a tiff image consisting of multiple pages and store it in a vector of cv::Mat
 		std::vector<cv::Mat> tiff_mat;
@@ -160,14 +178,16 @@ namespace opencorr
 
 		//create a 3D matrix and fill it with the data ifnTIFF
 		vol_mat = new3D(dim_z, dim_y, dim_x);
-		int matrix_size = dim_x * dim_y * dim_z;
+		VolumeView vol_view = getView();
 #pragma omp parallel for
 		for (int i = 0; i < dim_z; i++)
 		{
 			for (int j = 0; j < dim_y; j++)
 			{
+				float* vol_row = vol_view.row(i, j);
+				const uchar* tiff_row = tiff_mat[i].ptr<uchar>(j);
 				for (int k = 0; k < dim_x; k++) {
-					vol_mat[i][j][k] = (float)tiff_mat[i].at<uchar>(j, k);
+					vol_row[k] = (float)tiff_row[k];
 				}
 			}
 		}
@@ -192,5 +212,185 @@ namespace opencorr
 		}
 	}
 
+	void Image3D::mapBin(std::string file_path)
+	{
+		releaseData();
+
+		//map the whole file, the pages are read when they are accessed
+		size_t file_length = 0;
+#ifdef _WIN32
+		HANDLE file_handle = CreateFileA(file_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file_handle == INVALID_HANDLE_VALUE)
+		{
+			std::cerr << "Failed to open bin file: " << file_path << std::endl;
+			return;
+		}
+
+		LARGE_INTEGER file_size;
+		if (GetFileSizeEx(file_handle, &file_size))
+		{
+			file_length = (size_t)file_size.QuadPart;
+		}
+
+		HANDLE map_handle = CreateFileMappingA(file_handle, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+		if (map_handle != nullptr)
+		{
+			map_address = MapViewOfFile(map_handle, FILE_MAP_COPY, 0, 0, 0);
+			CloseHandle(map_handle);
+		}
+		CloseHandle(file_handle);
+#else
+		int file_descriptor = open(file_path.c_str(), O_RDONLY);
+		if (file_descriptor < 0)
+		{
+			std::cerr << "Failed to open bin file: " << file_path << std::endl;
+			return;
+		}
+
+		struct stat file_stat;
+		if (fstat(file_descriptor, &file_stat) == 0)
+		{
+			file_length = (size_t)file_stat.st_size;
+		}
+
+		if (file_length > 0)
+		{
+			void* address = mmap(nullptr, file_length, PROT_READ | PROT_WRITE, MAP_PRIVATE, file_descriptor, 0);
+			map_address = address == MAP_FAILED ? nullptr : address;
+		}
+		close(file_descriptor);
+#endif
+
+		if (map_address == nullptr)
+		{
+			std::cerr << "Failed to map bin file: " << file_path << std::endl;
+			return;
+		}
+		map_length = file_length;
+
+		//head information is an array of int[3]: dimension of x, y, and z
+		int* img_dimension = (int*)map_address;
+		if (map_length < sizeof(int) * 3
+			|| map_length < sizeof(int) * 3 + sizeof(float) * (size_t)img_dimension[0] * img_dimension[1] * img_dimension[2])
+		{
+			std::cerr << "Incomplete bin file: " << file_path << std::endl;
+			releaseData();
+			return;
+		}
+
+		this->file_path = file_path;
+		dim_x = img_dimension[0];
+		dim_y = img_dimension[1];
+		dim_z = img_dimension[2];
+
+		//create the pointers of slices and rows over the mapped data
+		vol_mat = attach3D((float*)((char*)map_address + sizeof(int) * 3), dim_z, dim_y, dim_x);
+	}
+
+	bool Image3D::isMapped() const
+	{
+		return map_address != nullptr;
+	}
+
+	VolumeView Image3D::getSlab(int z_start, int slice_number) const
+	{
+		return getView().subVolume(0, 0, z_start, dim_x, dim_y, slice_number);
+	}
+
+	void Image3D::prefetchSlab(int z_start, int slice_number)
+	{
+		if (map_address == nullptr || vol_mat == nullptr)
+		{
+			return;
+		}
+
+		int z_end = std::min(z_start + slice_number, dim_z);
+		z_start = std::max(z_start, 0);
+		if (z_start >= z_end)
+		{
+			return;
+		}
+
+		char* slab_start = (char*)vol_mat[z_start][0];
+		size_t slab_length = sizeof(float) * (size_t)(z_end - z_start) * dim_y * dim_x;
+#ifdef _WIN32
+		WIN32_MEMORY_RANGE_ENTRY slab_range = { slab_start, slab_length };
+		PrefetchVirtualMemory(GetCurrentProcess(), 1, &slab_range, 0);
+#else
+		//the start of range must be aligned with page
+		size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+		char* page_start = (char*)((size_t)slab_start / page_size * page_size);
+		madvise(page_start, slab_length + (slab_start - page_start), MADV_WILLNEED);
+#endif
+	}
+
+	void Image3D::releaseSlab(int z_start, int slice_number)
+	{
+		if (map_address == nullptr || vol_mat == nullptr)
+		{
+			return;
+		}
+
+		int z_end = std::min(z_start + slice_number, dim_z);
+		z_start = std::max(z_start, 0);
+		if (z_start >= z_end)
+		{
+			return;
+		}
+
+		//only the pages lying entirely in the slab are dropped, as the neighboring slabs may be in use
+		size_t page_size;
+#ifdef _WIN32
+		SYSTEM_INFO system_info;
+		GetSystemInfo(&system_info);
+		page_size = (size_t)system_info.dwPageSize;
+#else
+		page_size = (size_t)sysconf(_SC_PAGESIZE);
+#endif
+		size_t slab_start = (size_t)vol_mat[z_start][0];
+		size_t slab_end = slab_start + sizeof(float) * (size_t)(z_end - z_start) * dim_y * dim_x;
+		size_t page_start = (slab_start + page_size - 1) / page_size * page_size;
+		size_t page_end = slab_end / page_size * page_size;
+		if (page_start >= page_end)
+		{
+			return;
+		}
+#ifdef _WIN32
+		//unlocking the pages not locked removes them from the working set of process
+		VirtualUnlock((void*)page_start, page_end - page_start);
+#else
+		madvise((void*)page_start, page_end - page_start, MADV_DONTNEED);
+#endif
+	}
+
+	void Image3D::releaseData()
+	{
+		if (map_address != nullptr)
+		{
+			detach3D(vol_mat);
+#ifdef _WIN32
+			UnmapViewOfFile(map_address);
+#else
+			munmap(map_address, map_length);
+#endif
+			map_address = nullptr;
+			map_length = 0;
+		}
+		else if (vol_mat != nullptr)
+		{
+			delete3D(vol_mat);
+		}
+	}
+
+	VolumeView Image3D::getView() const
+	{
+		if (vol_mat == nullptr)
+		{
+			return VolumeView();
+		}
+
+		return VolumeView(vol_mat[0][0], dim_x, dim_y, dim_z);
+	}
+
 }//namespace opencorr
 
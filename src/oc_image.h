@@ -33,7 +33,7 @@ namespace opencorr
 		std::string file_path;
 
 		cv::Mat cv_mat;
-		Eigen::MatrixXf eg_mat;
+		RowMatrixXf eg_mat;
 
 
 		Image2D(int width, int height);
@@ -53,11 +53,31 @@ namespace opencorr
 
 		Image3D(int dim_x, int dim_y, int dim_z);
 		Image3D(std::string file_path);
+		Image3D(std::string file_path, bool memory_mapped); //a bin file is mapped into memory if memory_mapped is true
 		~Image3D();
 
 		void loadBin(std::string file_path);
 		void loadTiff(std::string file_path);
 		void load(std::string file_path);
+
+		//map a bin file into memory instead of reading it, the data are paged in by the system when they are accessed.
+		//the mapping is copy-on-write, thus modification of vol_mat is allowed but never written back to the file
+		void mapBin(std::string file_path);
+		bool isMapped() const;
+
+		VolumeView getView() const; //view of vol_mat, an empty view if no data is loaded
+
+		//view of the slab consisting of slice_number slices from z_start, only the pages of a mapped file covering
+		//the accessed voxels are read
+		VolumeView getSlab(int z_start, int slice_number) const;
+		void prefetchSlab(int z_start, int slice_number); //ask the system to page in a slab of mapped file in advance
+		void releaseSlab(int z_start, int slice_number); //drop the pages of a slab of mapped file, modification of them is lost
+
+	private:
+		void* map_address = nullptr; //start of the mapped file, nullptr if the data are allocated in memory
+		size_t map_length = 0; //length of the mapped file in bytes
+
+		void releaseData(); //release the data, either allocated or mapped
 	};
 
 }//namespace opencorr
@@ -35,6 +35,18 @@ namespace opencorr
 
 		virtual void prepare() = 0;
 		virtual float compute(Point2D& location) = 0;
+
+		//estimate the grayscale values at n locations (x[i], y[i]), derived classes may override it with a vectorized version
+		virtual void computeBatch(const float* x, const float* y, float* value, int n)
+		{
+			Point2D location;
+			for (int i = 0; i < n; i++)
+			{
+				location.x = x[i];
+				location.y = y[i];
+				value[i] = compute(location);
+			}
+		}
 	};
 
 	class Interpolation3D
@@ -50,6 +62,19 @@ namespace opencorr
 
 		virtual void prepare() = 0;
 		virtual float compute(Point3D& location) = 0;
+
+		//estimate the grayscale values at n locations (x[i], y[i], z[i])
+		virtual void computeBatch(const float* x, const float* y, const float* z, float* value, int n)
+		{
+			Point3D location;
+			for (int i = 0; i < n; i++)
+			{
+				location.x = x[i];
+				location.y = y[i];
+				location.z = z[i];
+				value[i] = compute(location);
+			}
+		}
 	};
 
 }//namespace opencorr
@@ -25,10 +25,12 @@ namespace opencorr
 		NR2D1_* NR_instance = new NR2D1_;
 		NR_instance->ref_subset = new Subset2D(subset_center, subset_radius_x, subset_radius_y);
 		NR_instance->tar_subset = new Subset2D(subset_center, subset_radius_x, subset_radius_y);
-		NR_instance->tar_gradient_x = Eigen::MatrixXf::Zero(subset_height, subset_width);
-		NR_instance->tar_gradient_y = Eigen::MatrixXf::Zero(subset_height, subset_width);
-		NR_instance->error_img = Eigen::MatrixXf::Zero(subset_height, subset_width);
+		NR_instance->tar_gradient_x = RowMatrixXf::Zero(subset_height, subset_width);
+		NR_instance->tar_gradient_y = RowMatrixXf::Zero(subset_height, subset_width);
+		NR_instance->error_img = RowMatrixXf::Zero(subset_height, subset_width);
 		NR_instance->sd_img = new3D(subset_height, subset_width, 6);
+		NR_instance->warped_x = Eigen::VectorXf::Zero(subset_height * subset_width);
+		NR_instance->warped_y = Eigen::VectorXf::Zero(subset_height * subset_width);
 
 		return NR_instance;
 	}
@@ -42,6 +44,12 @@ namespace opencorr
 
 	void NR2D1_::update(NR2D1_* instance, int subset_radius_x, int subset_radius_y)
 	{
+		//the instance is reused as it is if the dimension of subset does not change
+		if (instance->ref_subset != nullptr && instance->ref_subset->radius_x == subset_radius_x && instance->ref_subset->radius_y == subset_radius_y)
+		{
+			return;
+		}
+
 		if (instance->sd_img != nullptr)
 		{
 			delete3D(instance->sd_img);
@@ -70,42 +78,44 @@ namespace opencorr
 		instance->tar_gradient_y.resize(subset_height, subset_width);
 		instance->error_img.resize(subset_height, subset_width);
 		instance->sd_img = new3D(subset_height, subset_width, 6);
+		instance->warped_x.resize(subset_height * subset_width);
+		instance->warped_y.resize(subset_height * subset_width);
 	}
 
-	NR2D1_* NR2D1::getInstance(int tid)
+	NR2D1_* NR2D1::getInstance()
 	{
-		if (tid >= (int)instance_pool.size())
+		NR2D1_* instance = instance_pool.acquire();
+		if (instance == nullptr)
 		{
-			throw std::string("CPU thread ID over limit");
+			instance = NR2D1_::allocate(subset_radius_x, subset_radius_y);
+			instance_pool.add(instance);
 		}
 
-		return instance_pool[tid];
+		return instance;
 	}
 
 	NR2D1::NR2D1(int subset_radius_x, int subset_radius_y, float conv_criterion, float stop_condition, int thread_number)
-		: tar_gradient(nullptr)
+		: tar_interp(nullptr)
 	{
 		this->subset_radius_x = subset_radius_x;
 		this->subset_radius_y = subset_radius_y;
 		this->conv_criterion = conv_criterion;
 		this->stop_condition = stop_condition;
+		compact_interp = false;
 		this->thread_number = thread_number;
 
 		for (int i = 0; i < thread_number; i++)
 		{
 			NR2D1_* instance = NR2D1_::allocate(subset_radius_x, subset_radius_y);
-			instance_pool.push_back(instance);
+			instance_pool.addFree(instance);
 		}
 	}
 
 	NR2D1::~NR2D1()
 	{
-		delete tar_gradient;
 		delete tar_interp;
-		delete tar_interp_x;
-		delete tar_interp_y;
 
-		for (auto& instance : instance_pool)
+		for (auto& instance : instance_pool.getWorkspaces())
 		{
 			NR2D1_::release(instance);
 			delete instance;
@@ -119,6 +129,11 @@ namespace opencorr
 		this->stop_condition = stop_condition;
 	}
 
+	void NR2D1::setCompactInterpolation(bool compact_interp)
+	{
+		this->compact_interp = compact_interp;
+	}
+
 	void NR2D1::setIteration(POI2D* poi)
 	{
 		conv_criterion = poi->result.convergence;
@@ -127,53 +142,22 @@ namespace opencorr
 
 	void NR2D1::prepare()
 	{
-		//create gradient maps of tar image
-		if (tar_gradient != nullptr)
-		{
-			delete tar_gradient;
-			tar_gradient = nullptr;
-		}
-		tar_gradient = new Gradient2D4(*tar_img);
-		tar_gradient->getGradientX();
-		tar_gradient->getGradientY();
-
-		//create interpolation coefficient table of tar image
+		//create interpolation coefficient table of tar image, the gradients are the derivatives of the same polynomials.
+		//unlike BicubicBsplineGradient, these derivatives are not continuous across pixels, which trades some accuracy
+		//of the gradients used in the Hessian for one table instead of three. its effect on sub-pixel accuracy is not measured
 		if (tar_interp != nullptr)
 		{
 			delete tar_interp;
 			tar_interp = nullptr;
 		}
-		tar_interp = new BicubicBspline(*tar_img);
+		tar_interp = new BicubicBspline(*tar_img, compact_interp);
 		tar_interp->prepare();
-
-		//create interpolation coefficient table of gradient along x
-		Image2D gradient_img(tar_img->width, tar_img->height);
-		gradient_img.eg_mat = tar_gradient->gradient_x;
-
-		if (tar_interp_x != nullptr)
-		{
-			delete tar_interp_x;
-			tar_interp_x = nullptr;
-		}
-		tar_interp_x = new BicubicBspline(gradient_img);
-		tar_interp_x->prepare();
-
-		//create interpolation coefficient table of gradient along y
-		gradient_img.eg_mat = tar_gradient->gradient_y;
-
-		if (tar_interp_y != nullptr)
-		{
-			delete tar_interp_y;
-			tar_interp_y = nullptr;
-		}
-		tar_interp_y = new BicubicBspline(gradient_img);
-		tar_interp_y->prepare();
 	}
 
 	void NR2D1::compute(POI2D* poi)
 	{
-		//set instance w.r.t. thread id 
-		NR2D1_* cur_instance = getInstance(omp_get_thread_num());
+		//get a free instance from pool
+		NR2D1_* cur_instance = getInstance();
 
 		if (poi->y - subset_radius_y < 0 || poi->x - subset_radius_x < 0
 			|| poi->y + subset_radius_y > ref_img->height - 1 || poi->x + subset_radius_x > ref_img->width - 1
@@ -210,19 +194,15 @@ namespace opencorr
 				//reconstruct the subsets of warped target as well as the corresponding matrices of its gradients
 				for (int r = 0; r < subset_height; r++)
 				{
-					for (int c = 0; c < subset_width; c++)
-					{
-						int x_local = c - subset_radius_x;
-						int y_local = r - subset_radius_y;
-						Point2D local_coor(x_local, y_local);
-						Point2D warped_coor = p_current.warp(local_coor);
-						Point2D global_coor = cur_instance->tar_subset->center + warped_coor;
-
-						cur_instance->tar_subset->eg_mat(r, c) = tar_interp->compute(global_coor);
-						cur_instance->tar_gradient_x(r, c) = tar_interp_x->compute(global_coor);
-						cur_instance->tar_gradient_y(r, c) = tar_interp_y->compute(global_coor);
-					}
+					Point2D row_start(-subset_radius_x, r - subset_radius_y);
+					int row_index = r * subset_width;
+					p_current.warpRow(row_start, subset_width, cur_instance->warped_x.data() + row_index, cur_instance->warped_y.data() + row_index);
 				}
+				cur_instance->warped_x.array() += cur_instance->tar_subset->center.x;
+				cur_instance->warped_y.array() += cur_instance->tar_subset->center.y;
+				int subset_size = subset_width * subset_height;
+				tar_interp->computeBatchGradient(cur_instance->warped_x.data(), cur_instance->warped_y.data(), cur_instance->tar_subset->eg_mat.data(),
+					cur_instance->tar_gradient_x.data(), cur_instance->tar_gradient_y.data(), subset_size);
 				float tar_mean_norm = cur_instance->tar_subset->zeroMeanNorm();
 
 				//build the Hessian matrix
@@ -329,16 +309,14 @@ namespace opencorr
 			poi->deformation.v = poi->result.v0;
 			poi->result.zncc = -5;
 		}
+
+		//return the instance to pool
+		instance_pool.release(cur_instance);
 	}
 
 	void NR2D1::compute(std::vector<POI2D>& poi_queue)
 	{
-		int queue_length = (int)poi_queue.size();
-#pragma omp parallel for
-		for (int i = 0; i < queue_length; i++)
-		{
-			compute(&poi_queue[i]);
-		}
+		computeQueue(poi_queue);
 	}
 
 }//namespace opencorr
\ No newline at end of file
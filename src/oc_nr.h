@@ -19,12 +19,12 @@
 
 #include "oc_cubic_bspline.h"
 #include "oc_dic.h"
-#include "oc_gradient.h"
 #include "oc_image.h"
 #include "oc_interpolation.h"
 #include "oc_poi.h"
 #include "oc_point.h"
 #include "oc_subset.h"
+#include "oc_workspace.h"
 
 namespace opencorr
 {
@@ -37,11 +37,12 @@ namespace opencorr
 	public:
 		Subset2D* ref_subset;
 		Subset2D* tar_subset;
-		Eigen::MatrixXf tar_gradient_x;
-		Eigen::MatrixXf tar_gradient_y;
-		Eigen::MatrixXf error_img;
+		RowMatrixXf tar_gradient_x;
+		RowMatrixXf tar_gradient_y;
+		RowMatrixXf error_img;
 		Matrix6f hessian, inv_hessian;
 		float*** sd_img; //steepest descent image
+		Eigen::VectorXf warped_x, warped_y; //coordinates of warped subset points in target image, input of batch interpolation
 
 		static NR2D1_* allocate(int subset_radius_x, int subset_radius_y);
 		static void release(NR2D1_* instance);
@@ -51,28 +52,27 @@ namespace opencorr
 	class NR2D1 : public DIC
 	{
 	private:
-		Gradient2D4* tar_gradient; //gradient for calculating Hessian matrix of reference subset
-		Interpolation2D* tar_interp; //interpolation for generating target subset during iteration
-		Interpolation2D* tar_interp_x; //interpolation for generating target gradient along axis-x during iteration
-		Interpolation2D* tar_interp_y; //interpolation for generating target gradient along axis-y during iteration
+		BicubicBspline* tar_interp; //interpolation for generating target subset and its gradients during iteration
 
 		float conv_criterion; //convergence criterion: norm of maximum deformation increment in subset
 		float stop_condition; //stop condition: max iteration
+		bool compact_interp; //use compact storage of interpolation coefficients
 
-		std::vector<NR2D1_*> instance_pool; //pool of instances for multi-thread processing
-		NR2D1_* getInstance(int tid); //get an instance according to the number of current thread id
+		WorkspacePool<NR2D1_> instance_pool; //pool of instances for concurrent processing
+		NR2D1_* getInstance(); //get a free instance, a new one is allocated if none is free
 
 	public:
 		NR2D1(int subset_radius_x, int subset_radius_y, float conv_criterion, float stop_condition, int thread_number);
 		~NR2D1();
 
-		void prepare(); //calculate gradient maps and interpolation coefficient tables of tar image and gradients
+		void prepare(); //calculate interpolation coefficient table of tar image
 
 		void compute(POI2D* poi);
 		void compute(std::vector<POI2D>& poi_queue);
 
 		void setIteration(float conv_criterion, float stop_condition);
 		void setIteration(POI2D* poi);
+		void setCompactInterpolation(bool compact_interp); //true: keep one coefficient per pixel, less memory but slower interpolation
 	};
 
 }//namespace opencorr
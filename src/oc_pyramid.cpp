@@ -0,0 +1,438 @@
+/*
+ * This file is part of OpenCorr, an open source C++ library for
+ * study and development of 2D, 3D/stereo and volumetric
+ * digital image correlation.
+ *
+ * Copyright (C) 2021, Zhenyu Jiang <zhenyujiang@scut.edu.cn>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one from http://mozilla.org/MPL/2.0/.
+ *
+ * More information about OpenCorr can be found at https://www.opencorr.org/
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "oc_pyramid.h"
+
+namespace opencorr
+{
+	//binomial approximation of Gaussian kernel
+	const float PYRAMID_KERNEL[5] = { 1.f / 16, 4.f / 16, 6.f / 16, 4.f / 16, 1.f / 16 };
+
+	//standard deviation of Gaussian kernel for volumes, same as the one of binomial kernel
+	const float PYRAMID_SIGMA = 1.f;
+
+	//smallest dimension of volume to be blurred, i.e. the size of Gaussian kernel (6 * sigma + 1)
+	const int PYRAMID_MIN_DIM = 7;
+
+	//index reflected at the borders, the border pixel itself is not repeated
+	inline int mirrorIndex(int index, int length)
+	{
+		if (length == 1)
+		{
+			return 0;
+		}
+		if (index < 0)
+		{
+			index = -index;
+		}
+		if (index >= length)
+		{
+			index = 2 * length - 2 - index;
+		}
+
+		return index;
+	}
+
+	void pyramidDown(Image2D& src_img, Image2D& dst_img)
+	{
+		int width = src_img.width;
+		int height = src_img.height;
+		int dst_width = dst_img.width;
+		int dst_height = dst_img.height;
+
+		//filter along x-axis at the even columns, then along y-axis at the even rows
+		RowMatrixXf row_filtered(height, dst_width);
+#pragma omp parallel for
+		for (int r = 0; r < height; r++)
+		{
+			for (int c = 0; c < dst_width; c++)
+			{
+				float sum = 0;
+				for (int k = -2; k <= 2; k++)
+				{
+					sum += PYRAMID_KERNEL[k + 2] * src_img.eg_mat(r, mirrorIndex(2 * c + k, width));
+				}
+				row_filtered(r, c) = sum;
+			}
+		}
+
+#pragma omp parallel for
+		for (int r = 0; r < dst_height; r++)
+		{
+			for (int c = 0; c < dst_width; c++)
+			{
+				float sum = 0;
+				for (int k = -2; k <= 2; k++)
+				{
+					sum += PYRAMID_KERNEL[k + 2] * row_filtered(mirrorIndex(2 * r + k, height), c);
+				}
+				dst_img.eg_mat(r, c) = sum;
+			}
+		}
+	}
+
+	void pyramidDown(Image3D& src_img, Image3D& dst_img)
+	{
+		int src_dim[3] = { src_img.dim_x, src_img.dim_y, src_img.dim_z };
+		int dst_dim[3] = { dst_img.dim_x, dst_img.dim_y, dst_img.dim_z };
+		float unit[3] = { 1.f, 1.f, 1.f };
+
+		SIFT3D sift;
+		Image3D blurred_img(src_img.dim_x, src_img.dim_y, src_img.dim_z);
+		sift.gaussianBlur(src_img.vol_mat, blurred_img.vol_mat, src_dim, unit, PYRAMID_SIGMA);
+		sift.downSampling(blurred_img.vol_mat, dst_img.vol_mat, dst_dim);
+	}
+
+	PyramidFFTCC2D::PyramidFFTCC2D(int subset_radius_x, int subset_radius_y, int level_number, int thread_number)
+	{
+		this->subset_radius_x = subset_radius_x;
+		this->subset_radius_y = subset_radius_y;
+		this->level_number = level_number > 1 ? level_number : 1;
+		this->thread_number = thread_number;
+
+		for (int i = 0; i < this->level_number; i++)
+		{
+			fftcc_queue.push_back(new FFTCC2D(subset_radius_x, subset_radius_y, thread_number));
+		}
+	}
+
+	PyramidFFTCC2D::~PyramidFFTCC2D()
+	{
+		releasePyramid(ref_pyramid);
+		releasePyramid(tar_pyramid);
+
+		for (auto fftcc : fftcc_queue)
+		{
+			delete fftcc;
+		}
+		fftcc_queue.clear();
+	}
+
+	void PyramidFFTCC2D::releasePyramid(std::vector<Image2D*>& pyramid)
+	{
+		for (auto img : pyramid)
+		{
+			delete img;
+		}
+		pyramid.clear();
+	}
+
+	void PyramidFFTCC2D::buildPyramid(Image2D* img, std::vector<Image2D*>& pyramid)
+	{
+		releasePyramid(pyramid);
+
+		Image2D* src_img = img;
+		for (int i = 1; i < level_number; i++)
+		{
+			Image2D* dst_img = new Image2D((src_img->width + 1) / 2, (src_img->height + 1) / 2);
+			pyramidDown(*src_img, *dst_img);
+			pyramid.push_back(dst_img);
+			src_img = dst_img;
+		}
+	}
+
+	void PyramidFFTCC2D::setLevelImages()
+	{
+		fftcc_queue[0]->setImages(*ref_img, *tar_img);
+
+		//the coarse levels are handed over when both pyramids are ready
+		if ((int)ref_pyramid.size() == level_number - 1 && (int)tar_pyramid.size() == level_number - 1)
+		{
+			for (int i = 1; i < level_number; i++)
+			{
+				fftcc_queue[i]->setImages(*ref_pyramid[i - 1], *tar_pyramid[i - 1]);
+			}
+		}
+	}
+
+	bool PyramidFFTCC2D::isInside(Image2D* img, float x, float y) const
+	{
+		return x - subset_radius_x >= 0 && x + subset_radius_x < img->width
+			&& y - subset_radius_y >= 0 && y + subset_radius_y < img->height;
+	}
+
+	void PyramidFFTCC2D::prepareRef()
+	{
+		buildPyramid(ref_img, ref_pyramid);
+		setLevelImages();
+	}
+
+	void PyramidFFTCC2D::prepareTar()
+	{
+		buildPyramid(tar_img, tar_pyramid);
+		setLevelImages();
+	}
+
+	void PyramidFFTCC2D::prepare()
+	{
+		prepareRef();
+		prepareTar();
+	}
+
+	void PyramidFFTCC2D::compute(POI2D* poi)
+	{
+		//the initial guess of POI is the start at the coarsest level
+		float u = std::isnan(poi->deformation.u) ? 0.f : poi->deformation.u;
+		float v = std::isnan(poi->deformation.v) ? 0.f : poi->deformation.v;
+		poi->result.u0 = u;
+		poi->result.v0 = v;
+
+		bool matched = false;
+		for (int level = level_number - 1; level >= 0; level--)
+		{
+			Image2D* level_ref = level > 0 ? ref_pyramid[level - 1] : ref_img;
+			Image2D* level_tar = level > 0 ? tar_pyramid[level - 1] : tar_img;
+			float scale = (float)(1 << level);
+
+			//at a coarse level, the subset near the borders is moved inwards, its displacement is taken as an estimate
+			//for the POI. the displacement is rounded, as FFTCC takes the target subset at integer pixels
+			POI2D level_poi(poi->x / scale, poi->y / scale);
+			if (level > 0)
+			{
+				level_poi.x = std::max((float)subset_radius_x, std::min(level_poi.x, (float)(level_ref->width - 1 - subset_radius_x)));
+				level_poi.y = std::max((float)subset_radius_y, std::min(level_poi.y, (float)(level_ref->height - 1 - subset_radius_y)));
+			}
+			level_poi.deformation.u = std::round(u / scale);
+			level_poi.deformation.v = std::round(v / scale);
+
+			//the level is skipped if the subsets are not inside its images, the estimate is passed to the next level
+			if (!isInside(level_ref, level_poi.x, level_poi.y)
+				|| !isInside(level_tar, level_poi.x + level_poi.deformation.u, level_poi.y + level_poi.deformation.v))
+			{
+				continue;
+			}
+
+			fftcc_queue[level]->compute(&level_poi);
+			if (std::isnan(level_poi.result.zncc))
+			{
+				continue;
+			}
+
+			u = level_poi.deformation.u * scale;
+			v = level_poi.deformation.v * scale;
+			if (level == 0)
+			{
+				poi->result.zncc = level_poi.result.zncc;
+				poi->result.feature = level_poi.result.feature;
+				matched = true;
+			}
+		}
+
+		poi->deformation.u = u;
+		poi->deformation.v = v;
+		if (!matched)
+		{
+			poi->result.zncc = -1;
+		}
+	}
+
+	void PyramidFFTCC2D::compute(std::vector<POI2D>& poi_queue)
+	{
+		computeQueue(poi_queue);
+	}
+
+	void PyramidFFTCC2D::setPeakFit(PeakFit peak_fit)
+	{
+		for (auto fftcc : fftcc_queue)
+		{
+			fftcc->setPeakFit(peak_fit);
+		}
+	}
+
+	int PyramidFFTCC2D::getLevelNumber() const
+	{
+		return level_number;
+	}
+
+
+	PyramidFFTCC3D::PyramidFFTCC3D(int subset_radius_x, int subset_radius_y, int subset_radius_z, int level_number, int thread_number)
+	{
+		this->subset_radius_x = subset_radius_x;
+		this->subset_radius_y = subset_radius_y;
+		this->subset_radius_z = subset_radius_z;
+		this->level_number = level_number > 1 ? level_number : 1;
+		this->thread_number = thread_number;
+
+		for (int i = 0; i < this->level_number; i++)
+		{
+			fftcc_queue.push_back(new FFTCC3D(subset_radius_x, subset_radius_y, subset_radius_z, thread_number));
+		}
+	}
+
+	PyramidFFTCC3D::~PyramidFFTCC3D()
+	{
+		releasePyramid(ref_pyramid);
+		releasePyramid(tar_pyramid);
+
+		for (auto fftcc : fftcc_queue)
+		{
+			delete fftcc;
+		}
+		fftcc_queue.clear();
+	}
+
+	void PyramidFFTCC3D::releasePyramid(std::vector<Image3D*>& pyramid)
+	{
+		for (auto img : pyramid)
+		{
+			delete img;
+		}
+		pyramid.clear();
+	}
+
+	void PyramidFFTCC3D::buildPyramid(Image3D* img, std::vector<Image3D*>& pyramid)
+	{
+		releasePyramid(pyramid);
+
+		Image3D* src_img = img;
+		for (int i = 1; i < level_number; i++)
+		{
+			if (src_img->dim_x < PYRAMID_MIN_DIM || src_img->dim_y < PYRAMID_MIN_DIM || src_img->dim_z < PYRAMID_MIN_DIM)
+			{
+				break;
+			}
+
+			Image3D* dst_img = new Image3D((src_img->dim_x + 1) / 2, (src_img->dim_y + 1) / 2, (src_img->dim_z + 1) / 2);
+			pyramidDown(*src_img, *dst_img);
+			pyramid.push_back(dst_img);
+			src_img = dst_img;
+		}
+	}
+
+	void PyramidFFTCC3D::setLevelImages()
+	{
+		fftcc_queue[0]->setImages(*ref_img, *tar_img);
+
+		//the coarse levels are handed over when both pyramids are ready
+		if (ref_pyramid.size() == tar_pyramid.size())
+		{
+			for (int i = 1; i <= (int)ref_pyramid.size(); i++)
+			{
+				fftcc_queue[i]->setImages(*ref_pyramid[i - 1], *tar_pyramid[i - 1]);
+			}
+		}
+	}
+
+	bool PyramidFFTCC3D::isInside(Image3D* img, float x, float y, float z) const
+	{
+		return x - subset_radius_x >= 0 && x + subset_radius_x < img->dim_x
+			&& y - subset_radius_y >= 0 && y + subset_radius_y < img->dim_y
+			&& z - subset_radius_z >= 0 && z + subset_radius_z < img->dim_z;
+	}
+
+	void PyramidFFTCC3D::prepareRef()
+	{
+		buildPyramid(ref_img, ref_pyramid);
+		setLevelImages();
+	}
+
+	void PyramidFFTCC3D::prepareTar()
+	{
+		buildPyramid(tar_img, tar_pyramid);
+		setLevelImages();
+	}
+
+	void PyramidFFTCC3D::prepare()
+	{
+		prepareRef();
+		prepareTar();
+	}
+
+	void PyramidFFTCC3D::compute(POI3D* poi)
+	{
+		//the initial guess of POI is the start at the coarsest level
+		float u = std::isnan(poi->deformation.u) ? 0.f : poi->deformation.u;
+		float v = std::isnan(poi->deformation.v) ? 0.f : poi->deformation.v;
+		float w = std::isnan(poi->deformation.w) ? 0.f : poi->deformation.w;
+		poi->result.u0 = u;
+		poi->result.v0 = v;
+		poi->result.w0 = w;
+
+		int built_level_number = (int)std::min(ref_pyramid.size(), tar_pyramid.size()) + 1;
+		bool matched = false;
+		for (int level = built_level_number - 1; level >= 0; level--)
+		{
+			Image3D* level_ref = level > 0 ? ref_pyramid[level - 1] : ref_img;
+			Image3D* level_tar = level > 0 ? tar_pyramid[level - 1] : tar_img;
+			float scale = (float)(1 << level);
+
+			//at a coarse level, the subset near the borders is moved inwards, its displacement is taken as an estimate
+			//for the POI. the displacement is rounded, as FFTCC takes the target subset at integer voxels
+			POI3D level_poi(poi->x / scale, poi->y / scale, poi->z / scale);
+			if (level > 0)
+			{
+				level_poi.x = std::max((float)subset_radius_x, std::min(level_poi.x, (float)(level_ref->dim_x - 1 - subset_radius_x)));
+				level_poi.y = std::max((float)subset_radius_y, std::min(level_poi.y, (float)(level_ref->dim_y - 1 - subset_radius_y)));
+				level_poi.z = std::max((float)subset_radius_z, std::min(level_poi.z, (float)(level_ref->dim_z - 1 - subset_radius_z)));
+			}
+			level_poi.deformation.u = std::round(u / scale);
+			level_poi.deformation.v = std::round(v / scale);
+			level_poi.deformation.w = std::round(w / scale);
+
+			//the level is skipped if the subsets are not inside its volumes, the estimate is passed to the next level
+			if (!isInside(level_ref, level_poi.x, level_poi.y, level_poi.z)
+				|| !isInside(level_tar, level_poi.x + level_poi.deformation.u, level_poi.y + level_poi.deformation.v,
+					level_poi.z + level_poi.deformation.w))
+			{
+				continue;
+			}
+
+			fftcc_queue[level]->compute(&level_poi);
+			if (std::isnan(level_poi.result.zncc))
+			{
+				continue;
+			}
+
+			u = level_poi.deformation.u * scale;
+			v = level_poi.deformation.v * scale;
+			w = level_poi.deformation.w * scale;
+			if (level == 0)
+			{
+				poi->result.zncc = level_poi.result.zncc;
+				poi->result.feature = level_poi.result.feature;
+				matched = true;
+			}
+		}
+
+		poi->deformation.u = u;
+		poi->deformation.v = v;
+		poi->deformation.w = w;
+		if (!matched)
+		{
+			poi->result.zncc = -1;
+		}
+	}
+
+	void PyramidFFTCC3D::compute(std::vector<POI3D>& poi_queue)
+	{
+		computeQueue(poi_queue);
+	}
+
+	void PyramidFFTCC3D::setPeakFit(PeakFit peak_fit)
+	{
+		for (auto fftcc : fftcc_queue)
+		{
+			fftcc->setPeakFit(peak_fit);
+		}
+	}
+
+	int PyramidFFTCC3D::getLevelNumber() const
+	{
+		return level_number;
+	}
+
+}//namespace opencorr
\ No newline at end of file
@@ -0,0 +1,108 @@
+/*
+ * This file is part of OpenCorr, an open source C++ library for
+ * study and development of 2D, 3D/stereo and volumetric
+ * digital image correlation.
+ *
+ * Copyright (C) 2021, Zhenyu Jiang <zhenyujiang@scut.edu.cn>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one from http://mozilla.org/MPL/2.0/.
+ *
+ * More information about OpenCorr can be found at https://www.opencorr.org/
+ */
+
+#pragma once
+
+#ifndef _PYRAMID_H_
+#define _PYRAMID_H_
+
+#include <vector>
+
+#include "oc_array.h"
+#include "oc_dic.h"
+#include "oc_fftcc.h"
+#include "oc_image.h"
+#include "oc_poi.h"
+#include "oc_point.h"
+#include "oc_sift.h"
+
+namespace opencorr
+{
+	//blur an image with the 5-tap binomial filter [1 4 6 4 1]/16 and downsample it by 2 along each axis,
+	//the borders are mirrored. dst_img should be of size ((width + 1) / 2, (height + 1) / 2)
+	void pyramidDown(Image2D& src_img, Image2D& dst_img);
+
+	//blur a volume with the Gaussian kernel (sigma of 1 voxel) and downsample it by 2 along each axis, using the
+	//functions of SIFT3D. dst_img should be of size ((dim_x + 1) / 2, (dim_y + 1) / 2, (dim_z + 1) / 2)
+	void pyramidDown(Image3D& src_img, Image3D& dst_img);
+
+	//coarse-to-fine estimation of large displacement. Gaussian pyramids of the reference and target images are built
+	//once in preparation, the displacement is estimated by FFTCC at the coarsest level, and then propagated to and
+	//refined at each finer level. the subset at level n covers 2^n times the region of the subset in original image,
+	//thus the displacement up to about subset radius * 2^(level_number - 1) pixels can be determined
+	class PyramidFFTCC2D : public DIC
+	{
+	private:
+		int level_number; //number of levels including the original images
+		std::vector<Image2D*> ref_pyramid; //downsampled images from level 1 to the coarsest level
+		std::vector<Image2D*> tar_pyramid;
+		std::vector<FFTCC2D*> fftcc_queue; //engines working at each level, from level 0 to the coarsest level
+
+		void releasePyramid(std::vector<Image2D*>& pyramid);
+		void buildPyramid(Image2D* img, std::vector<Image2D*>& pyramid);
+		void setLevelImages(); //hand the images of each level over to the engines
+
+		//check if a subset around (x, y) is inside the image of a level
+		bool isInside(Image2D* img, float x, float y) const;
+
+	public:
+		PyramidFFTCC2D(int subset_radius_x, int subset_radius_y, int level_number, int thread_number);
+		~PyramidFFTCC2D();
+
+		void prepareRef(); //build the pyramid of ref image
+		void prepareTar(); //build the pyramid of tar image
+		void prepare(); //build the pyramids of ref image and tar image
+
+		void compute(POI2D* poi);
+		void compute(std::vector<POI2D>& poi_queue);
+
+		void setPeakFit(PeakFit peak_fit); //sub-pixel estimation of correlation peak at each level
+		int getLevelNumber() const;
+	};
+
+	//volumetric counterpart of PyramidFFTCC2D, the estimated displacements serve as the initial guess of ICGN3D1.
+	//the pyramids stop at the level of which the volume is too small for the Gaussian kernel
+	class PyramidFFTCC3D : public DVC
+	{
+	private:
+		int level_number; //number of levels including the original volumes
+		std::vector<Image3D*> ref_pyramid; //downsampled volumes from level 1 to the coarsest level
+		std::vector<Image3D*> tar_pyramid;
+		std::vector<FFTCC3D*> fftcc_queue; //engines working at each level, from level 0 to the coarsest level
+
+		void releasePyramid(std::vector<Image3D*>& pyramid);
+		void buildPyramid(Image3D* img, std::vector<Image3D*>& pyramid);
+		void setLevelImages(); //hand the volumes of each level over to the engines
+
+		//check if a subset around (x, y, z) is inside the volume of a level
+		bool isInside(Image3D* img, float x, float y, float z) const;
+
+	public:
+		PyramidFFTCC3D(int subset_radius_x, int subset_radius_y, int subset_radius_z, int level_number, int thread_number);
+		~PyramidFFTCC3D();
+
+		void prepareRef(); //build the pyramid of ref image
+		void prepareTar(); //build the pyramid of tar image
+		void prepare(); //build the pyramids of ref image and tar image
+
+		void compute(POI3D* poi);
+		void compute(std::vector<POI3D>& poi_queue);
+
+		void setPeakFit(PeakFit peak_fit); //sub-pixel estimation of correlation peak at each level
+		int getLevelNumber() const;
+	};
+
+}//namespace opencorr
+
+#endif //_PYRAMID_H_
\ No newline at end of file
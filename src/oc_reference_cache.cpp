@@ -0,0 +1,138 @@
+/*
+ * This file is part of OpenCorr, an open source C++ library for
+ * study and development of 2D, 3D/stereo and volumetric
+ * digital image correlation.
+ *
+ * Copyright (C) 2021, Zhenyu Jiang <zhenyujiang@scut.edu.cn>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one from http://mozilla.org/MPL/2.0/.
+ *
+ * More information about OpenCorr can be found at https://www.opencorr.org/
+ */
+
+#include <functional>
+
+#include "oc_reference_cache.h"
+
+namespace opencorr
+{
+	size_t ReferenceKeyHash::operator()(const ReferenceKey& key) const
+	{
+		std::hash<float> float_hash;
+		size_t seed = float_hash(key.x);
+		seed ^= float_hash(key.y) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+		seed ^= float_hash(key.z) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+		seed ^= (size_t)(key.radius_x * 73856093 ^ key.radius_y * 19349663 ^ key.radius_z * 83492791) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+		return seed;
+	}
+
+	size_t ReferenceEntry::memorySize() const
+	{
+		return sizeof(ReferenceEntry) + sizeof(float) * (subset.size() + sd_img.size() + inv_hessian.size());
+	}
+
+	ReferenceCache::ReferenceCache(size_t memory_budget)
+		: memory_budget(memory_budget), memory_usage(0), hit_number(0), miss_number(0)
+	{
+		omp_init_lock(&cache_lock);
+	}
+
+	ReferenceCache::~ReferenceCache()
+	{
+		clear();
+		omp_destroy_lock(&cache_lock);
+	}
+
+	size_t ReferenceCache::getMemoryBudget() const
+	{
+		return memory_budget;
+	}
+
+	size_t ReferenceCache::getMemoryUsage() const
+	{
+		return memory_usage;
+	}
+
+	long long ReferenceCache::getHitNumber() const
+	{
+		return hit_number;
+	}
+
+	long long ReferenceCache::getMissNumber() const
+	{
+		return miss_number;
+	}
+
+	void ReferenceCache::setMemoryBudget(size_t memory_budget)
+	{
+		omp_set_lock(&cache_lock);
+		this->memory_budget = memory_budget;
+		evict(0);
+		omp_unset_lock(&cache_lock);
+	}
+
+	void ReferenceCache::evict(size_t reserved_size)
+	{
+		while (!entry_list.empty() && memory_usage + reserved_size > memory_budget)
+		{
+			memory_usage -= entry_list.back().second->memorySize();
+			entry_map.erase(entry_list.back().first);
+			entry_list.pop_back();
+		}
+	}
+
+	std::shared_ptr<ReferenceEntry> ReferenceCache::find(const ReferenceKey& key)
+	{
+		std::shared_ptr<ReferenceEntry> entry;
+
+		omp_set_lock(&cache_lock);
+		auto map_item = entry_map.find(key);
+		if (map_item != entry_map.end())
+		{
+			//move the entry to the front of list
+			entry_list.splice(entry_list.begin(), entry_list, map_item->second);
+			entry = map_item->second->second;
+			hit_number++;
+		}
+		else
+		{
+			miss_number++;
+		}
+		omp_unset_lock(&cache_lock);
+
+		return entry;
+	}
+
+	void ReferenceCache::insert(const ReferenceKey& key, std::shared_ptr<ReferenceEntry> entry)
+	{
+		size_t entry_size = entry->memorySize();
+		if (entry_size > memory_budget)
+		{
+			return;
+		}
+
+		omp_set_lock(&cache_lock);
+		if (entry_map.find(key) == entry_map.end())
+		{
+			evict(entry_size);
+			entry_list.push_front(std::make_pair(key, entry));
+			entry_map[key] = entry_list.begin();
+			memory_usage += entry_size;
+		}
+		omp_unset_lock(&cache_lock);
+	}
+
+	void ReferenceCache::clear()
+	{
+		omp_set_lock(&cache_lock);
+		entry_map.clear();
+		entry_list.clear();
+		memory_usage = 0;
+		hit_number = 0;
+		miss_number = 0;
+		omp_unset_lock(&cache_lock);
+	}
+
+}//namespace opencorr
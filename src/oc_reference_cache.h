@@ -0,0 +1,92 @@
+/*
+ * This file is part of OpenCorr, an open source C++ library for
+ * study and development of 2D, 3D/stereo and volumetric
+ * digital image correlation.
+ *
+ * Copyright (C) 2021, Zhenyu Jiang <zhenyujiang@scut.edu.cn>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one from http://mozilla.org/MPL/2.0/.
+ *
+ * More information about OpenCorr can be found at https://www.opencorr.org/
+ */
+
+#pragma once
+
+#ifndef _REFERENCE_CACHE_H_
+#define _REFERENCE_CACHE_H_
+
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <omp.h>
+
+#include "oc_array.h"
+
+namespace opencorr
+{
+	//key of the reference data, the location of POI and the radii of subset
+	struct ReferenceKey
+	{
+		float x, y, z;
+		int radius_x, radius_y, radius_z;
+
+		bool operator==(const ReferenceKey& another_key) const
+		{
+			return x == another_key.x && y == another_key.y && z == another_key.z
+				&& radius_x == another_key.radius_x && radius_y == another_key.radius_y && radius_z == another_key.radius_z;
+		}
+	};
+
+	struct ReferenceKeyHash
+	{
+		size_t operator()(const ReferenceKey& key) const;
+	};
+
+	//data of a POI which depend only on the reference image
+	class ReferenceEntry
+	{
+	public:
+		float mean_norm; //norm of the zero-mean reference subset
+		Eigen::VectorXf subset; //zero-mean reference subset
+		RowMatrixXf sd_img; //steepest descent image, in the same layout as the one in engine
+		Eigen::MatrixXf inv_hessian; //inversed Hessian matrix
+
+		size_t memorySize() const;
+	};
+
+	//cache of reference data shared by the threads of an engine, the least recently used entries
+	//are evicted when the memory budget is exceeded. entries in use are kept alive by their shared pointers
+	class ReferenceCache
+	{
+	private:
+		size_t memory_budget; //in bytes
+		size_t memory_usage; //in bytes
+		long long hit_number, miss_number;
+
+		std::list<std::pair<ReferenceKey, std::shared_ptr<ReferenceEntry>>> entry_list; //the most recently used entry at the front
+		std::unordered_map<ReferenceKey, std::list<std::pair<ReferenceKey, std::shared_ptr<ReferenceEntry>>>::iterator, ReferenceKeyHash> entry_map;
+		omp_lock_t cache_lock;
+
+		void evict(size_t reserved_size); //evict entries until the reserved size fits in the budget
+
+	public:
+		ReferenceCache(size_t memory_budget);
+		~ReferenceCache();
+
+		size_t getMemoryBudget() const;
+		size_t getMemoryUsage() const;
+		long long getHitNumber() const;
+		long long getMissNumber() const;
+		void setMemoryBudget(size_t memory_budget);
+
+		std::shared_ptr<ReferenceEntry> find(const ReferenceKey& key); //return nullptr if the key is not cached
+		void insert(const ReferenceKey& key, std::shared_ptr<ReferenceEntry> entry);
+		void clear(); //to be called when the reference image changes
+	};
+
+}//namespace opencorr
+
+#endif //_REFERENCE_CACHE_H_
\ No newline at end of file
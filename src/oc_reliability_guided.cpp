@@ -0,0 +1,728 @@
+/*
+ * This file is part of OpenCorr, an open source C++ library for
+ * study and development of 2D, 3D/stereo and volumetric
+ * digital image correlation.
+ *
+ * Copyright (C) 2021, Zhenyu Jiang <zhenyujiang@scut.edu.cn>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one from http://mozilla.org/MPL/2.0/.
+ *
+ * More information about OpenCorr can be found at https://www.opencorr.org/
+ */
+
+#include <algorithm>
+#include <thread>
+
+#include "oc_reliability_guided.h"
+
+namespace opencorr
+{
+	//state of POI during propagation
+	enum PropagationState
+	{
+		untouched = 0,
+		processing = 1,
+		processed = 2
+	};
+
+	PropagationQueue::PropagationQueue(int thread_number)
+	{
+		node_queue.resize(thread_number);
+		queue_lock.resize(thread_number);
+		for (int i = 0; i < thread_number; i++)
+		{
+			omp_init_lock(&queue_lock[i]);
+		}
+		pending_number = 0;
+	}
+
+	PropagationQueue::~PropagationQueue()
+	{
+		for (int i = 0; i < (int)queue_lock.size(); i++)
+		{
+			omp_destroy_lock(&queue_lock[i]);
+		}
+	}
+
+	void PropagationQueue::push(int tid, PropagationNode& node)
+	{
+		pending_number++;
+		omp_set_lock(&queue_lock[tid]);
+		node_queue[tid].push(node);
+		omp_unset_lock(&queue_lock[tid]);
+	}
+
+	bool PropagationQueue::pop(int tid, PropagationNode& node)
+	{
+		int queue_number = (int)node_queue.size();
+
+		//start from the queue of current thread, then try to steal from the others
+		for (int i = 0; i < queue_number; i++)
+		{
+			int queue_idx = (tid + i) % queue_number;
+			bool popped = false;
+
+			omp_set_lock(&queue_lock[queue_idx]);
+			if (!node_queue[queue_idx].empty())
+			{
+				node = node_queue[queue_idx].top();
+				node_queue[queue_idx].pop();
+				popped = true;
+			}
+			omp_unset_lock(&queue_lock[queue_idx]);
+
+			if (popped)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void PropagationQueue::finish()
+	{
+		pending_number--;
+	}
+
+	bool PropagationQueue::isFinished() const
+	{
+		return pending_number.load() == 0;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////
+
+	//get the deformation at the offset (dx, dy) from the center of a deformed subset
+	void shiftDeformation(DeformationVector2D& deformation, float dx, float dy, DeformationVector2D& shifted_deformation)
+	{
+		shifted_deformation = deformation;
+
+		shifted_deformation.u = deformation.u + deformation.ux * dx + deformation.uy * dy
+			+ 0.5f * deformation.uxx * dx * dx + deformation.uxy * dx * dy + 0.5f * deformation.uyy * dy * dy;
+		shifted_deformation.ux = deformation.ux + deformation.uxx * dx + deformation.uxy * dy;
+		shifted_deformation.uy = deformation.uy + deformation.uxy * dx + deformation.uyy * dy;
+
+		shifted_deformation.v = deformation.v + deformation.vx * dx + deformation.vy * dy
+			+ 0.5f * deformation.vxx * dx * dx + deformation.vxy * dx * dy + 0.5f * deformation.vyy * dy * dy;
+		shifted_deformation.vx = deformation.vx + deformation.vxx * dx + deformation.vxy * dy;
+		shifted_deformation.vy = deformation.vy + deformation.vxy * dx + deformation.vyy * dy;
+	}
+
+	void shiftDeformation(DeformationVector3D& deformation, float dx, float dy, float dz, DeformationVector3D& shifted_deformation)
+	{
+		shifted_deformation = deformation;
+		shifted_deformation.u = deformation.u + deformation.ux * dx + deformation.uy * dy + deformation.uz * dz;
+		shifted_deformation.v = deformation.v + deformation.vx * dx + deformation.vy * dy + deformation.vz * dz;
+		shifted_deformation.w = deformation.w + deformation.wx * dx + deformation.wy * dy + deformation.wz * dz;
+	}
+
+	//get the interval of a regular grid along one axis
+	float gridStep(std::vector<float>& coor)
+	{
+		std::sort(coor.begin(), coor.end());
+
+		float step = 0.f;
+		for (int i = 1; i < (int)coor.size(); i++)
+		{
+			float interval = coor[i] - coor[i - 1];
+			if (interval > 0.5f && (step == 0.f || interval < step))
+			{
+				step = interval;
+			}
+		}
+
+		return step > 0.f ? step : 1.f;
+	}
+
+	ReliabilityGuidedDIC::ReliabilityGuidedDIC(DIC* engine, int thread_number)
+	{
+		this->thread_number = thread_number;
+		zncc_threshold = 0.9f;
+		setEngine(engine);
+	}
+
+	ReliabilityGuidedDIC::~ReliabilityGuidedDIC() {}
+
+	float ReliabilityGuidedDIC::getZnccThreshold() const
+	{
+		return zncc_threshold;
+	}
+
+	void ReliabilityGuidedDIC::setZnccThreshold(float zncc_threshold)
+	{
+		this->zncc_threshold = zncc_threshold;
+	}
+
+	void ReliabilityGuidedDIC::setEngine(DIC* engine)
+	{
+		this->engine = engine;
+		subset_radius_x = engine->subset_radius_x;
+		subset_radius_y = engine->subset_radius_y;
+	}
+
+	void ReliabilityGuidedDIC::setSeedEngine(DIC* seed_engine)
+	{
+		this->seed_engine = seed_engine;
+	}
+
+	void ReliabilityGuidedDIC::setSeeds(std::vector<int>& seed_index)
+	{
+		this->seed_index = seed_index;
+	}
+
+	void ReliabilityGuidedDIC::prepare()
+	{
+		if (seed_engine != nullptr)
+		{
+			seed_engine->setImages(*ref_img, *tar_img);
+			seed_engine->prepare();
+		}
+
+		engine->setImages(*ref_img, *tar_img);
+		engine->prepare();
+	}
+
+	void ReliabilityGuidedDIC::buildNeighbors(std::vector<POI2D>& poi_queue, std::vector<int>& neighbor_index)
+	{
+		int queue_length = (int)poi_queue.size();
+
+		//estimate the layout of grid
+		std::vector<float> coor_x(queue_length), coor_y(queue_length);
+		for (int i = 0; i < queue_length; i++)
+		{
+			coor_x[i] = poi_queue[i].x;
+			coor_y[i] = poi_queue[i].y;
+		}
+		float step_x = gridStep(coor_x);
+		float step_y = gridStep(coor_y);
+		float min_x = coor_x.front();
+		float min_y = coor_y.front();
+		int grid_width = (int)((coor_x.back() - min_x) / step_x + 0.5f) + 1;
+		int grid_height = (int)((coor_y.back() - min_y) / step_y + 0.5f) + 1;
+
+		//put POIs into the grid, a POI sharing a node with another one is left without neighbors
+		std::vector<int> grid_node(grid_width * grid_height, -1);
+		std::vector<int> node_index(queue_length, -1);
+		for (int i = 0; i < queue_length; i++)
+		{
+			int c = (int)((poi_queue[i].x - min_x) / step_x + 0.5f);
+			int r = (int)((poi_queue[i].y - min_y) / step_y + 0.5f);
+			if (grid_node[r * grid_width + c] < 0)
+			{
+				grid_node[r * grid_width + c] = i;
+				node_index[i] = r * grid_width + c;
+			}
+		}
+
+		neighbor_index.assign(4 * queue_length, -1);
+		for (int i = 0; i < queue_length; i++)
+		{
+			if (node_index[i] < 0)
+			{
+				continue;
+			}
+
+			int c = node_index[i] % grid_width;
+			int r = node_index[i] / grid_width;
+			if (c > 0)
+				neighbor_index[4 * i] = grid_node[node_index[i] - 1];
+			if (c < grid_width - 1)
+				neighbor_index[4 * i + 1] = grid_node[node_index[i] + 1];
+			if (r > 0)
+				neighbor_index[4 * i + 2] = grid_node[node_index[i] - grid_width];
+			if (r < grid_height - 1)
+				neighbor_index[4 * i + 3] = grid_node[node_index[i] + grid_width];
+		}
+	}
+
+	bool ReliabilityGuidedDIC::guessDeformation(std::vector<POI2D>& poi_queue, std::vector<int>& neighbor_index,
+		std::atomic<int>* poi_state, int poi_idx)
+	{
+		//find the processed neighbor with the highest ZNCC
+		int best_idx = -1;
+		for (int i = 0; i < 4; i++)
+		{
+			int neighbor_idx = neighbor_index[4 * poi_idx + i];
+			if (neighbor_idx >= 0 && poi_state[neighbor_idx].load() == processed && poi_queue[neighbor_idx].result.zncc > 0
+				&& (best_idx < 0 || poi_queue[neighbor_idx].result.zncc > poi_queue[best_idx].result.zncc))
+			{
+				best_idx = neighbor_idx;
+			}
+		}
+
+		POI2D* poi = &poi_queue[poi_idx];
+		std::fill(std::begin(poi->result.r), std::end(poi->result.r), 0.f);
+		if (best_idx < 0)
+		{
+			return false;
+		}
+
+		shiftDeformation(poi_queue[best_idx].deformation, poi->x - poi_queue[best_idx].x, poi->y - poi_queue[best_idx].y, poi->deformation);
+		return true;
+	}
+
+	void ReliabilityGuidedDIC::compute(POI2D* poi)
+	{
+		engine->compute(poi);
+	}
+
+	void ReliabilityGuidedDIC::compute(std::vector<POI2D>& poi_queue)
+	{
+		int queue_length = (int)poi_queue.size();
+		if (queue_length == 0)
+		{
+			return;
+		}
+
+		std::vector<int> neighbor_index;
+		buildNeighbors(poi_queue, neighbor_index);
+
+		std::vector<std::atomic<int>> poi_state(queue_length);
+		for (int i = 0; i < queue_length; i++)
+		{
+			poi_state[i] = untouched;
+		}
+
+		//select seeds, use the POI closest to the center of POI queue by default
+		std::vector<int> seeds;
+		for (int i = 0; i < (int)seed_index.size(); i++)
+		{
+			if (seed_index[i] >= 0 && seed_index[i] < queue_length && poi_state[seed_index[i]] == untouched)
+			{
+				seeds.push_back(seed_index[i]);
+				poi_state[seed_index[i]] = processing;
+			}
+		}
+		if (seeds.empty())
+		{
+			Point2D center(0.f, 0.f);
+			for (int i = 0; i < queue_length; i++)
+			{
+				center = center + (Point2D)poi_queue[i];
+			}
+			center = center * (1.f / queue_length);
+
+			int center_idx = 0;
+			for (int i = 1; i < queue_length; i++)
+			{
+				if ((poi_queue[i] - center).vectorNorm() < (poi_queue[center_idx] - center).vectorNorm())
+				{
+					center_idx = i;
+				}
+			}
+			seeds.push_back(center_idx);
+		}
+
+		//process seeds
+		int seed_number = (int)seeds.size();
+#pragma omp parallel for
+		for (int i = 0; i < seed_number; i++)
+		{
+			POI2D* seed = &poi_queue[seeds[i]];
+			if (seed_engine != nullptr)
+			{
+				seed_engine->compute(seed);
+			}
+			std::fill(std::begin(seed->result.r), std::end(seed->result.r), 0.f);
+			engine->compute(seed);
+		}
+
+		PropagationQueue propagation_queue(thread_number);
+		for (int i = 0; i < seed_number; i++)
+		{
+			poi_state[seeds[i]] = processed;
+			if (poi_queue[seeds[i]].result.zncc >= zncc_threshold)
+			{
+				PropagationNode node = { poi_queue[seeds[i]].result.zncc, seeds[i] };
+				propagation_queue.push(i % thread_number, node);
+			}
+		}
+
+		//propagate from the most reliable POI to its untouched neighbors
+#pragma omp parallel num_threads(thread_number)
+		{
+			int tid = omp_get_thread_num();
+			PropagationNode node;
+			while (!propagation_queue.isFinished())
+			{
+				if (!propagation_queue.pop(tid, node))
+				{
+					std::this_thread::yield();
+					continue;
+				}
+
+				for (int i = 0; i < 4; i++)
+				{
+					int neighbor_idx = neighbor_index[4 * node.poi_idx + i];
+					int expected_state = untouched;
+					if (neighbor_idx >= 0 && poi_state[neighbor_idx].compare_exchange_strong(expected_state, processing))
+					{
+						guessDeformation(poi_queue, neighbor_index, poi_state.data(), neighbor_idx);
+						engine->compute(&poi_queue[neighbor_idx]);
+						poi_state[neighbor_idx] = processed;
+
+						if (poi_queue[neighbor_idx].result.zncc >= zncc_threshold)
+						{
+							PropagationNode neighbor_node = { poi_queue[neighbor_idx].result.zncc, neighbor_idx };
+							propagation_queue.push(tid, neighbor_node);
+						}
+					}
+				}
+				propagation_queue.finish();
+			}
+		}
+
+		//process the POIs not reached by propagation, using the guess from neighbors if available
+		std::vector<int> rest_index;
+		for (int i = 0; i < queue_length; i++)
+		{
+			if (poi_state[i] == untouched)
+			{
+				rest_index.push_back(i);
+			}
+		}
+
+		int rest_number = (int)rest_index.size();
+#pragma omp parallel for
+		for (int i = 0; i < rest_number; i++)
+		{
+			POI2D* poi = &poi_queue[rest_index[i]];
+			if (!guessDeformation(poi_queue, neighbor_index, poi_state.data(), rest_index[i]) && seed_engine != nullptr)
+			{
+				seed_engine->compute(poi);
+				std::fill(std::begin(poi->result.r), std::end(poi->result.r), 0.f);
+			}
+			engine->compute(poi);
+		}
+	}
+
+	//////////////////////////////////////////////////////////////////////////////
+
+	ReliabilityGuidedDVC::ReliabilityGuidedDVC(DVC* engine, int thread_number)
+	{
+		this->thread_number = thread_number;
+		zncc_threshold = 0.9f;
+		connectivity = 6;
+		brick_x = 8;
+		brick_y = 8;
+		brick_z = 8;
+		setEngine(engine);
+	}
+
+	ReliabilityGuidedDVC::~ReliabilityGuidedDVC() {}
+
+	float ReliabilityGuidedDVC::getZnccThreshold() const
+	{
+		return zncc_threshold;
+	}
+
+	int ReliabilityGuidedDVC::getConnectivity() const
+	{
+		return connectivity;
+	}
+
+	void ReliabilityGuidedDVC::setZnccThreshold(float zncc_threshold)
+	{
+		this->zncc_threshold = zncc_threshold;
+	}
+
+	void ReliabilityGuidedDVC::setConnectivity(int connectivity)
+	{
+		if (connectivity != 6 && connectivity != 26)
+		{
+			std::cerr << "Connectivity should be 6 or 26" << std::endl;
+			return;
+		}
+		this->connectivity = connectivity;
+	}
+
+	void ReliabilityGuidedDVC::setBrick(int brick_x, int brick_y, int brick_z)
+	{
+		this->brick_x = brick_x > 0 ? brick_x : 1;
+		this->brick_y = brick_y > 0 ? brick_y : 1;
+		this->brick_z = brick_z > 0 ? brick_z : 1;
+	}
+
+	void ReliabilityGuidedDVC::setEngine(DVC* engine)
+	{
+		this->engine = engine;
+		subset_radius_x = engine->subset_radius_x;
+		subset_radius_y = engine->subset_radius_y;
+		subset_radius_z = engine->subset_radius_z;
+	}
+
+	void ReliabilityGuidedDVC::setSeedEngine(DVC* seed_engine)
+	{
+		this->seed_engine = seed_engine;
+	}
+
+	void ReliabilityGuidedDVC::setSeeds(std::vector<int>& seed_index)
+	{
+		this->seed_index = seed_index;
+	}
+
+	void ReliabilityGuidedDVC::prepare()
+	{
+		if (seed_engine != nullptr)
+		{
+			seed_engine->setImages(*ref_img, *tar_img);
+			seed_engine->prepare();
+		}
+
+		engine->setImages(*ref_img, *tar_img);
+		engine->prepare();
+	}
+
+	void ReliabilityGuidedDVC::buildNeighbors(std::vector<POI3D>& poi_queue, std::vector<int>& neighbor_index, std::vector<int>& brick_index, int& brick_number)
+	{
+		int queue_length = (int)poi_queue.size();
+
+		//estimate the layout of grid
+		std::vector<float> coor_x(queue_length), coor_y(queue_length), coor_z(queue_length);
+		for (int i = 0; i < queue_length; i++)
+		{
+			coor_x[i] = poi_queue[i].x;
+			coor_y[i] = poi_queue[i].y;
+			coor_z[i] = poi_queue[i].z;
+		}
+		float step_x = gridStep(coor_x);
+		float step_y = gridStep(coor_y);
+		float step_z = gridStep(coor_z);
+		float min_x = coor_x.front();
+		float min_y = coor_y.front();
+		float min_z = coor_z.front();
+		int grid_dim_x = (int)((coor_x.back() - min_x) / step_x + 0.5f) + 1;
+		int grid_dim_y = (int)((coor_y.back() - min_y) / step_y + 0.5f) + 1;
+		int grid_dim_z = (int)((coor_z.back() - min_z) / step_z + 0.5f) + 1;
+
+		int brick_dim_x = (grid_dim_x + brick_x - 1) / brick_x;
+		int brick_dim_y = (grid_dim_y + brick_y - 1) / brick_y;
+		int brick_dim_z = (grid_dim_z + brick_z - 1) / brick_z;
+		brick_number = brick_dim_x * brick_dim_y * brick_dim_z;
+
+		//put POIs into the grid, a POI sharing a node with another one is left without neighbors
+		std::vector<int> grid_node((size_t)grid_dim_x * grid_dim_y * grid_dim_z, -1);
+		std::vector<int> node_x(queue_length), node_y(queue_length), node_z(queue_length);
+		std::vector<bool> in_grid(queue_length, false);
+		brick_index.resize(queue_length);
+		for (int i = 0; i < queue_length; i++)
+		{
+			node_x[i] = (int)((poi_queue[i].x - min_x) / step_x + 0.5f);
+			node_y[i] = (int)((poi_queue[i].y - min_y) / step_y + 0.5f);
+			node_z[i] = (int)((poi_queue[i].z - min_z) / step_z + 0.5f);
+			brick_index[i] = ((node_z[i] / brick_z) * brick_dim_y + node_y[i] / brick_y) * brick_dim_x + node_x[i] / brick_x;
+
+			int node_idx = (node_z[i] * grid_dim_y + node_y[i]) * grid_dim_x + node_x[i];
+			if (grid_node[node_idx] < 0)
+			{
+				grid_node[node_idx] = i;
+				in_grid[i] = true;
+			}
+		}
+
+		neighbor_index.assign((size_t)connectivity * queue_length, -1);
+		for (int i = 0; i < queue_length; i++)
+		{
+			if (!in_grid[i])
+			{
+				continue;
+			}
+
+			int neighbor_count = 0;
+			for (int dz = -1; dz <= 1; dz++)
+			{
+				for (int dy = -1; dy <= 1; dy++)
+				{
+					for (int dx = -1; dx <= 1; dx++)
+					{
+						int offset_sum = abs(dx) + abs(dy) + abs(dz);
+						if (offset_sum == 0 || (connectivity == 6 && offset_sum != 1))
+						{
+							continue;
+						}
+
+						int x = node_x[i] + dx;
+						int y = node_y[i] + dy;
+						int z = node_z[i] + dz;
+						if (x >= 0 && x < grid_dim_x && y >= 0 && y < grid_dim_y && z >= 0 && z < grid_dim_z)
+						{
+							neighbor_index[connectivity * i + neighbor_count] = grid_node[(z * grid_dim_y + y) * grid_dim_x + x];
+						}
+						neighbor_count++;
+					}
+				}
+			}
+		}
+	}
+
+	bool ReliabilityGuidedDVC::guessDeformation(std::vector<POI3D>& poi_queue, std::vector<int>& neighbor_index, std::vector<int>& brick_index,
+		std::atomic<int>* poi_state, int poi_idx, int brick_idx)
+	{
+		//find the processed neighbor with the highest ZNCC, the brick is checked first as the POIs in other bricks
+		//may be under processing by other threads
+		int best_idx = -1;
+		for (int i = 0; i < connectivity; i++)
+		{
+			int neighbor_idx = neighbor_index[connectivity * poi_idx + i];
+			if (neighbor_idx >= 0 && (brick_idx < 0 || brick_index[neighbor_idx] == brick_idx)
+				&& poi_state[neighbor_idx] == processed && poi_queue[neighbor_idx].result.zncc > 0
+				&& (best_idx < 0 || poi_queue[neighbor_idx].result.zncc > poi_queue[best_idx].result.zncc))
+			{
+				best_idx = neighbor_idx;
+			}
+		}
+
+		POI3D* poi = &poi_queue[poi_idx];
+		std::fill(std::begin(poi->result.r), std::end(poi->result.r), 0.f);
+		if (best_idx < 0)
+		{
+			return false;
+		}
+
+		shiftDeformation(poi_queue[best_idx].deformation, poi->x - poi_queue[best_idx].x, poi->y - poi_queue[best_idx].y,
+			poi->z - poi_queue[best_idx].z, poi->deformation);
+		return true;
+	}
+
+	void ReliabilityGuidedDVC::compute(POI3D* poi)
+	{
+		engine->compute(poi);
+	}
+
+	void ReliabilityGuidedDVC::compute(std::vector<POI3D>& poi_queue)
+	{
+		int queue_length = (int)poi_queue.size();
+		if (queue_length == 0)
+		{
+			return;
+		}
+
+		std::vector<int> neighbor_index, brick_index;
+		int brick_number;
+		buildNeighbors(poi_queue, neighbor_index, brick_index, brick_number);
+
+		//select seeds, use the POI closest to the center of brick if no seed is given in it
+		std::vector<std::vector<int>> brick_seeds(brick_number);
+		for (int i = 0; i < (int)seed_index.size(); i++)
+		{
+			if (seed_index[i] >= 0 && seed_index[i] < queue_length)
+			{
+				brick_seeds[brick_index[seed_index[i]]].push_back(seed_index[i]);
+			}
+		}
+
+		std::vector<Point3D> brick_center(brick_number, Point3D(0.f, 0.f, 0.f));
+		std::vector<int> brick_size(brick_number, 0);
+		for (int i = 0; i < queue_length; i++)
+		{
+			brick_center[brick_index[i]] = brick_center[brick_index[i]] + (Point3D)poi_queue[i];
+			brick_size[brick_index[i]]++;
+		}
+
+		std::vector<int> center_idx(brick_number, -1);
+		for (int i = 0; i < queue_length; i++)
+		{
+			int b = brick_index[i];
+			if (brick_seeds[b].empty())
+			{
+				Point3D center = brick_center[b] * (1.f / brick_size[b]);
+				if (center_idx[b] < 0 || (poi_queue[i] - center).vectorNorm() < (poi_queue[center_idx[b]] - center).vectorNorm())
+				{
+					center_idx[b] = i;
+				}
+			}
+		}
+		for (int b = 0; b < brick_number; b++)
+		{
+			if (center_idx[b] >= 0)
+			{
+				brick_seeds[b].push_back(center_idx[b]);
+			}
+		}
+
+		//process the bricks in parallel, the propagation stays inside each brick
+		std::vector<std::atomic<int>> poi_state(queue_length);
+		for (int i = 0; i < queue_length; i++)
+		{
+			poi_state[i] = untouched;
+		}
+
+#pragma omp parallel for schedule(dynamic) num_threads(thread_number)
+		for (int b = 0; b < brick_number; b++)
+		{
+			std::priority_queue<PropagationNode> node_queue;
+			for (int i = 0; i < (int)brick_seeds[b].size(); i++)
+			{
+				int poi_idx = brick_seeds[b][i];
+				if (poi_state[poi_idx] != untouched)
+				{
+					continue;
+				}
+
+				POI3D* seed = &poi_queue[poi_idx];
+				if (seed_engine != nullptr)
+				{
+					seed_engine->compute(seed);
+				}
+				std::fill(std::begin(seed->result.r), std::end(seed->result.r), 0.f);
+				engine->compute(seed);
+				poi_state[poi_idx] = processed;
+
+				if (seed->result.zncc >= zncc_threshold)
+				{
+					PropagationNode node = { seed->result.zncc, poi_idx };
+					node_queue.push(node);
+				}
+			}
+
+			while (!node_queue.empty())
+			{
+				PropagationNode node = node_queue.top();
+				node_queue.pop();
+
+				for (int i = 0; i < connectivity; i++)
+				{
+					int neighbor_idx = neighbor_index[connectivity * node.poi_idx + i];
+					if (neighbor_idx >= 0 && brick_index[neighbor_idx] == b && poi_state[neighbor_idx] == untouched)
+					{
+						guessDeformation(poi_queue, neighbor_index, brick_index, poi_state.data(), neighbor_idx, b);
+						engine->compute(&poi_queue[neighbor_idx]);
+						poi_state[neighbor_idx] = processed;
+
+						if (poi_queue[neighbor_idx].result.zncc >= zncc_threshold)
+						{
+							PropagationNode neighbor_node = { poi_queue[neighbor_idx].result.zncc, neighbor_idx };
+							node_queue.push(neighbor_node);
+						}
+					}
+				}
+			}
+		}
+
+		//process the POIs not reached by propagation, using the guess from neighbors in any brick if available
+		std::vector<int> rest_index;
+		for (int i = 0; i < queue_length; i++)
+		{
+			if (poi_state[i] == untouched)
+			{
+				rest_index.push_back(i);
+			}
+		}
+
+		int rest_number = (int)rest_index.size();
+#pragma omp parallel for num_threads(thread_number)
+		for (int i = 0; i < rest_number; i++)
+		{
+			POI3D* poi = &poi_queue[rest_index[i]];
+			if (!guessDeformation(poi_queue, neighbor_index, brick_index, poi_state.data(), rest_index[i], -1) && seed_engine != nullptr)
+			{
+				seed_engine->compute(poi);
+				std::fill(std::begin(poi->result.r), std::end(poi->result.r), 0.f);
+			}
+			engine->compute(poi);
+		}
+	}
+
+}//namespace opencorr
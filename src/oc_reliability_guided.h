@@ -0,0 +1,144 @@
+/*
+ * This file is part of OpenCorr, an open source C++ library for
+ * study and development of 2D, 3D/stereo and volumetric
+ * digital image correlation.
+ *
+ * Copyright (C) 2021, Zhenyu Jiang <zhenyujiang@scut.edu.cn>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one from http://mozilla.org/MPL/2.0/.
+ *
+ * More information about OpenCorr can be found at https://www.opencorr.org/
+ */
+
+#pragma once
+
+#ifndef _RELIABILITY_GUIDED_H_
+#define _RELIABILITY_GUIDED_H_
+
+#include <atomic>
+#include <queue>
+#include <vector>
+#include <omp.h>
+
+#include "oc_array.h"
+#include "oc_dic.h"
+#include "oc_image.h"
+#include "oc_poi.h"
+#include "oc_point.h"
+
+namespace opencorr
+{
+	//node in the propagation queue, POIs with higher ZNCC are processed first
+	struct PropagationNode
+	{
+		float zncc;
+		int poi_idx; //index in POI queue
+
+		bool operator<(const PropagationNode& another_node) const
+		{
+			return zncc < another_node.zncc;
+		}
+	};
+
+	//priority queues for multi-thread propagation, one queue with its own lock per thread.
+	//an idle thread steals the most reliable node from the queues of other threads
+	class PropagationQueue
+	{
+	private:
+		std::vector<std::priority_queue<PropagationNode>> node_queue;
+		std::vector<omp_lock_t> queue_lock;
+		std::atomic<int> pending_number; //nodes pushed but not finished yet
+
+	public:
+		PropagationQueue(int thread_number);
+		~PropagationQueue();
+
+		void push(int tid, PropagationNode& node);
+		bool pop(int tid, PropagationNode& node);
+
+		//to be called after all the child nodes of a popped node have been pushed
+		void finish();
+		bool isFinished() const;
+	};
+
+
+	//this module is the implementation of reliability-guided displacement tracking, see
+	//B. Pan, Measurement Science and Technology (2009) 20: 025106.
+	//https://doi.org/10.1088/0957-0233/20/2/025106
+	//the POIs are expected to be arranged in a regular grid, the initial guess of each POI
+	//is taken from its converged neighbor with the highest ZNCC
+
+	class ReliabilityGuidedDIC : public DIC
+	{
+	protected:
+		DIC* engine = nullptr; //engine for refinement, e.g. ICGN2D1, ICGN2D2 or NR2D1
+		DIC* seed_engine = nullptr; //optional engine to estimate the initial guess of seeds, e.g. FFTCC2D
+		float zncc_threshold; //POIs with ZNCC lower than the threshold do not propagate their deformation
+		std::vector<int> seed_index; //indices of seeds in POI queue, the POI closest to the center is used if empty
+
+		//find 4-connected neighbors of POIs in a regular grid, -1 for missing neighbor
+		void buildNeighbors(std::vector<POI2D>& poi_queue, std::vector<int>& neighbor_index);
+
+		//set the initial guess of a POI according to the deformation of its best converged neighbor
+		bool guessDeformation(std::vector<POI2D>& poi_queue, std::vector<int>& neighbor_index,
+			std::atomic<int>* poi_state, int poi_idx);
+
+	public:
+		ReliabilityGuidedDIC(DIC* engine, int thread_number);
+		~ReliabilityGuidedDIC();
+
+		float getZnccThreshold() const;
+		void setZnccThreshold(float zncc_threshold);
+		void setEngine(DIC* engine);
+		void setSeedEngine(DIC* seed_engine);
+		void setSeeds(std::vector<int>& seed_index);
+
+		void prepare();
+		void compute(POI2D* poi);
+		void compute(std::vector<POI2D>& poi_queue);
+	};
+
+
+	//3D version of reliability-guided displacement tracking. the grid of POIs is divided into bricks,
+	//which are processed in parallel, each brick grows from its own seeds
+	class ReliabilityGuidedDVC : public DVC
+	{
+	protected:
+		DVC* engine = nullptr; //engine for refinement, e.g. ICGN3D1
+		DVC* seed_engine = nullptr; //optional engine to estimate the initial guess of seeds, e.g. FFTCC3D or FeatureAffine3D
+		float zncc_threshold; //POIs with ZNCC lower than the threshold do not propagate their deformation
+		int connectivity; //6 or 26 connected neighbors in the grid
+		int brick_x, brick_y, brick_z; //dimensions of a brick, in number of POIs along each axis
+		std::vector<int> seed_index; //indices of seeds in POI queue, the POI closest to the center of each brick is used if no seed locates in it
+
+		//find connected neighbors of POIs in a regular grid (-1 for missing neighbor) and the brick each POI belongs to
+		void buildNeighbors(std::vector<POI3D>& poi_queue, std::vector<int>& neighbor_index, std::vector<int>& brick_index, int& brick_number);
+
+		//set the initial guess of a POI according to the deformation of its best processed neighbor,
+		//only the neighbors in the same brick are considered if brick_idx is not negative
+		bool guessDeformation(std::vector<POI3D>& poi_queue, std::vector<int>& neighbor_index, std::vector<int>& brick_index,
+			std::atomic<int>* poi_state, int poi_idx, int brick_idx);
+
+	public:
+		ReliabilityGuidedDVC(DVC* engine, int thread_number);
+		~ReliabilityGuidedDVC();
+
+		float getZnccThreshold() const;
+		int getConnectivity() const;
+		void setZnccThreshold(float zncc_threshold);
+		void setConnectivity(int connectivity);
+		void setBrick(int brick_x, int brick_y, int brick_z);
+		void setEngine(DVC* engine);
+		void setSeedEngine(DVC* seed_engine);
+		void setSeeds(std::vector<int>& seed_index);
+
+		void prepare();
+		void compute(POI3D* poi);
+		void compute(std::vector<POI3D>& poi_queue);
+	};
+
+}//namespace opencorr
+
+#endif //_RELIABILITY_GUIDED_H_
\ No newline at end of file
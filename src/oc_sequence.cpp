@@ -0,0 +1,220 @@
+/*
+ * This file is part of OpenCorr, an open source C++ library for
+ * study and development of 2D, 3D/stereo and volumetric
+ * digital image correlation.
+ *
+ * Copyright (C) 2021, Zhenyu Jiang <zhenyujiang@scut.edu.cn>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one from http://mozilla.org/MPL/2.0/.
+ *
+ * More information about OpenCorr can be found at https://www.opencorr.org/
+ */
+
+#include <cmath>
+#include <iostream>
+#include <thread>
+#include <omp.h>
+
+#include "oc_sequence.h"
+
+namespace opencorr
+{
+	SequenceDIC::SequenceDIC(DIC* engine, int thread_number)
+	{
+		this->engine = engine;
+		this->thread_number = thread_number > 0 ? thread_number : 1;
+		prepare_thread_number = this->thread_number;
+		queue_capacity = 2;
+		compact_interp = false;
+		ref_update = ReferenceUpdate::accumulative;
+	}
+
+	SequenceDIC::~SequenceDIC() {}
+
+	void SequenceDIC::setEngine(DIC* engine)
+	{
+		this->engine = engine;
+	}
+
+	void SequenceDIC::setSeedEngine(DIC* seed_engine)
+	{
+		this->seed_engine = seed_engine;
+	}
+
+	void SequenceDIC::setFrames(std::vector<std::string>& frame_path)
+	{
+		this->frame_path = frame_path;
+	}
+
+	void SequenceDIC::setReferenceUpdate(ReferenceUpdate ref_update)
+	{
+		this->ref_update = ref_update;
+	}
+
+	void SequenceDIC::setQueueCapacity(int queue_capacity)
+	{
+		this->queue_capacity = queue_capacity > 0 ? queue_capacity : 1;
+	}
+
+	void SequenceDIC::setPrepareThreadNumber(int prepare_thread_number)
+	{
+		this->prepare_thread_number = prepare_thread_number > 0 ? prepare_thread_number : 1;
+	}
+
+	void SequenceDIC::setCompactInterpolation(bool compact_interp)
+	{
+		this->compact_interp = compact_interp;
+	}
+
+	void SequenceDIC::setOutputPath(std::string output_path)
+	{
+		this->output_path = output_path;
+	}
+
+	void SequenceDIC::output(int frame_idx, std::vector<POI2D>& poi_queue)
+	{
+		if (output_path.empty())
+		{
+			return;
+		}
+
+		IO2D in_out;
+		in_out.setDelimiter(",");
+		in_out.setPath(output_path + "_" + std::to_string(frame_idx) + ".csv");
+		in_out.saveTable2D(poi_queue);
+	}
+
+	void SequenceDIC::seedNextFrame(std::vector<POI2D>& poi_queue, std::vector<POI2D>& initial_queue)
+	{
+		int queue_length = (int)poi_queue.size();
+		for (int i = 0; i < queue_length; i++)
+		{
+			POI2D& cur_poi = poi_queue[i];
+			if (cur_poi.result.zncc < 0 || std::isnan(cur_poi.deformation.u) || std::isnan(cur_poi.deformation.v))
+			{
+				cur_poi.deformation = initial_queue[i].deformation;
+			}
+
+			//the deformation of current frame serves as the initial guess of next frame
+			cur_poi.result = initial_queue[i].result;
+			cur_poi.result.zncc = 0.f;
+		}
+	}
+
+	void SequenceDIC::compute(std::vector<POI2D>& poi_queue)
+	{
+		int frame_number = (int)frame_path.size();
+		if (frame_number < 2)
+		{
+			std::cerr << "At least two frames are required in sequence" << std::endl;
+			return;
+		}
+
+		//stage 1: load the target frames
+		StageQueue<SequenceFrame> loaded_queue(queue_capacity);
+		std::thread load_thread([&]()
+			{
+				for (int i = 1; i < frame_number; i++)
+				{
+					SequenceFrame frame = { i, new Image2D(frame_path[i]), nullptr };
+					loaded_queue.push(frame);
+				}
+				loaded_queue.close();
+			});
+
+		//stage 2: prepare the interpolation coefficients. a frame is prepared only after the engine takes over
+		//the previous one, thus one interpolation is built while the other one is used by the engine
+		StageQueue<SequenceFrame> prepared_queue(1);
+		StageQueue<int> free_buffer(1);
+		free_buffer.push(0);
+		std::thread prepare_thread([&]()
+			{
+				omp_set_num_threads(prepare_thread_number);
+
+				SequenceFrame frame;
+				int buffer_idx;
+				while (loaded_queue.pop(frame))
+				{
+					free_buffer.pop(buffer_idx);
+					frame.interp = new BicubicBspline(*frame.img, compact_interp);
+					frame.interp->prepare();
+					prepared_queue.push(frame);
+				}
+				prepared_queue.close();
+			});
+
+		//stage 3: match the prepared frames, the OpenMP setting is per thread and does not affect stage 2.
+		//the setting of caller is restored when the sequence is finished
+		int caller_thread_number = omp_get_max_threads();
+		omp_set_num_threads(thread_number);
+		Image2D* ref_img = new Image2D(frame_path[0]);
+		engine->setImages(*ref_img, *ref_img);
+		engine->prepareRef();
+
+		std::vector<POI2D> initial_queue = poi_queue;
+		SequenceFrame cur_frame = { 0, nullptr, nullptr };
+		SequenceFrame next_frame;
+		while (prepared_queue.pop(next_frame))
+		{
+			engine->setImages(*ref_img, *next_frame.img);
+
+			//hand over the interpolation of next frame to engine, and release the one of current frame
+			Interpolation2D* previous_interp = engine->swapTarInterpolation(next_frame.interp);
+			if (previous_interp == next_frame.interp)
+			{
+				engine->prepare();
+			}
+			delete previous_interp;
+			free_buffer.push(0);
+
+			if (cur_frame.img != nullptr && cur_frame.img != ref_img)
+			{
+				delete cur_frame.img;
+			}
+			cur_frame = next_frame;
+
+			//estimate the initial guess at the first target frame
+			if (cur_frame.frame_idx == 1 && seed_engine != nullptr)
+			{
+				seed_engine->setImages(*ref_img, *cur_frame.img);
+				seed_engine->prepare();
+				seed_engine->compute(poi_queue);
+				initial_queue = poi_queue;
+			}
+
+			engine->compute(poi_queue);
+			output(cur_frame.frame_idx, poi_queue);
+
+			if (cur_frame.frame_idx < frame_number - 1)
+			{
+				seedNextFrame(poi_queue, initial_queue);
+
+				//current frame becomes the reference of next frame
+				if (ref_update == ReferenceUpdate::incremental)
+				{
+					delete ref_img;
+					ref_img = cur_frame.img;
+					engine->setImages(*ref_img, *ref_img);
+					engine->prepareRef();
+				}
+			}
+		}
+
+		load_thread.join();
+		prepare_thread.join();
+
+		//take back the interpolation of the last frame before its image is released
+		Interpolation2D* last_interp = engine->swapTarInterpolation(nullptr);
+		delete last_interp;
+		if (cur_frame.img != nullptr && cur_frame.img != ref_img)
+		{
+			delete cur_frame.img;
+		}
+		delete ref_img;
+
+		omp_set_num_threads(caller_thread_number);
+	}
+
+}//namespace opencorr
\ No newline at end of file
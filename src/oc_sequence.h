@@ -0,0 +1,141 @@
+/*
+ * This file is part of OpenCorr, an open source C++ library for
+ * study and development of 2D, 3D/stereo and volumetric
+ * digital image correlation.
+ *
+ * Copyright (C) 2021, Zhenyu Jiang <zhenyujiang@scut.edu.cn>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one from http://mozilla.org/MPL/2.0/.
+ *
+ * More information about OpenCorr can be found at https://www.opencorr.org/
+ */
+
+#pragma once
+
+#ifndef _SEQUENCE_H_
+#define _SEQUENCE_H_
+
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "oc_cubic_bspline.h"
+#include "oc_dic.h"
+#include "oc_image.h"
+#include "oc_interpolation.h"
+#include "oc_io.h"
+#include "oc_poi.h"
+
+namespace opencorr
+{
+	//queue with limited capacity connecting two stages of pipeline, push() blocks when the queue is full
+	//and pop() blocks when the queue is empty. pop() returns false once the queue is closed and drained
+	template <class T>
+	class StageQueue
+	{
+	private:
+		std::queue<T> item_queue;
+		size_t capacity;
+		bool closed;
+		std::mutex queue_mutex;
+		std::condition_variable not_full, not_empty;
+
+	public:
+		StageQueue(size_t capacity) : capacity(capacity > 0 ? capacity : 1), closed(false) {}
+
+		void push(T item)
+		{
+			std::unique_lock<std::mutex> lock(queue_mutex);
+			not_full.wait(lock, [this] { return item_queue.size() < capacity || closed; });
+			item_queue.push(item);
+			not_empty.notify_one();
+		}
+
+		bool pop(T& item)
+		{
+			std::unique_lock<std::mutex> lock(queue_mutex);
+			not_empty.wait(lock, [this] { return !item_queue.empty() || closed; });
+			if (item_queue.empty())
+			{
+				return false;
+			}
+			item = item_queue.front();
+			item_queue.pop();
+			not_full.notify_one();
+			return true;
+		}
+
+		//no more items will be pushed
+		void close()
+		{
+			std::lock_guard<std::mutex> lock(queue_mutex);
+			closed = true;
+			not_empty.notify_all();
+			not_full.notify_all();
+		}
+	};
+
+	//frame passing through the pipeline
+	struct SequenceFrame
+	{
+		int frame_idx; //index in the list of frames
+		Image2D* img;
+		Interpolation2D* interp; //interpolation of the frame, nullptr before it is prepared
+	};
+
+	//update of reference image along a sequence
+	enum class ReferenceUpdate
+	{
+		accumulative, //all the frames are matched with the first frame
+		incremental //each frame is matched with the frame before it
+	};
+
+
+	//pipeline processing a sequence of frames with three overlapped stages: loading of frame k+2,
+	//preparation of interpolation coefficients of frame k+1 and matching of frame k. the engine
+	//(e.g. ICGN2D1 or ICGN2D2) takes over the interpolation through swapTarInterpolation(), thus
+	//at most two interpolations are held at a time. engines not supporting it are prepared serially
+	class SequenceDIC
+	{
+	protected:
+		DIC* engine = nullptr; //engine for refinement, e.g. ICGN2D1 or ICGN2D2
+		DIC* seed_engine = nullptr; //optional engine to estimate the initial guess at the first target frame, e.g. FFTCC2D
+		int thread_number; //OpenMP thread number of engine
+		int prepare_thread_number; //OpenMP thread number for the preparation of interpolation
+		int queue_capacity; //number of loaded frames waiting for preparation
+		bool compact_interp; //use compact storage of interpolation coefficients
+		ReferenceUpdate ref_update;
+		std::vector<std::string> frame_path; //the first one is the initial reference image
+		std::string output_path; //prefix of the output csv files, no output if empty
+
+		//seed the POIs of next frame with the results of current frame, the failed POIs fall back to their initial guess
+		void seedNextFrame(std::vector<POI2D>& poi_queue, std::vector<POI2D>& initial_queue);
+
+	public:
+		SequenceDIC(DIC* engine, int thread_number);
+		virtual ~SequenceDIC();
+
+		void setEngine(DIC* engine);
+		void setSeedEngine(DIC* seed_engine);
+		void setFrames(std::vector<std::string>& frame_path);
+		void setReferenceUpdate(ReferenceUpdate ref_update);
+		void setQueueCapacity(int queue_capacity);
+		void setPrepareThreadNumber(int prepare_thread_number);
+		void setCompactInterpolation(bool compact_interp);
+		void setOutputPath(std::string output_path);
+
+		//called after each target frame is matched, writes the results in csv file by default
+		virtual void output(int frame_idx, std::vector<POI2D>& poi_queue);
+
+		//the initial guess of POIs is used at the first target frame, the results of the last frame are returned in poi_queue.
+		//for incremental update, the results are the deformation between two successive frames
+		void compute(std::vector<POI2D>& poi_queue);
+	};
+
+}//namespace opencorr
+
+#endif //_SEQUENCE_H_
\ No newline at end of file
@@ -0,0 +1,894 @@
+/*
+ * This file is part of OpenCorr, an open source C++ library for
+ * study and development of 2D, 3D/stereo and volumetric
+ * digital image correlation.
+ *
+ * Copyright (C) 2021, Zhenyu Jiang <zhenyujiang@scut.edu.cn>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one from http://mozilla.org/MPL/2.0/.
+ *
+ * More information about OpenCorr can be found at https://www.opencorr.org/
+ */
+
+//MSVC does not define __FMA__, while FMA is always available with /arch:AVX2
+#if defined(__AVX512F__)
+#define OC_SIMD_AVX512
+#elif defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#define OC_SIMD_AVX2
+#endif
+
+#if defined(OC_SIMD_AVX512) || defined(OC_SIMD_AVX2)
+#include <immintrin.h>
+#endif
+
+#include <climits>
+#include <Eigen>
+
+#include "oc_simd.h"
+
+namespace opencorr
+{
+#ifdef OC_SIMD_AVX2
+	inline float reduceAdd(__m256 vector)
+	{
+		__m128 sum = _mm_add_ps(_mm256_castps256_ps128(vector), _mm256_extractf128_ps(vector, 1));
+		sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+		sum = _mm_add_ss(sum, _mm_movehdup_ps(sum));
+		return _mm_cvtss_f32(sum);
+	}
+#endif
+
+	//the number of parameters is fixed at compile time, so that the accumulators stay in registers. the length of
+	//subset may also be fixed (N > 0) to let the compiler unroll the loops and resolve the tail at compile time
+	template <int P, int N = 0>
+	float fuseErrorNumerator(const float* tar, const float* ref, float scale, const float* sd_img, int sd_stride,
+		int length, float* numerator)
+	{
+		if (N > 0)
+		{
+			length = N;
+		}
+
+		float error_sum = 0.f;
+		float sum[P];
+		int k = 0;
+
+#if defined(OC_SIMD_AVX512)
+		__m512 scale_vec = _mm512_set1_ps(scale);
+		__m512 error_sum_vec = _mm512_setzero_ps();
+		__m512 sum_vec[P];
+		for (int i = 0; i < P; i++)
+		{
+			sum_vec[i] = _mm512_setzero_ps();
+		}
+
+		//the tail is handled with masked loads, the masked lanes give zero error
+		for (; k < length; k += 16)
+		{
+			__mmask16 mask = length - k >= 16 ? (__mmask16)0xFFFF : (__mmask16)((1u << (length - k)) - 1);
+			__m512 error = _mm512_fmsub_ps(_mm512_maskz_loadu_ps(mask, tar + k), scale_vec, _mm512_maskz_loadu_ps(mask, ref + k));
+			error_sum_vec = _mm512_fmadd_ps(error, error, error_sum_vec);
+			for (int i = 0; i < P; i++)
+			{
+				sum_vec[i] = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, sd_img + i * sd_stride + k), error, sum_vec[i]);
+			}
+		}
+
+		error_sum = _mm512_reduce_add_ps(error_sum_vec);
+		for (int i = 0; i < P; i++)
+		{
+			sum[i] = _mm512_reduce_add_ps(sum_vec[i]);
+		}
+#elif defined(OC_SIMD_AVX2)
+		__m256 scale_vec = _mm256_set1_ps(scale);
+		__m256 error_sum_vec = _mm256_setzero_ps();
+		__m256 sum_vec[P];
+		for (int i = 0; i < P; i++)
+		{
+			sum_vec[i] = _mm256_setzero_ps();
+		}
+
+		for (; k + 8 <= length; k += 8)
+		{
+			__m256 error = _mm256_fmsub_ps(_mm256_loadu_ps(tar + k), scale_vec, _mm256_loadu_ps(ref + k));
+			error_sum_vec = _mm256_fmadd_ps(error, error, error_sum_vec);
+			for (int i = 0; i < P; i++)
+			{
+				sum_vec[i] = _mm256_fmadd_ps(_mm256_loadu_ps(sd_img + i * sd_stride + k), error, sum_vec[i]);
+			}
+		}
+
+		error_sum = reduceAdd(error_sum_vec);
+		for (int i = 0; i < P; i++)
+		{
+			sum[i] = reduceAdd(sum_vec[i]);
+		}
+#else
+		for (int i = 0; i < P; i++)
+		{
+			sum[i] = 0.f;
+		}
+#endif
+
+		//scalar path, or the tail of AVX2 path
+		for (; k < length; k++)
+		{
+			float error = tar[k] * scale - ref[k];
+			error_sum += error * error;
+			for (int i = 0; i < P; i++)
+			{
+				sum[i] += sd_img[i * sd_stride + k] * error;
+			}
+		}
+
+		for (int i = 0; i < P; i++)
+		{
+			numerator[i] = sum[i];
+		}
+
+		return error_sum;
+	}
+
+	float fuseErrorNumerator(const float* tar, const float* ref, float scale, const float* sd_img, int sd_stride,
+		int length, int param_number, float* numerator)
+	{
+		switch (param_number)
+		{
+		case 6:
+			return fuseErrorNumerator<6>(tar, ref, scale, sd_img, sd_stride, length, numerator);
+		case 12:
+			return fuseErrorNumerator<12>(tar, ref, scale, sd_img, sd_stride, length, numerator);
+		default:
+			break;
+		}
+
+		float error_sum = 0.f;
+		for (int i = 0; i < param_number; i++)
+		{
+			numerator[i] = 0.f;
+		}
+
+		for (int k = 0; k < length; k++)
+		{
+			float error = tar[k] * scale - ref[k];
+			error_sum += error * error;
+			for (int i = 0; i < param_number; i++)
+			{
+				numerator[i] += sd_img[i * sd_stride + k] * error;
+			}
+		}
+
+		return error_sum;
+	}
+
+	//evaluate the polynomial of a pixel, coefficient[4 * k + l] is the coefficient of y^k * x^l
+	inline float evaluateBicubic(const float* coefficient, float x_decimal, float y_decimal)
+	{
+		float sum_x0 = coefficient[0] + x_decimal * (coefficient[1] + x_decimal * (coefficient[2] + x_decimal * coefficient[3]));
+		float sum_x1 = coefficient[4] + x_decimal * (coefficient[5] + x_decimal * (coefficient[6] + x_decimal * coefficient[7]));
+		float sum_x2 = coefficient[8] + x_decimal * (coefficient[9] + x_decimal * (coefficient[10] + x_decimal * coefficient[11]));
+		float sum_x3 = coefficient[12] + x_decimal * (coefficient[13] + x_decimal * (coefficient[14] + x_decimal * coefficient[15]));
+
+		return sum_x0 + y_decimal * (sum_x1 + y_decimal * (sum_x2 + y_decimal * sum_x3));
+	}
+
+	//evaluate the polynomial of a pixel and its partial derivatives, both are accumulated in Horner's scheme
+	inline void evaluateBicubicGradient(const float* coefficient, float x_decimal, float y_decimal,
+		float& value, float& gradient_x, float& gradient_y)
+	{
+		float sum_y = 0.f, derivative_y = 0.f, derivative_xy = 0.f;
+		for (int k = 3; k >= 0; k--)
+		{
+			const float* row = coefficient + 4 * k;
+			float sum_x = row[3];
+			float derivative_x = 0.f;
+			for (int l = 2; l >= 0; l--)
+			{
+				derivative_x = derivative_x * x_decimal + sum_x;
+				sum_x = sum_x * x_decimal + row[l];
+			}
+			derivative_y = derivative_y * y_decimal + sum_y;
+			sum_y = sum_y * y_decimal + sum_x;
+			derivative_xy = derivative_xy * y_decimal + derivative_x;
+		}
+
+		value = sum_y;
+		gradient_x = derivative_xy;
+		gradient_y = derivative_y;
+	}
+
+#if defined(OC_SIMD_AVX512)
+	//interpolate at 16 locations, the lanes out of the image or masked out by tail give -1
+	inline __m512 interpolateBicubic16(const float* coefficient_table, int width, int height,
+		__m512 x_location, __m512 y_location, __mmask16 tail)
+	{
+		__m512 zero = _mm512_setzero_ps();
+		__m512 width_float = _mm512_set1_ps((float)width);
+		__m512 height_float = _mm512_set1_ps((float)height);
+		__m512i width_int = _mm512_set1_epi32(width);
+
+		//NaN fails all the ordered comparisons, the locations out of image are moved to the origin
+		__mmask16 inside = tail
+			& _mm512_cmp_ps_mask(x_location, zero, _CMP_GE_OQ) & _mm512_cmp_ps_mask(y_location, zero, _CMP_GE_OQ)
+			& _mm512_cmp_ps_mask(x_location, width_float, _CMP_LT_OQ) & _mm512_cmp_ps_mask(y_location, height_float, _CMP_LT_OQ);
+		x_location = _mm512_maskz_mov_ps(inside, x_location);
+		y_location = _mm512_maskz_mov_ps(inside, y_location);
+
+		__m512i x_integral = _mm512_cvttps_epi32(x_location);
+		__m512i y_integral = _mm512_cvttps_epi32(y_location);
+		__m512 x_decimal = _mm512_sub_ps(x_location, _mm512_cvtepi32_ps(x_integral));
+		__m512 y_decimal = _mm512_sub_ps(y_location, _mm512_cvtepi32_ps(y_integral));
+		__m512i index = _mm512_slli_epi32(_mm512_add_epi32(_mm512_mullo_epi32(y_integral, width_int), x_integral), 4);
+
+		__m512 result = zero;
+		for (int k = 3; k >= 0; k--)
+		{
+			const float* coefficient = coefficient_table + k * 4;
+			__m512 sum_x = _mm512_i32gather_ps(index, coefficient + 3, 4);
+			sum_x = _mm512_fmadd_ps(sum_x, x_decimal, _mm512_i32gather_ps(index, coefficient + 2, 4));
+			sum_x = _mm512_fmadd_ps(sum_x, x_decimal, _mm512_i32gather_ps(index, coefficient + 1, 4));
+			sum_x = _mm512_fmadd_ps(sum_x, x_decimal, _mm512_i32gather_ps(index, coefficient, 4));
+			result = _mm512_fmadd_ps(result, y_decimal, sum_x);
+		}
+
+		return _mm512_mask_blend_ps(inside, _mm512_set1_ps(-1.f), result);
+	}
+#elif defined(OC_SIMD_AVX2)
+	//interpolate at 8 locations, the lanes out of the image give -1
+	inline __m256 interpolateBicubic8(const float* coefficient_table, int width, int height,
+		__m256 x_location, __m256 y_location)
+	{
+		__m256 zero = _mm256_setzero_ps();
+		__m256 width_float = _mm256_set1_ps((float)width);
+		__m256 height_float = _mm256_set1_ps((float)height);
+		__m256i width_int = _mm256_set1_epi32(width);
+
+		__m256 inside = _mm256_and_ps(
+			_mm256_and_ps(_mm256_cmp_ps(x_location, zero, _CMP_GE_OQ), _mm256_cmp_ps(y_location, zero, _CMP_GE_OQ)),
+			_mm256_and_ps(_mm256_cmp_ps(x_location, width_float, _CMP_LT_OQ), _mm256_cmp_ps(y_location, height_float, _CMP_LT_OQ)));
+		x_location = _mm256_and_ps(x_location, inside);
+		y_location = _mm256_and_ps(y_location, inside);
+
+		__m256i x_integral = _mm256_cvttps_epi32(x_location);
+		__m256i y_integral = _mm256_cvttps_epi32(y_location);
+		__m256 x_decimal = _mm256_sub_ps(x_location, _mm256_cvtepi32_ps(x_integral));
+		__m256 y_decimal = _mm256_sub_ps(y_location, _mm256_cvtepi32_ps(y_integral));
+		__m256i index = _mm256_slli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(y_integral, width_int), x_integral), 4);
+
+		__m256 result = zero;
+		for (int k = 3; k >= 0; k--)
+		{
+			const float* coefficient = coefficient_table + k * 4;
+			__m256 sum_x = _mm256_i32gather_ps(coefficient + 3, index, 4);
+			sum_x = _mm256_fmadd_ps(sum_x, x_decimal, _mm256_i32gather_ps(coefficient + 2, index, 4));
+			sum_x = _mm256_fmadd_ps(sum_x, x_decimal, _mm256_i32gather_ps(coefficient + 1, index, 4));
+			sum_x = _mm256_fmadd_ps(sum_x, x_decimal, _mm256_i32gather_ps(coefficient, index, 4));
+			result = _mm256_fmadd_ps(result, y_decimal, sum_x);
+		}
+
+		return _mm256_blendv_ps(_mm256_set1_ps(-1.f), result, inside);
+	}
+#endif
+
+	void interpolateBicubic(const float* coefficient_table, int width, int height,
+		const float* x, const float* y, float* value, int n)
+	{
+		int i = 0;
+
+#if defined(OC_SIMD_AVX512)
+		//the gathers use 32-bit indices
+		bool gather_index = (long long)width * height * 16 <= INT_MAX;
+		for (; gather_index && i < n; i += 16)
+		{
+			__mmask16 tail = n - i >= 16 ? (__mmask16)0xFFFF : (__mmask16)((1u << (n - i)) - 1);
+			__m512 x_location = _mm512_maskz_loadu_ps(tail, x + i);
+			__m512 y_location = _mm512_maskz_loadu_ps(tail, y + i);
+			_mm512_mask_storeu_ps(value + i, tail, interpolateBicubic16(coefficient_table, width, height, x_location, y_location, tail));
+		}
+#elif defined(OC_SIMD_AVX2)
+		bool gather_index = (long long)width * height * 16 <= INT_MAX;
+		for (; gather_index && i + 8 <= n; i += 8)
+		{
+			__m256 x_location = _mm256_loadu_ps(x + i);
+			__m256 y_location = _mm256_loadu_ps(y + i);
+			_mm256_storeu_ps(value + i, interpolateBicubic8(coefficient_table, width, height, x_location, y_location));
+		}
+#endif
+
+		//scalar path, or the tail of AVX2 path
+		for (; i < n; i++)
+		{
+			if (x[i] >= 0 && y[i] >= 0 && x[i] < width && y[i] < height)
+			{
+				int x_integral = (int)x[i];
+				int y_integral = (int)y[i];
+				const float* coefficient = coefficient_table + ((long long)y_integral * width + x_integral) * 16;
+				value[i] = evaluateBicubic(coefficient, x[i] - x_integral, y[i] - y_integral);
+			}
+			else
+			{
+				value[i] = -1.f;
+			}
+		}
+	}
+
+#if defined(OC_SIMD_AVX512)
+	//IC-GN iteration on a subset of which the dimension is fixed at compile time. the warped coordinates are generated
+	//in registers right before the gathers, thus the buffers of coordinates are not written and read back
+	template <int RX, int RY, int ORDER>
+	void iterateSubset2D(const float* coefficient_table, int width, int height, const float* warp,
+		float center_x, float center_y, const float* ref, float ref_mean_norm, const float* sd_img, int sd_stride,
+		float* numerator, float& squared_sum, float& tar_mean_norm)
+	{
+		const int W = 2 * RX + 1;
+		const int H = 2 * RY + 1;
+		const int N = W * H;
+		alignas(64) float tar[N];
+
+		//the warped coordinates are polynomials of local coordinates, the center of subset is added to the constant terms.
+		//order 1: x = c[0] * x_local + c[1] * y_local + c[2]
+		//order 2: x = (c[0] * x_local + c[1] * y_local + c[3]) * x_local + (c[2] * y_local + c[4]) * y_local + c[5]
+		const int C = ORDER == 1 ? 3 : 6;
+		float x_coefficient[C], y_coefficient[C];
+		for (int i = 0; i < C; i++)
+		{
+			x_coefficient[i] = warp[i];
+			y_coefficient[i] = warp[i + C];
+		}
+		x_coefficient[C - 1] += center_x;
+		y_coefficient[C - 1] += center_y;
+
+		__m512 x_local = _mm512_sub_ps(_mm512_setr_ps(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15), _mm512_set1_ps((float)RX));
+		__m512 y_local = _mm512_set1_ps((float)-RY);
+		__m512 step = _mm512_set1_ps(16.f);
+		__m512 x_last = _mm512_set1_ps((float)RX);
+		__m512 subset_width = _mm512_set1_ps((float)W);
+		__m512 one = _mm512_set1_ps(1.f);
+		__m512 x_vector[C], y_vector[C];
+		for (int i = 0; i < C; i++)
+		{
+			x_vector[i] = _mm512_set1_ps(x_coefficient[i]);
+			y_vector[i] = _mm512_set1_ps(y_coefficient[i]);
+		}
+
+		//the lanes walk through the subset in row-major order, a lane wraps to the next row at most once in each step
+		//as the subset is wider than 16 pixels
+		for (int k = 0; k < N; k += 16)
+		{
+			__m512 x_location, y_location;
+			if (ORDER == 1)
+			{
+				x_location = _mm512_fmadd_ps(x_vector[0], x_local, _mm512_fmadd_ps(x_vector[1], y_local, x_vector[2]));
+				y_location = _mm512_fmadd_ps(y_vector[0], x_local, _mm512_fmadd_ps(y_vector[1], y_local, y_vector[2]));
+			}
+			else
+			{
+				x_location = _mm512_fmadd_ps(_mm512_fmadd_ps(x_vector[0], x_local, _mm512_fmadd_ps(x_vector[1], y_local, x_vector[3])),
+					x_local, _mm512_fmadd_ps(_mm512_fmadd_ps(x_vector[2], y_local, x_vector[4]), y_local, x_vector[5]));
+				y_location = _mm512_fmadd_ps(_mm512_fmadd_ps(y_vector[0], x_local, _mm512_fmadd_ps(y_vector[1], y_local, y_vector[3])),
+					x_local, _mm512_fmadd_ps(_mm512_fmadd_ps(y_vector[2], y_local, y_vector[4]), y_local, y_vector[5]));
+			}
+
+			__mmask16 tail = N - k >= 16 ? (__mmask16)0xFFFF : (__mmask16)((1u << (N - k)) - 1);
+			_mm512_mask_storeu_ps(tar + k, tail, interpolateBicubic16(coefficient_table, width, height, x_location, y_location, tail));
+
+			x_local = _mm512_add_ps(x_local, step);
+			__mmask16 wrap = _mm512_cmp_ps_mask(x_local, x_last, _CMP_GT_OQ);
+			x_local = _mm512_mask_sub_ps(x_local, wrap, x_local, subset_width);
+			y_local = _mm512_mask_add_ps(y_local, wrap, y_local, one);
+		}
+
+		//zero-mean normalization of the target subset, the fixed-size vector is reduced without loop overhead
+		Eigen::Map<Eigen::Matrix<float, N, 1>, Eigen::Aligned> tar_vector(tar);
+		tar_vector.array() -= tar_vector.mean();
+		tar_mean_norm = tar_vector.norm();
+
+		squared_sum = fuseErrorNumerator<ORDER == 1 ? 6 : 12, N>(tar, ref, ref_mean_norm / tar_mean_norm,
+			sd_img, sd_stride, N, numerator);
+	}
+
+	template <int ORDER>
+	bool iterateSubset2D(const float* coefficient_table, int width, int height, const float* warp,
+		float center_x, float center_y, int radius, const float* ref, float ref_mean_norm, const float* sd_img,
+		int sd_stride, float* numerator, float& squared_sum, float& tar_mean_norm)
+	{
+		switch (radius)
+		{
+		case 15:
+			iterateSubset2D<15, 15, ORDER>(coefficient_table, width, height, warp, center_x, center_y,
+				ref, ref_mean_norm, sd_img, sd_stride, numerator, squared_sum, tar_mean_norm);
+			return true;
+		case 16:
+			iterateSubset2D<16, 16, ORDER>(coefficient_table, width, height, warp, center_x, center_y,
+				ref, ref_mean_norm, sd_img, sd_stride, numerator, squared_sum, tar_mean_norm);
+			return true;
+		case 20:
+			iterateSubset2D<20, 20, ORDER>(coefficient_table, width, height, warp, center_x, center_y,
+				ref, ref_mean_norm, sd_img, sd_stride, numerator, squared_sum, tar_mean_norm);
+			return true;
+		case 30:
+			iterateSubset2D<30, 30, ORDER>(coefficient_table, width, height, warp, center_x, center_y,
+				ref, ref_mean_norm, sd_img, sd_stride, numerator, squared_sum, tar_mean_norm);
+			return true;
+		default:
+			return false;
+		}
+	}
+#endif
+
+#if defined(OC_SIMD_AVX512)
+	bool iterateSubset2D(const float* coefficient_table, int width, int height, int order, const float* warp,
+		float center_x, float center_y, int radius_x, int radius_y, const float* ref, float ref_mean_norm,
+		const float* sd_img, int sd_stride, float* numerator, float& squared_sum, float& tar_mean_norm)
+	{
+		//the gathers use 32-bit indices
+		if (radius_x != radius_y || (long long)width * height * 16 > INT_MAX)
+		{
+			return false;
+		}
+
+		switch (order)
+		{
+		case 1:
+			return iterateSubset2D<1>(coefficient_table, width, height, warp, center_x, center_y, radius_x,
+				ref, ref_mean_norm, sd_img, sd_stride, numerator, squared_sum, tar_mean_norm);
+		case 2:
+			return iterateSubset2D<2>(coefficient_table, width, height, warp, center_x, center_y, radius_x,
+				ref, ref_mean_norm, sd_img, sd_stride, numerator, squared_sum, tar_mean_norm);
+		default:
+			return false;
+		}
+	}
+#else
+	//with 8 lanes or less the gathers dominate, and fusing the steps brings nothing over the generic path
+	bool iterateSubset2D(const float*, int, int, int, const float*, float, float, int, int, const float*, float,
+		const float*, int, float*, float&, float&)
+	{
+		return false;
+	}
+#endif
+
+	void interpolateBicubicGradient(const float* coefficient_table, int width, int height,
+		const float* x, const float* y, float* value, float* gradient_x, float* gradient_y, int n)
+	{
+		int i = 0;
+
+#if defined(OC_SIMD_AVX512) || defined(OC_SIMD_AVX2)
+		//the gathers use 32-bit indices
+		bool gather_index = (long long)width * height * 16 <= INT_MAX;
+#endif
+
+#if defined(OC_SIMD_AVX512)
+		__m512 zero = _mm512_setzero_ps();
+		__m512 outside_value = _mm512_set1_ps(-1.f);
+		__m512 width_float = _mm512_set1_ps((float)width);
+		__m512 height_float = _mm512_set1_ps((float)height);
+		__m512i width_int = _mm512_set1_epi32(width);
+
+		for (; gather_index && i < n; i += 16)
+		{
+			__mmask16 tail = n - i >= 16 ? (__mmask16)0xFFFF : (__mmask16)((1u << (n - i)) - 1);
+			__m512 x_location = _mm512_maskz_loadu_ps(tail, x + i);
+			__m512 y_location = _mm512_maskz_loadu_ps(tail, y + i);
+
+			__mmask16 inside = tail
+				& _mm512_cmp_ps_mask(x_location, zero, _CMP_GE_OQ) & _mm512_cmp_ps_mask(y_location, zero, _CMP_GE_OQ)
+				& _mm512_cmp_ps_mask(x_location, width_float, _CMP_LT_OQ) & _mm512_cmp_ps_mask(y_location, height_float, _CMP_LT_OQ);
+			x_location = _mm512_maskz_mov_ps(inside, x_location);
+			y_location = _mm512_maskz_mov_ps(inside, y_location);
+
+			__m512i x_integral = _mm512_cvttps_epi32(x_location);
+			__m512i y_integral = _mm512_cvttps_epi32(y_location);
+			__m512 x_decimal = _mm512_sub_ps(x_location, _mm512_cvtepi32_ps(x_integral));
+			__m512 y_decimal = _mm512_sub_ps(y_location, _mm512_cvtepi32_ps(y_integral));
+			__m512i index = _mm512_slli_epi32(_mm512_add_epi32(_mm512_mullo_epi32(y_integral, width_int), x_integral), 4);
+
+			//the derivative of a polynomial is accumulated with the partial sums of Horner's scheme
+			__m512 sum_y = zero, derivative_y = zero, derivative_xy = zero;
+			for (int k = 3; k >= 0; k--)
+			{
+				const float* coefficient = coefficient_table + k * 4;
+				__m512 sum_x = _mm512_i32gather_ps(index, coefficient + 3, 4);
+				__m512 derivative_x = sum_x;
+				sum_x = _mm512_fmadd_ps(sum_x, x_decimal, _mm512_i32gather_ps(index, coefficient + 2, 4));
+				derivative_x = _mm512_fmadd_ps(derivative_x, x_decimal, sum_x);
+				sum_x = _mm512_fmadd_ps(sum_x, x_decimal, _mm512_i32gather_ps(index, coefficient + 1, 4));
+				derivative_x = _mm512_fmadd_ps(derivative_x, x_decimal, sum_x);
+				sum_x = _mm512_fmadd_ps(sum_x, x_decimal, _mm512_i32gather_ps(index, coefficient, 4));
+
+				derivative_y = _mm512_fmadd_ps(derivative_y, y_decimal, sum_y);
+				sum_y = _mm512_fmadd_ps(sum_y, y_decimal, sum_x);
+				derivative_xy = _mm512_fmadd_ps(derivative_xy, y_decimal, derivative_x);
+			}
+
+			_mm512_mask_storeu_ps(value + i, tail, _mm512_mask_blend_ps(inside, outside_value, sum_y));
+			_mm512_mask_storeu_ps(gradient_x + i, tail, _mm512_maskz_mov_ps(inside, derivative_xy));
+			_mm512_mask_storeu_ps(gradient_y + i, tail, _mm512_maskz_mov_ps(inside, derivative_y));
+		}
+#elif defined(OC_SIMD_AVX2)
+		__m256 zero = _mm256_setzero_ps();
+		__m256 outside_value = _mm256_set1_ps(-1.f);
+		__m256 width_float = _mm256_set1_ps((float)width);
+		__m256 height_float = _mm256_set1_ps((float)height);
+		__m256i width_int = _mm256_set1_epi32(width);
+
+		for (; gather_index && i + 8 <= n; i += 8)
+		{
+			__m256 x_location = _mm256_loadu_ps(x + i);
+			__m256 y_location = _mm256_loadu_ps(y + i);
+
+			__m256 inside = _mm256_and_ps(
+				_mm256_and_ps(_mm256_cmp_ps(x_location, zero, _CMP_GE_OQ), _mm256_cmp_ps(y_location, zero, _CMP_GE_OQ)),
+				_mm256_and_ps(_mm256_cmp_ps(x_location, width_float, _CMP_LT_OQ), _mm256_cmp_ps(y_location, height_float, _CMP_LT_OQ)));
+			x_location = _mm256_and_ps(x_location, inside);
+			y_location = _mm256_and_ps(y_location, inside);
+
+			__m256i x_integral = _mm256_cvttps_epi32(x_location);
+			__m256i y_integral = _mm256_cvttps_epi32(y_location);
+			__m256 x_decimal = _mm256_sub_ps(x_location, _mm256_cvtepi32_ps(x_integral));
+			__m256 y_decimal = _mm256_sub_ps(y_location, _mm256_cvtepi32_ps(y_integral));
+			__m256i index = _mm256_slli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(y_integral, width_int), x_integral), 4);
+
+			__m256 sum_y = zero, derivative_y = zero, derivative_xy = zero;
+			for (int k = 3; k >= 0; k--)
+			{
+				const float* coefficient = coefficient_table + k * 4;
+				__m256 sum_x = _mm256_i32gather_ps(coefficient + 3, index, 4);
+				__m256 derivative_x = sum_x;
+				sum_x = _mm256_fmadd_ps(sum_x, x_decimal, _mm256_i32gather_ps(coefficient + 2, index, 4));
+				derivative_x = _mm256_fmadd_ps(derivative_x, x_decimal, sum_x);
+				sum_x = _mm256_fmadd_ps(sum_x, x_decimal, _mm256_i32gather_ps(coefficient + 1, index, 4));
+				derivative_x = _mm256_fmadd_ps(derivative_x, x_decimal, sum_x);
+				sum_x = _mm256_fmadd_ps(sum_x, x_decimal, _mm256_i32gather_ps(coefficient, index, 4));
+
+				derivative_y = _mm256_fmadd_ps(derivative_y, y_decimal, sum_y);
+				sum_y = _mm256_fmadd_ps(sum_y, y_decimal, sum_x);
+				derivative_xy = _mm256_fmadd_ps(derivative_xy, y_decimal, derivative_x);
+			}
+
+			_mm256_storeu_ps(value + i, _mm256_blendv_ps(outside_value, sum_y, inside));
+			_mm256_storeu_ps(gradient_x + i, _mm256_and_ps(derivative_xy, inside));
+			_mm256_storeu_ps(gradient_y + i, _mm256_and_ps(derivative_y, inside));
+		}
+#endif
+
+		//scalar path, or the tail of AVX2 path
+		for (; i < n; i++)
+		{
+			if (x[i] >= 0 && y[i] >= 0 && x[i] < width && y[i] < height)
+			{
+				int x_integral = (int)x[i];
+				int y_integral = (int)y[i];
+				const float* coefficient = coefficient_table + ((long long)y_integral * width + x_integral) * 16;
+				evaluateBicubicGradient(coefficient, x[i] - x_integral, y[i] - y_integral, value[i], gradient_x[i], gradient_y[i]);
+			}
+			else
+			{
+				value[i] = -1.f;
+				gradient_x[i] = 0.f;
+				gradient_y[i] = 0.f;
+			}
+		}
+	}
+
+	void filterBicubicRow(const float* filter, const float* row, int width, float* result)
+	{
+		int c = 1;
+
+#if defined(OC_SIMD_AVX512) || defined(OC_SIMD_AVX2)
+		//256-bit vectors suffice for this pass, the four results of 8 pixels are interleaved by a 4x8 transpose
+		__m256 weight[4][4];
+		for (int j = 0; j < 4; j++)
+		{
+			for (int a = 0; a < 4; a++)
+			{
+				weight[j][a] = _mm256_set1_ps(filter[4 * j + a]);
+			}
+		}
+
+		for (; c + 8 <= width - 2; c += 8)
+		{
+			__m256 pixel[4];
+			for (int a = 0; a < 4; a++)
+			{
+				pixel[a] = _mm256_loadu_ps(row + c - 1 + a);
+			}
+
+			__m256 sum[4];
+			for (int j = 0; j < 4; j++)
+			{
+				sum[j] = _mm256_mul_ps(weight[j][0], pixel[0]);
+				sum[j] = _mm256_fmadd_ps(weight[j][1], pixel[1], sum[j]);
+				sum[j] = _mm256_fmadd_ps(weight[j][2], pixel[2], sum[j]);
+				sum[j] = _mm256_fmadd_ps(weight[j][3], pixel[3], sum[j]);
+			}
+
+			__m256 low01 = _mm256_unpacklo_ps(sum[0], sum[1]);
+			__m256 high01 = _mm256_unpackhi_ps(sum[0], sum[1]);
+			__m256 low23 = _mm256_unpacklo_ps(sum[2], sum[3]);
+			__m256 high23 = _mm256_unpackhi_ps(sum[2], sum[3]);
+			__m256 pixel04 = _mm256_shuffle_ps(low01, low23, _MM_SHUFFLE(1, 0, 1, 0));
+			__m256 pixel15 = _mm256_shuffle_ps(low01, low23, _MM_SHUFFLE(3, 2, 3, 2));
+			__m256 pixel26 = _mm256_shuffle_ps(high01, high23, _MM_SHUFFLE(1, 0, 1, 0));
+			__m256 pixel37 = _mm256_shuffle_ps(high01, high23, _MM_SHUFFLE(3, 2, 3, 2));
+
+			float* result_c = result + 4 * c;
+			_mm256_storeu_ps(result_c, _mm256_permute2f128_ps(pixel04, pixel15, 0x20));
+			_mm256_storeu_ps(result_c + 8, _mm256_permute2f128_ps(pixel26, pixel37, 0x20));
+			_mm256_storeu_ps(result_c + 16, _mm256_permute2f128_ps(pixel04, pixel15, 0x31));
+			_mm256_storeu_ps(result_c + 24, _mm256_permute2f128_ps(pixel26, pixel37, 0x31));
+		}
+#endif
+
+		//scalar path, or the tail of vectorized path
+		for (; c < width - 2; c++)
+		{
+			for (int j = 0; j < 4; j++)
+			{
+				result[4 * c + j] = filter[4 * j] * row[c - 1] + filter[4 * j + 1] * row[c]
+					+ filter[4 * j + 2] * row[c + 1] + filter[4 * j + 3] * row[c + 2];
+			}
+		}
+	}
+
+	void combineBicubicRows(const float* filter, const float* const* filtered_row, int width, float* coefficient_row)
+	{
+		int c = 1;
+
+		//the four filtered values of a pixel are broadcast, so that its 16 coefficients are stored continuously
+#if defined(OC_SIMD_AVX512)
+		__m512 weight[4];
+		for (int b = 0; b < 4; b++)
+		{
+			weight[b] = _mm512_setr_ps(
+				filter[b], filter[b], filter[b], filter[b], filter[4 + b], filter[4 + b], filter[4 + b], filter[4 + b],
+				filter[8 + b], filter[8 + b], filter[8 + b], filter[8 + b], filter[12 + b], filter[12 + b], filter[12 + b], filter[12 + b]);
+		}
+
+		for (; c < width - 2; c++)
+		{
+			__m512 sum = _mm512_mul_ps(weight[0], _mm512_broadcast_f32x4(_mm_loadu_ps(filtered_row[0] + 4 * c)));
+			sum = _mm512_fmadd_ps(weight[1], _mm512_broadcast_f32x4(_mm_loadu_ps(filtered_row[1] + 4 * c)), sum);
+			sum = _mm512_fmadd_ps(weight[2], _mm512_broadcast_f32x4(_mm_loadu_ps(filtered_row[2] + 4 * c)), sum);
+			sum = _mm512_fmadd_ps(weight[3], _mm512_broadcast_f32x4(_mm_loadu_ps(filtered_row[3] + 4 * c)), sum);
+			_mm512_storeu_ps(coefficient_row + 16 * c, sum);
+		}
+#elif defined(OC_SIMD_AVX2)
+		__m256 weight_low[4], weight_high[4]; //rows 0 and 1, rows 2 and 3 of the filter
+		for (int b = 0; b < 4; b++)
+		{
+			weight_low[b] = _mm256_setr_ps(filter[b], filter[b], filter[b], filter[b], filter[4 + b], filter[4 + b], filter[4 + b], filter[4 + b]);
+			weight_high[b] = _mm256_setr_ps(filter[8 + b], filter[8 + b], filter[8 + b], filter[8 + b], filter[12 + b], filter[12 + b], filter[12 + b], filter[12 + b]);
+		}
+
+		for (; c < width - 2; c++)
+		{
+			__m256 filtered = _mm256_broadcast_ps((const __m128*)(filtered_row[0] + 4 * c));
+			__m256 sum_low = _mm256_mul_ps(weight_low[0], filtered);
+			__m256 sum_high = _mm256_mul_ps(weight_high[0], filtered);
+			for (int b = 1; b < 4; b++)
+			{
+				filtered = _mm256_broadcast_ps((const __m128*)(filtered_row[b] + 4 * c));
+				sum_low = _mm256_fmadd_ps(weight_low[b], filtered, sum_low);
+				sum_high = _mm256_fmadd_ps(weight_high[b], filtered, sum_high);
+			}
+			_mm256_storeu_ps(coefficient_row + 16 * c, sum_low);
+			_mm256_storeu_ps(coefficient_row + 16 * c + 8, sum_high);
+		}
+#endif
+
+		//scalar path
+		for (; c < width - 2; c++)
+		{
+			for (int i = 0; i < 4; i++)
+			{
+				for (int j = 0; j < 4; j++)
+				{
+					coefficient_row[16 * c + 4 * i + j] = filter[4 * i] * filtered_row[0][4 * c + j]
+						+ filter[4 * i + 1] * filtered_row[1][4 * c + j]
+						+ filter[4 * i + 2] * filtered_row[2][4 * c + j]
+						+ filter[4 * i + 3] * filtered_row[3][4 * c + j];
+				}
+			}
+		}
+	}
+
+	//cubic B-spline basis functions, see basis0() to basis3() in oc_cubic_bspline.h
+	inline void getBasis(float decimal, float* basis)
+	{
+		basis[0] = (1.f / 6.f) * (decimal * (decimal * (-decimal + 3.f) - 3.f) + 1.f);
+		basis[1] = (1.f / 6.f) * (decimal * decimal * (3.f * decimal - 6.f) + 4.f);
+		basis[2] = (1.f / 6.f) * (decimal * (decimal * (-3.f * decimal + 3.f) + 3.f) + 1.f);
+		basis[3] = (1.f / 6.f) * (decimal * decimal * decimal);
+	}
+
+#if defined(OC_SIMD_AVX512)
+	inline void getBasis(__m512 decimal, __m512* basis)
+	{
+		__m512 one = _mm512_set1_ps(1.f);
+		__m512 three = _mm512_set1_ps(3.f);
+		__m512 sixth = _mm512_set1_ps(1.f / 6.f);
+
+		basis[0] = _mm512_mul_ps(sixth, _mm512_fmadd_ps(decimal, _mm512_fmsub_ps(decimal, _mm512_sub_ps(three, decimal), three), one));
+		basis[1] = _mm512_mul_ps(sixth, _mm512_fmadd_ps(_mm512_mul_ps(decimal, decimal), _mm512_fmsub_ps(three, decimal, _mm512_set1_ps(6.f)), _mm512_set1_ps(4.f)));
+		basis[2] = _mm512_mul_ps(sixth, _mm512_fmadd_ps(decimal, _mm512_fmadd_ps(decimal, _mm512_fnmadd_ps(three, decimal, three), three), one));
+		basis[3] = _mm512_mul_ps(sixth, _mm512_mul_ps(_mm512_mul_ps(decimal, decimal), decimal));
+	}
+#elif defined(OC_SIMD_AVX2)
+	inline void getBasis(__m256 decimal, __m256* basis)
+	{
+		__m256 one = _mm256_set1_ps(1.f);
+		__m256 three = _mm256_set1_ps(3.f);
+		__m256 sixth = _mm256_set1_ps(1.f / 6.f);
+
+		basis[0] = _mm256_mul_ps(sixth, _mm256_fmadd_ps(decimal, _mm256_fmsub_ps(decimal, _mm256_sub_ps(three, decimal), three), one));
+		basis[1] = _mm256_mul_ps(sixth, _mm256_fmadd_ps(_mm256_mul_ps(decimal, decimal), _mm256_fmsub_ps(three, decimal, _mm256_set1_ps(6.f)), _mm256_set1_ps(4.f)));
+		basis[2] = _mm256_mul_ps(sixth, _mm256_fmadd_ps(decimal, _mm256_fmadd_ps(decimal, _mm256_fnmadd_ps(three, decimal, three), three), one));
+		basis[3] = _mm256_mul_ps(sixth, _mm256_mul_ps(_mm256_mul_ps(decimal, decimal), decimal));
+	}
+#endif
+
+	void interpolateTricubic(const float* coefficient, int dim_x, int dim_y, int dim_z,
+		const float* x, const float* y, const float* z, float* value, int n)
+	{
+		int i = 0;
+		long long stride_y = dim_x;
+		long long stride_z = (long long)dim_x * dim_y;
+
+#if defined(OC_SIMD_AVX512)
+		//the gathers use 32-bit indices
+		bool gather_index = stride_z * dim_z <= INT_MAX;
+		__m512 one = _mm512_set1_ps(1.f);
+		__m512 outside_value = _mm512_set1_ps(-1.f);
+		__m512 x_upper = _mm512_set1_ps((float)(dim_x - 2));
+		__m512 y_upper = _mm512_set1_ps((float)(dim_y - 2));
+		__m512 z_upper = _mm512_set1_ps((float)(dim_z - 2));
+		__m512i stride_y_int = _mm512_set1_epi32((int)stride_y);
+		__m512i stride_z_int = _mm512_set1_epi32((int)stride_z);
+
+		for (; gather_index && i < n; i += 16)
+		{
+			__mmask16 tail = n - i >= 16 ? (__mmask16)0xFFFF : (__mmask16)((1u << (n - i)) - 1);
+			__m512 x_location = _mm512_mask_loadu_ps(one, tail, x + i);
+			__m512 y_location = _mm512_mask_loadu_ps(one, tail, y + i);
+			__m512 z_location = _mm512_mask_loadu_ps(one, tail, z + i);
+
+			__mmask16 inside = tail
+				& _mm512_cmp_ps_mask(x_location, one, _CMP_GE_OQ) & _mm512_cmp_ps_mask(x_location, x_upper, _CMP_LT_OQ)
+				& _mm512_cmp_ps_mask(y_location, one, _CMP_GE_OQ) & _mm512_cmp_ps_mask(y_location, y_upper, _CMP_LT_OQ)
+				& _mm512_cmp_ps_mask(z_location, one, _CMP_GE_OQ) & _mm512_cmp_ps_mask(z_location, z_upper, _CMP_LT_OQ);
+			x_location = _mm512_mask_blend_ps(inside, one, x_location);
+			y_location = _mm512_mask_blend_ps(inside, one, y_location);
+			z_location = _mm512_mask_blend_ps(inside, one, z_location);
+
+			__m512i x_integral = _mm512_cvttps_epi32(x_location);
+			__m512i y_integral = _mm512_cvttps_epi32(y_location);
+			__m512i z_integral = _mm512_cvttps_epi32(z_location);
+
+			__m512 basis_x[4], basis_y[4], basis_z[4];
+			getBasis(_mm512_sub_ps(x_location, _mm512_cvtepi32_ps(x_integral)), basis_x);
+			getBasis(_mm512_sub_ps(y_location, _mm512_cvtepi32_ps(y_integral)), basis_y);
+			getBasis(_mm512_sub_ps(z_location, _mm512_cvtepi32_ps(z_integral)), basis_z);
+
+			//index of the corner of 4x4x4 neighborhood
+			__m512i minus_one = _mm512_set1_epi32(-1);
+			__m512i index = _mm512_add_epi32(_mm512_add_epi32(
+				_mm512_mullo_epi32(_mm512_add_epi32(z_integral, minus_one), stride_z_int),
+				_mm512_mullo_epi32(_mm512_add_epi32(y_integral, minus_one), stride_y_int)),
+				_mm512_add_epi32(x_integral, minus_one));
+
+			__m512 result = _mm512_setzero_ps();
+			for (int l = 0; l < 4; l++)
+			{
+				__m512 sum_y = _mm512_setzero_ps();
+				for (int m = 0; m < 4; m++)
+				{
+					const float* row = coefficient + l * stride_z + m * stride_y;
+					__m512 sum_x = _mm512_mul_ps(basis_x[0], _mm512_i32gather_ps(index, row, 4));
+					sum_x = _mm512_fmadd_ps(basis_x[1], _mm512_i32gather_ps(index, row + 1, 4), sum_x);
+					sum_x = _mm512_fmadd_ps(basis_x[2], _mm512_i32gather_ps(index, row + 2, 4), sum_x);
+					sum_x = _mm512_fmadd_ps(basis_x[3], _mm512_i32gather_ps(index, row + 3, 4), sum_x);
+					sum_y = _mm512_fmadd_ps(basis_y[m], sum_x, sum_y);
+				}
+				result = _mm512_fmadd_ps(basis_z[l], sum_y, result);
+			}
+
+			_mm512_mask_storeu_ps(value + i, tail, _mm512_mask_blend_ps(inside, outside_value, result));
+		}
+#elif defined(OC_SIMD_AVX2)
+		bool gather_index = stride_z * dim_z <= INT_MAX;
+		__m256 one = _mm256_set1_ps(1.f);
+		__m256 outside_value = _mm256_set1_ps(-1.f);
+		__m256 x_upper = _mm256_set1_ps((float)(dim_x - 2));
+		__m256 y_upper = _mm256_set1_ps((float)(dim_y - 2));
+		__m256 z_upper = _mm256_set1_ps((float)(dim_z - 2));
+		__m256i stride_y_int = _mm256_set1_epi32((int)stride_y);
+		__m256i stride_z_int = _mm256_set1_epi32((int)stride_z);
+
+		for (; gather_index && i + 8 <= n; i += 8)
+		{
+			__m256 x_location = _mm256_loadu_ps(x + i);
+			__m256 y_location = _mm256_loadu_ps(y + i);
+			__m256 z_location = _mm256_loadu_ps(z + i);
+
+			__m256 inside = _mm256_and_ps(_mm256_and_ps(
+				_mm256_and_ps(_mm256_cmp_ps(x_location, one, _CMP_GE_OQ), _mm256_cmp_ps(x_location, x_upper, _CMP_LT_OQ)),
+				_mm256_and_ps(_mm256_cmp_ps(y_location, one, _CMP_GE_OQ), _mm256_cmp_ps(y_location, y_upper, _CMP_LT_OQ))),
+				_mm256_and_ps(_mm256_cmp_ps(z_location, one, _CMP_GE_OQ), _mm256_cmp_ps(z_location, z_upper, _CMP_LT_OQ)));
+			x_location = _mm256_blendv_ps(one, x_location, inside);
+			y_location = _mm256_blendv_ps(one, y_location, inside);
+			z_location = _mm256_blendv_ps(one, z_location, inside);
+
+			__m256i x_integral = _mm256_cvttps_epi32(x_location);
+			__m256i y_integral = _mm256_cvttps_epi32(y_location);
+			__m256i z_integral = _mm256_cvttps_epi32(z_location);
+
+			__m256 basis_x[4], basis_y[4], basis_z[4];
+			getBasis(_mm256_sub_ps(x_location, _mm256_cvtepi32_ps(x_integral)), basis_x);
+			getBasis(_mm256_sub_ps(y_location, _mm256_cvtepi32_ps(y_integral)), basis_y);
+			getBasis(_mm256_sub_ps(z_location, _mm256_cvtepi32_ps(z_integral)), basis_z);
+
+			__m256i minus_one = _mm256_set1_epi32(-1);
+			__m256i index = _mm256_add_epi32(_mm256_add_epi32(
+				_mm256_mullo_epi32(_mm256_add_epi32(z_integral, minus_one), stride_z_int),
+				_mm256_mullo_epi32(_mm256_add_epi32(y_integral, minus_one), stride_y_int)),
+				_mm256_add_epi32(x_integral, minus_one));
+
+			__m256 result = _mm256_setzero_ps();
+			for (int l = 0; l < 4; l++)
+			{
+				__m256 sum_y = _mm256_setzero_ps();
+				for (int m = 0; m < 4; m++)
+				{
+					const float* row = coefficient + l * stride_z + m * stride_y;
+					__m256 sum_x = _mm256_mul_ps(basis_x[0], _mm256_i32gather_ps(row, index, 4));
+					sum_x = _mm256_fmadd_ps(basis_x[1], _mm256_i32gather_ps(row + 1, index, 4), sum_x);
+					sum_x = _mm256_fmadd_ps(basis_x[2], _mm256_i32gather_ps(row + 2, index, 4), sum_x);
+					sum_x = _mm256_fmadd_ps(basis_x[3], _mm256_i32gather_ps(row + 3, index, 4), sum_x);
+					sum_y = _mm256_fmadd_ps(basis_y[m], sum_x, sum_y);
+				}
+				result = _mm256_fmadd_ps(basis_z[l], sum_y, result);
+			}
+
+			_mm256_storeu_ps(value + i, _mm256_blendv_ps(outside_value, result, inside));
+		}
+#endif
+
+		for (; i < n; i++)
+		{
+			if (x[i] >= 1 && y[i] >= 1 && z[i] >= 1 && x[i] < (dim_x - 2) && y[i] < (dim_y - 2) && z[i] < (dim_z - 2))
+			{
+				int x_integral = (int)x[i];
+				int y_integral = (int)y[i];
+				int z_integral = (int)z[i];
+
+				float basis_x[4], basis_y[4], basis_z[4];
+				getBasis(x[i] - x_integral, basis_x);
+				getBasis(y[i] - y_integral, basis_y);
+				getBasis(z[i] - z_integral, basis_z);
+
+				const float* corner = coefficient + (z_integral - 1) * stride_z + (y_integral - 1) * stride_y + (x_integral - 1);
+				float result = 0.f;
+				for (int l = 0; l < 4; l++)
+				{
+					float sum_y = 0.f;
+					for (int m = 0; m < 4; m++)
+					{
+						const float* row = corner + l * stride_z + m * stride_y;
+						float sum_x = basis_x[0] * row[0] + basis_x[1] * row[1] + basis_x[2] * row[2] + basis_x[3] * row[3];
+						sum_y += basis_y[m] * sum_x;
+					}
+					result += basis_z[l] * sum_y;
+				}
+				value[i] = result;
+			}
+			else
+			{
+				value[i] = -1.f;
+			}
+		}
+	}
+
+}//namespace opencorr
@@ -0,0 +1,67 @@
+/*
+ * This file is part of OpenCorr, an open source C++ library for
+ * study and development of 2D, 3D/stereo and volumetric
+ * digital image correlation.
+ *
+ * Copyright (C) 2021, Zhenyu Jiang <zhenyujiang@scut.edu.cn>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one from http://mozilla.org/MPL/2.0/.
+ *
+ * More information about OpenCorr can be found at https://www.opencorr.org/
+ */
+
+#pragma once
+
+#ifndef _SIMD_H_
+#define _SIMD_H_
+
+namespace opencorr
+{
+	//inner kernels of iterative subpixel registration, the AVX-512 or AVX2 (with FMA) path is selected
+	//at compile time according to the instruction set enabled, otherwise the scalar path is used
+
+	//calculate error = tar * scale - ref in one pass over a subset, return the sum of squared error and
+	//accumulate numerator[i] = sum(sd_img[i * sd_stride + k] * error[k]), i.e. a parameter-major steepest descent image
+	float fuseErrorNumerator(const float* tar, const float* ref, float scale, const float* sd_img, int sd_stride,
+		int length, int param_number, float* numerator);
+
+	//bicubic B-spline interpolation at n locations (x[i], y[i]) using a look-up table of 4x4 polynomial coefficients
+	//stored continuously for each pixel in row-major order, value[i] is set as -1 if the location is out of the image
+	void interpolateBicubic(const float* coefficient_table, int width, int height,
+		const float* x, const float* y, float* value, int n);
+
+	//bicubic B-spline interpolation with the analytic derivatives of the same polynomials, the intensity and its
+	//gradients along x and y at n locations are obtained in one pass over the look-up table of interpolateBicubic().
+	//value[i] is set as -1 and the gradients as 0 if the location is out of the image
+	void interpolateBicubicGradient(const float* coefficient_table, int width, int height,
+		const float* x, const float* y, float* value, float* gradient_x, float* gradient_y, int n);
+
+	//one iteration of IC-GN on a square subset of radius 15, 16, 20 or 30, which is the common choice in practice. the
+	//warped coordinates are generated with the 1st order (order = 1, warp holds rows 0 and 1 of the 3x3 warp matrix)
+	//or the 2nd order shape function (order = 2, warp holds rows 3 and 4 of the 6x6 warp matrix) and shifted to
+	//(center_x, center_y), the target subset is interpolated with the look-up table of interpolateBicubic() and
+	//zero-mean normalized, then the error and numerator are accumulated in the same way as fuseErrorNumerator().
+	//the subset dimension is a compile-time constant in each kernel. the kernels are built with AVX-512 only, false is
+	//returned if no kernel matches the input, and the caller shall fall back to the generic path
+	bool iterateSubset2D(const float* coefficient_table, int width, int height, int order, const float* warp,
+		float center_x, float center_y, int radius_x, int radius_y, const float* ref, float ref_mean_norm,
+		const float* sd_img, int sd_stride, float* numerator, float& squared_sum, float& tar_mean_norm);
+
+	//first pass of generating the look-up table of bicubic B-spline, filter a row of image along x-axis with the
+	//4x4 matrix of separable filter, result[4 * c + j] = sum(filter[4 * j + a] * row[c - 1 + a]) for c in [1, width - 3]
+	void filterBicubicRow(const float* filter, const float* row, int width, float* result);
+
+	//second pass of generating the look-up table, combine four rows filtered by filterBicubicRow() along y-axis,
+	//coefficient_row[16 * c + 4 * i + j] = sum(filter[4 * i + b] * filtered_row[b][4 * c + j]) for c in [1, width - 3]
+	void combineBicubicRows(const float* filter, const float* const* filtered_row, int width, float* coefficient_row);
+
+	//tricubic B-spline interpolation at n locations (x[i], y[i], z[i]) using the prefiltered volume stored
+	//continuously in the order of z, y, x, value[i] is set as -1 if the 4x4x4 neighborhood is out of the volume
+	void interpolateTricubic(const float* coefficient, int dim_x, int dim_y, int dim_z,
+		const float* x, const float* y, const float* z, float* value, int n);
+
+}//namespace opencorr
+
+#endif //_SIMD_H_
@@ -16,14 +16,36 @@
 
 namespace opencorr
 {
-	NearestNeighbor* Strain::getInstance(int tid)
+	NearestNeighbor* Strain::getInstance()
 	{
-		if (tid >= (int)instance_pool.size())
+		NearestNeighbor* instance = instance_pool.acquire();
+		if (instance == nullptr)
 		{
-			throw std::string("CPU thread ID over limit");
+			instance = new NearestNeighbor();
+			prepareInstance(instance);
+			instance_pool.add(instance);
 		}
 
-		return instance_pool[tid];
+		return instance;
+	}
+
+	void Strain::prepareInstance(NearestNeighbor* instance)
+	{
+		instance->assignPoints(pt_queue);
+		instance->setSearchRadius(subregion_radius);
+		instance->setSearchK(min_neighbor_num);
+		instance->constructKdTree();
+	}
+
+	void Strain::prepareInstances()
+	{
+		std::vector<NearestNeighbor*>& instance_queue = instance_pool.getWorkspaces();
+		int instance_number = (int)instance_queue.size();
+#pragma omp parallel for
+		for (int i = 0; i < instance_number; i++)
+		{
+			prepareInstance(instance_queue[i]);
+		}
 	}
 
 	Strain::Strain(float subregion_radius, int min_neighbor_num, int thread_number)
@@ -39,13 +61,13 @@ namespace opencorr
 		for (int i = 0; i < thread_number; i++)
 		{
 			NearestNeighbor* instance = new NearestNeighbor();
-			instance_pool.push_back(instance);
+			instance_pool.addFree(instance);
 		}
 	}
 
 	Strain::~Strain()
 	{
-		for (auto& instance : instance_pool)
+		for (auto& instance : instance_pool.getWorkspaces())
 		{
 			delete instance;
 		}
@@ -95,51 +117,36 @@ namespace opencorr
 	void Strain::prepare(std::vector<POI2D>& poi_queue)
 	{
 		int queue_size = (int)poi_queue.size();
-		std::vector<Point2D> pt_queue;
 		pt_queue.resize(queue_size);
 #pragma omp parallel for
 		for (int i = 0; i < queue_size; i++)
 		{
 			pt_queue[i].x = poi_queue[i].x;
 			pt_queue[i].y = poi_queue[i].y;
+			pt_queue[i].z = 0.f;
 		}
 
-#pragma omp parallel for
-		for (int i = 0; i < thread_number; i++)
-		{
-			instance_pool[i]->assignPoints(pt_queue);
-			instance_pool[i]->setSearchRadius(subregion_radius);
-			instance_pool[i]->setSearchK(min_neighbor_num);
-			instance_pool[i]->constructKdTree();
-		}
+		prepareInstances();
 	}
 
 	void Strain::prepare(std::vector<POI2DS>& poi_queue)
 	{
 		int queue_size = (int)poi_queue.size();
-		std::vector<Point2D> pt_queue;
 		pt_queue.resize(queue_size);
 #pragma omp parallel for
 		for (int i = 0; i < queue_size; i++)
 		{
 			pt_queue[i].x = poi_queue[i].x;
 			pt_queue[i].y = poi_queue[i].y;
+			pt_queue[i].z = 0.f;
 		}
 
-#pragma omp parallel for
-		for (int i = 0; i < thread_number; i++)
-		{
-			instance_pool[i]->assignPoints(pt_queue);
-			instance_pool[i]->setSearchRadius(subregion_radius);
-			instance_pool[i]->setSearchK(min_neighbor_num);
-			instance_pool[i]->constructKdTree();
-		}
+		prepareInstances();
 	}
 
 	void Strain::prepare(std::vector<POI3D>& poi_queue)
 	{
 		int queue_size = (int)poi_queue.size();
-		std::vector<Point3D> pt_queue;
 		pt_queue.resize(queue_size);
 #pragma omp parallel for
 		for (int i = 0; i < queue_size; i++)
@@ -149,20 +156,13 @@ namespace opencorr
 			pt_queue[i].z = poi_queue[i].z;
 		}
 
-#pragma omp parallel for
-		for (int i = 0; i < thread_number; i++)
-		{
-			instance_pool[i]->assignPoints(pt_queue);
-			instance_pool[i]->setSearchRadius(subregion_radius);
-			instance_pool[i]->setSearchK(min_neighbor_num);
-			instance_pool[i]->constructKdTree();
-		}
+		prepareInstances();
 	}
 
 	void Strain::compute(POI2D* poi, std::vector<POI2D>& poi_queue)
 	{
-		//get instance of NearestNeighbor according to thread id
-		NearestNeighbor* neighbor_search = getInstance(omp_get_thread_num());
+		//get a free instance of NearestNeighbor from pool
+		NearestNeighbor* neighbor_search = getInstance();
 
 		//3D point for approximation of nearest neighbors
 		Point3D current_point(poi->x, poi->y, 0.f);
@@ -273,6 +273,9 @@ namespace opencorr
 			poi->strain.eyy = vy + 0.5f * (uy * uy + vy * vy);
 			poi->strain.exy = 0.5f * (uy + vx + uy * ux + vy * vx);
 		}
+
+		//return the instance to pool
+		instance_pool.release(neighbor_search);
 	}
 
 	void Strain::compute(std::vector<POI2D>& poi_queue)
@@ -287,8 +290,8 @@ namespace opencorr
 
 	void Strain::compute(POI2DS* poi, std::vector<POI2DS>& poi_queue)
 	{
-		//get instance of NearestNeighbor according to thread id
-		NearestNeighbor* neighbor_search = getInstance(omp_get_thread_num());
+		//get a free instance of NearestNeighbor from pool
+		NearestNeighbor* neighbor_search = getInstance();
 
 		//3D point for approximation of nearest neighbors
 		Point3D current_point(poi->x, poi->y, 0.f);
@@ -420,6 +423,9 @@ namespace opencorr
 			poi->strain.eyz = 0.5f * (vz + wy + uz * uy + vz * vy + wz * wy);
 			poi->strain.ezx = 0.5f * (wx + uz + ux * uz + vx * vz + wx * wz);
 		}
+
+		//return the instance to pool
+		instance_pool.release(neighbor_search);
 	}
 
 	void Strain::compute(std::vector<POI2DS>& poi_queue)
@@ -434,8 +440,8 @@ namespace opencorr
 
 	void Strain::compute(POI3D* poi, std::vector<POI3D>& poi_queue)
 	{
-		//get instance of NearestNeighbor according to thread id
-		NearestNeighbor* neighbor_search = getInstance(omp_get_thread_num());
+		//get a free instance of NearestNeighbor from pool
+		NearestNeighbor* neighbor_search = getInstance();
 
 		//3D point for approximation of nearest neighbors
 		Point3D current_point(poi->x, poi->y, poi->z);
@@ -560,6 +566,9 @@ namespace opencorr
 			poi->strain.eyz = 0.5f * (vz + wy + uz * uy + vz * vy + wz * wy);
 			poi->strain.ezx = 0.5f * (wx + uz + ux * uz + vx * vz + wx * wz);
 		}
+
+		//return the instance to pool
+		instance_pool.release(neighbor_search);
 	}
 
 	void Strain::compute(std::vector<POI3D>& poi_queue)
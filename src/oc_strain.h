@@ -21,6 +21,7 @@
 #include "oc_nearest_neighbor.h"
 #include "oc_poi.h"
 #include "oc_point.h"
+#include "oc_workspace.h"
 
 namespace opencorr
 {
@@ -34,8 +35,11 @@ namespace opencorr
 	class Strain
 	{
 	private:
-		std::vector<NearestNeighbor*> instance_pool;
-		NearestNeighbor* getInstance(int tid);
+		WorkspacePool<NearestNeighbor> instance_pool; //pool of instances for concurrent processing
+		NearestNeighbor* getInstance(); //get a free instance, a new one is allocated if none is free
+		std::vector<Point3D> pt_queue; //locations of POIs to build the kd-tree
+		void prepareInstance(NearestNeighbor* instance);
+		void prepareInstances(); //build the kd-tree in all the instances
 
 	protected:
 		float subregion_radius; //radius of subregion
@@ -12,6 +12,8 @@
  * More information about OpenCorr can be found at https://www.opencorr.org/
  */
 
+#include <algorithm>
+
 #include "oc_subset.h"
 
 namespace opencorr
@@ -30,7 +32,7 @@ namespace opencorr
 		width = radius_x * 2 + 1;
 		height = radius_y * 2 + 1;
 
-		eg_mat = Eigen::MatrixXf::Zero(height, width);
+		eg_mat = RowMatrixXf::Zero(height, width);
 	}
 
 	void Subset2D::fill(Image2D* image)
@@ -84,49 +86,47 @@ namespace opencorr
 	void Subset3D::fill(Image3D* image)
 	{
 		Point3D start_point(center.x - radius_x, center.y - radius_y, center.z - radius_z);
+
+		//copy the subset row by row from the image
+		VolumeView img_view = image->getView().subVolume((int)start_point.x, (int)start_point.y, (int)start_point.z, dim_x, dim_y, dim_z);
+		VolumeView subset_view = getView();
 		for (int i = 0; i < dim_z; i++)
 		{
 			for (int j = 0; j < dim_y; j++)
 			{
-				for (int k = 0; k < dim_x; k++)
-				{
-					vol_mat[i][j][k] = image->vol_mat[int(start_point.z + i)][int(start_point.y + j)][int(start_point.x + k)];
-				}
+				std::copy(img_view.row(i, j), img_view.row(i, j) + dim_x, subset_view.row(i, j));
 			}
 		}
 	}
 
 	float Subset3D::zeroMeanNorm()
 	{
+		//the subset is stored continuously
+		float* subset_data = vol_mat[0][0];
+		int subset_size = dim_x * dim_y * dim_z;
+
 		//calculate the mean of gray-scale values
 		float mean_value = 0;
-		for (int i = 0; i < dim_z; i++)
+		for (int i = 0; i < subset_size; i++)
 		{
-			for (int j = 0; j < dim_y; j++)
-			{
-				for (int k = 0; k < dim_x; k++)
-				{
-					mean_value += vol_mat[i][j][k];
-				}
-			}
+			mean_value += subset_data[i];
 		}
-		mean_value /= (dim_x * dim_y * dim_z);
+		mean_value /= subset_size;
 
 		//make the distribution of gray-scale values zero-mean
 		float subset_sum = 0;
-		for (int i = 0; i < dim_z; i++)
+		for (int i = 0; i < subset_size; i++)
 		{
-			for (int j = 0; j < dim_y; j++)
-			{
-				for (int k = 0; k < dim_x; k++)
-				{
-					vol_mat[i][j][k] -= mean_value;
-					subset_sum += (vol_mat[i][j][k] * vol_mat[i][j][k]);
-				}
-			}
+			subset_data[i] -= mean_value;
+			subset_sum += (subset_data[i] * subset_data[i]);
 		}
 
 		return sqrt(subset_sum);
 	}
 
+	VolumeView Subset3D::getView() const
+	{
+		return VolumeView(vol_mat[0][0], dim_x, dim_y, dim_z);
+	}
+
 }//namespace opencorr
\ No newline at end of file
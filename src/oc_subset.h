@@ -30,7 +30,7 @@ namespace opencorr
 		int radius_x, radius_y;
 		int height, width;
 
-		Eigen::MatrixXf eg_mat;
+		RowMatrixXf eg_mat;
 
 		Subset2D(Point2D center, int radius_x, int radius_y);
 		~Subset2D() = default;
@@ -53,6 +53,8 @@ namespace opencorr
 
 		void fill(Image3D* image);
 		float zeroMeanNorm();
+
+		VolumeView getView() const; //view of vol_mat
 	};
 
 }//namespace opencorr
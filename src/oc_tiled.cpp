@@ -0,0 +1,336 @@
+/*
+ * This file is part of OpenCorr, an open source C++ library for
+ * study and development of 2D, 3D/stereo and volumetric
+ * digital image correlation.
+ *
+ * Copyright (C) 2021, Zhenyu Jiang <zhenyujiang@scut.edu.cn>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one from http://mozilla.org/MPL/2.0/.
+ *
+ * More information about OpenCorr can be found at https://www.opencorr.org/
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <omp.h>
+
+#include "oc_tiled.h"
+
+namespace opencorr
+{
+	//voxels around a subset within which the B-spline prefilter (15 taps) and the interpolation (4 taps) give
+	//the same results as in the whole volume
+	const int TILE_HALO = 9;
+
+	TiledDVC::TiledDVC(DVC* engine, int thread_number)
+	{
+		engine_queue.push_back(engine);
+		tile_ref_queue.push_back(nullptr);
+		tile_tar_queue.push_back(nullptr);
+		this->thread_number = thread_number;
+		memory_budget = 0;
+		voxel_bytes = 7 * sizeof(float); //ref and tar images, three gradient maps, B-spline coefficients and buffer
+		margin = 4;
+		tile_size = 0;
+	}
+
+	TiledDVC::~TiledDVC()
+	{
+		for (int i = 0; i < (int)engine_queue.size(); i++)
+		{
+			delete tile_ref_queue[i];
+			delete tile_tar_queue[i];
+		}
+	}
+
+	void TiledDVC::setImages(Image3D& ref_img, Image3D& tar_img)
+	{
+		this->ref_img = &ref_img;
+		this->tar_img = &tar_img;
+	}
+
+	void TiledDVC::addEngine(DVC* engine)
+	{
+		engine_queue.push_back(engine);
+		tile_ref_queue.push_back(nullptr);
+		tile_tar_queue.push_back(nullptr);
+	}
+
+	void TiledDVC::setMemoryBudget(size_t memory_budget)
+	{
+		this->memory_budget = memory_budget;
+	}
+
+	void TiledDVC::setVoxelBytes(size_t voxel_bytes)
+	{
+		this->voxel_bytes = voxel_bytes > 0 ? voxel_bytes : 1;
+	}
+
+	void TiledDVC::setMargin(int margin)
+	{
+		this->margin = margin > 0 ? margin : 0;
+	}
+
+	void TiledDVC::setTileSize(int tile_size)
+	{
+		this->tile_size = tile_size > 0 ? tile_size : 0;
+	}
+
+	int TiledDVC::getTileSize(std::vector<POI3D>& poi_queue)
+	{
+		if (tile_size > 0 || memory_budget == 0)
+		{
+			return tile_size;
+		}
+
+		//the largest subset and displacement determine the halo of tile region
+		int max_radius = 0;
+		for (auto engine : engine_queue)
+		{
+			max_radius = std::max(max_radius, std::max(engine->subset_radius_x, std::max(engine->subset_radius_y, engine->subset_radius_z)));
+		}
+
+		float max_displacement = 0;
+		for (auto& poi : poi_queue)
+		{
+			float displacement = std::max(fabs(poi.deformation.u), std::max(fabs(poi.deformation.v), fabs(poi.deformation.w)));
+			if (!std::isnan(displacement))
+			{
+				max_displacement = std::max(max_displacement, displacement);
+			}
+		}
+
+		//each engine holds the sub-volume of one tile, which is regarded as a cube
+		size_t tile_budget = memory_budget / engine_queue.size();
+		int edge_length = (int)std::cbrt((double)tile_budget / voxel_bytes);
+		int region_size = edge_length - 2 * (max_radius + margin + TILE_HALO) - (int)std::ceil(max_displacement);
+		if (region_size < 1)
+		{
+			std::cerr << "Memory budget is too small for the subsets: " << memory_budget << " bytes" << std::endl;
+			region_size = 1;
+		}
+
+		return region_size;
+	}
+
+	void TiledDVC::createTiles(std::vector<POI3D>& poi_queue, std::vector<VolumeTile>& tile_queue)
+	{
+		tile_queue.clear();
+		int queue_length = (int)poi_queue.size();
+		if (queue_length == 0)
+		{
+			return;
+		}
+
+		//group the POIs according to their location in the grid of tiles, the key is ordered by z, y and then x
+		int region_size = getTileSize(poi_queue);
+		float min_x = poi_queue[0].x, min_y = poi_queue[0].y, min_z = poi_queue[0].z;
+		for (int i = 1; i < queue_length; i++)
+		{
+			min_x = std::min(min_x, poi_queue[i].x);
+			min_y = std::min(min_y, poi_queue[i].y);
+			min_z = std::min(min_z, poi_queue[i].z);
+		}
+
+		std::map<long long, std::vector<int>> cell_map;
+		for (int i = 0; i < queue_length; i++)
+		{
+			long long cell_x = 0, cell_y = 0, cell_z = 0;
+			if (region_size > 0)
+			{
+				cell_x = (long long)((poi_queue[i].x - min_x) / region_size);
+				cell_y = (long long)((poi_queue[i].y - min_y) / region_size);
+				cell_z = (long long)((poi_queue[i].z - min_z) / region_size);
+			}
+			cell_map[(cell_z << 42) | (cell_y << 21) | cell_x].push_back(i);
+		}
+
+		int radius_x = 0, radius_y = 0, radius_z = 0;
+		for (auto engine : engine_queue)
+		{
+			radius_x = std::max(radius_x, engine->subset_radius_x);
+			radius_y = std::max(radius_y, engine->subset_radius_y);
+			radius_z = std::max(radius_z, engine->subset_radius_z);
+		}
+		int halo = margin + TILE_HALO;
+
+		//the sub-volume covers the subsets in reference image and the ones displaced by initial guess in target image
+		for (auto& cell : cell_map)
+		{
+			int x_min = INT_MAX, y_min = INT_MAX, z_min = INT_MAX;
+			int x_max = INT_MIN, y_max = INT_MIN, z_max = INT_MIN;
+			for (int idx : cell.second)
+			{
+				POI3D& poi = poi_queue[idx];
+				float u = std::isnan(poi.deformation.u) ? 0.f : poi.deformation.u;
+				float v = std::isnan(poi.deformation.v) ? 0.f : poi.deformation.v;
+				float w = std::isnan(poi.deformation.w) ? 0.f : poi.deformation.w;
+
+				x_min = std::min(x_min, (int)std::floor(std::min(poi.x, poi.x + u)) - radius_x - halo);
+				y_min = std::min(y_min, (int)std::floor(std::min(poi.y, poi.y + v)) - radius_y - halo);
+				z_min = std::min(z_min, (int)std::floor(std::min(poi.z, poi.z + w)) - radius_z - halo);
+				x_max = std::max(x_max, (int)std::ceil(std::max(poi.x, poi.x + u)) + radius_x + halo);
+				y_max = std::max(y_max, (int)std::ceil(std::max(poi.y, poi.y + v)) + radius_y + halo);
+				z_max = std::max(z_max, (int)std::ceil(std::max(poi.z, poi.z + w)) + radius_z + halo);
+			}
+
+			//keep the sub-volume inside the volume, the POIs out of volume fail in engine as usual
+			x_min = std::min(std::max(x_min, 0), ref_img->dim_x - 1);
+			y_min = std::min(std::max(y_min, 0), ref_img->dim_y - 1);
+			z_min = std::min(std::max(z_min, 0), ref_img->dim_z - 1);
+			x_max = std::max(std::min(x_max, ref_img->dim_x - 1), x_min);
+			y_max = std::max(std::min(y_max, ref_img->dim_y - 1), y_min);
+			z_max = std::max(std::min(z_max, ref_img->dim_z - 1), z_min);
+
+			VolumeTile tile;
+			tile.x = x_min;
+			tile.y = y_min;
+			tile.z = z_min;
+			tile.dim_x = x_max - x_min + 1;
+			tile.dim_y = y_max - y_min + 1;
+			tile.dim_z = z_max - z_min + 1;
+			tile.poi_index = cell.second;
+			tile_queue.push_back(tile);
+		}
+	}
+
+	void TiledDVC::processTile(int engine_idx, VolumeTile& tile, std::vector<POI3D>& poi_queue)
+	{
+		//the sub-volumes of last tile are released only here, as the engine keeps pointing to them until it is re-bound
+		DVC* engine = engine_queue[engine_idx];
+		delete tile_ref_queue[engine_idx];
+		delete tile_tar_queue[engine_idx];
+		tile_ref_queue[engine_idx] = new Image3D(tile.dim_x, tile.dim_y, tile.dim_z);
+		tile_tar_queue[engine_idx] = new Image3D(tile.dim_x, tile.dim_y, tile.dim_z);
+		Image3D& tile_ref = *tile_ref_queue[engine_idx];
+		Image3D& tile_tar = *tile_tar_queue[engine_idx];
+
+		//crop the sub-volumes, only the pages covering the tile are read if the images are memory-mapped
+		VolumeView ref_view = ref_img->getView().subVolume(tile.x, tile.y, tile.z, tile.dim_x, tile.dim_y, tile.dim_z);
+		VolumeView tar_view = tar_img->getView().subVolume(tile.x, tile.y, tile.z, tile.dim_x, tile.dim_y, tile.dim_z);
+		VolumeView tile_ref_view = tile_ref.getView();
+		VolumeView tile_tar_view = tile_tar.getView();
+
+#pragma omp parallel for
+		for (int i = 0; i < tile.dim_z; i++)
+		{
+			for (int j = 0; j < tile.dim_y; j++)
+			{
+				std::copy(ref_view.row(i, j), ref_view.row(i, j) + tile.dim_x, tile_ref_view.row(i, j));
+				std::copy(tar_view.row(i, j), tar_view.row(i, j) + tile.dim_x, tile_tar_view.row(i, j));
+			}
+		}
+
+		//the POIs are located in the coordinate system of tile, while their displacements remain the same
+		int tile_poi_number = (int)tile.poi_index.size();
+		std::vector<POI3D> tile_poi_queue;
+		tile_poi_queue.reserve(tile_poi_number);
+		for (int i = 0; i < tile_poi_number; i++)
+		{
+			POI3D tile_poi = poi_queue[tile.poi_index[i]];
+			tile_poi.x -= tile.x;
+			tile_poi.y -= tile.y;
+			tile_poi.z -= tile.z;
+			tile_poi_queue.push_back(tile_poi);
+		}
+
+		engine->setImages(tile_ref, tile_tar);
+		engine->prepare();
+		engine->compute(tile_poi_queue);
+
+		//scatter the results back to the queue of caller
+		for (int i = 0; i < tile_poi_number; i++)
+		{
+			POI3D& poi = poi_queue[tile.poi_index[i]];
+			poi.deformation = tile_poi_queue[i].deformation;
+			poi.result = tile_poi_queue[i].result;
+		}
+	}
+
+	void TiledDVC::compute(std::vector<POI3D>& poi_queue)
+	{
+		if (ref_img == nullptr || tar_img == nullptr)
+		{
+			std::cerr << "Images are not set for tiled DVC" << std::endl;
+			return;
+		}
+
+		if (ref_img->dim_x != tar_img->dim_x || ref_img->dim_y != tar_img->dim_y || ref_img->dim_z != tar_img->dim_z)
+		{
+			std::cerr << "Reference and target images are of different dimensions" << std::endl;
+			return;
+		}
+
+		std::vector<VolumeTile> tile_queue;
+		createTiles(poi_queue, tile_queue);
+		int tile_number = (int)tile_queue.size();
+
+		//the slices before the first slice of unfinished tiles are no longer needed,
+		//their pages are dropped if the images are memory-mapped
+		std::vector<int> start_z(tile_number + 1, ref_img->dim_z);
+		for (int i = tile_number - 1; i >= 0; i--)
+		{
+			start_z[i] = std::min(start_z[i + 1], tile_queue[i].z);
+		}
+
+		std::vector<bool> tile_done(tile_number, false);
+		int finished_tile = 0; //the tiles before it are all finished
+		int released_z = 0;
+		std::mutex tile_mutex;
+		std::atomic<int> next_tile(0);
+
+		auto process = [&](int engine_idx)
+		{
+			int tile_idx;
+			while ((tile_idx = next_tile++) < tile_number)
+			{
+				processTile(engine_idx, tile_queue[tile_idx], poi_queue);
+
+				std::lock_guard<std::mutex> lock(tile_mutex);
+				tile_done[tile_idx] = true;
+				while (finished_tile < tile_number && tile_done[finished_tile])
+				{
+					finished_tile++;
+				}
+				if (start_z[finished_tile] > released_z)
+				{
+					ref_img->releaseSlab(released_z, start_z[finished_tile] - released_z);
+					tar_img->releaseSlab(released_z, start_z[finished_tile] - released_z);
+					released_z = start_z[finished_tile];
+				}
+			}
+		};
+
+		int engine_number = (int)engine_queue.size();
+		if (engine_number == 1)
+		{
+			process(0);
+			return;
+		}
+
+		//the OpenMP threads are shared by the engines working concurrently
+		int engine_thread_number = std::max(1, thread_number / engine_number);
+		std::vector<std::thread> worker_queue;
+		for (int i = 0; i < engine_number; i++)
+		{
+			worker_queue.push_back(std::thread([&, i]()
+				{
+					omp_set_num_threads(engine_thread_number);
+					process(i);
+				}));
+		}
+		for (auto& worker : worker_queue)
+		{
+			worker.join();
+		}
+	}
+
+}//namespace opencorr
\ No newline at end of file
@@ -0,0 +1,83 @@
+/*
+ * This file is part of OpenCorr, an open source C++ library for
+ * study and development of 2D, 3D/stereo and volumetric
+ * digital image correlation.
+ *
+ * Copyright (C) 2021, Zhenyu Jiang <zhenyujiang@scut.edu.cn>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one from http://mozilla.org/MPL/2.0/.
+ *
+ * More information about OpenCorr can be found at https://www.opencorr.org/
+ */
+
+#pragma once
+
+#ifndef _TILED_H_
+#define _TILED_H_
+
+#include <vector>
+
+#include "oc_array.h"
+#include "oc_dic.h"
+#include "oc_image.h"
+#include "oc_poi.h"
+
+namespace opencorr
+{
+	//sub-volume cropped from the reference and target images, covering a group of POIs with a halo
+	struct VolumeTile
+	{
+		int x, y, z; //origin of the sub-volume in the whole volume
+		int dim_x, dim_y, dim_z;
+		std::vector<int> poi_index; //indices of the POIs in the queue of caller
+	};
+
+	//driver of DVC processing the POIs tile by tile. an engine (e.g. ICGN3D1) is prepared only for the sub-volume
+	//of a tile, thus the peak memory scales with the size of tile rather than the size of volume. the tiles are
+	//processed concurrently if more than one engine is added, each engine handles one tile at a time. the engines
+	//are re-bound to the sub-volumes of each tile, which are kept until the next tile or the destruction of TiledDVC,
+	//thus setImages() and prepare() of an engine shall be called again before it is used outside TiledDVC
+	class TiledDVC
+	{
+	protected:
+		Image3D* ref_img = nullptr;
+		Image3D* tar_img = nullptr;
+
+		std::vector<DVC*> engine_queue; //engines processing the tiles
+		std::vector<Image3D*> tile_ref_queue; //sub-volumes of ref image currently bound to the engines
+		std::vector<Image3D*> tile_tar_queue; //sub-volumes of tar image currently bound to the engines
+		int thread_number; //OpenMP thread number shared by the engines
+		size_t memory_budget; //memory in bytes for all the tiles in processing, 0 for no limit
+		size_t voxel_bytes; //memory consumed by an engine per voxel of tile
+		int margin; //voxels added around the subsets to cover the change of deformation during iteration
+		int tile_size; //edge length of the region of POIs in a tile, determined by memory budget if it is 0
+
+		//determine the edge length of tile region according to memory budget
+		int getTileSize(std::vector<POI3D>& poi_queue);
+
+		//group the POIs into tiles and determine the sub-volume of each tile, the tiles are sorted along z-axis
+		void createTiles(std::vector<POI3D>& poi_queue, std::vector<VolumeTile>& tile_queue);
+
+		//crop the sub-volumes of a tile, prepare the engine and process the POIs in the tile
+		void processTile(int engine_idx, VolumeTile& tile, std::vector<POI3D>& poi_queue);
+
+	public:
+		TiledDVC(DVC* engine, int thread_number);
+		~TiledDVC();
+
+		void setImages(Image3D& ref_img, Image3D& tar_img);
+		void addEngine(DVC* engine); //engines should be created with the same parameters
+		void setMemoryBudget(size_t memory_budget);
+		void setVoxelBytes(size_t voxel_bytes);
+		void setMargin(int margin);
+		void setTileSize(int tile_size);
+
+		//the initial guess of POIs determines the sub-volume of target image in each tile
+		void compute(std::vector<POI3D>& poi_queue);
+	};
+
+}//namespace opencorr
+
+#endif //_TILED_H_
\ No newline at end of file
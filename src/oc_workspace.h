@@ -0,0 +1,156 @@
+/*
+ * This file is part of OpenCorr, an open source C++ library for
+ * study and development of 2D, 3D/stereo and volumetric
+ * digital image correlation.
+ *
+ * Copyright (C) 2021, Zhenyu Jiang <zhenyujiang@scut.edu.cn>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one from http://mozilla.org/MPL/2.0/.
+ *
+ * More information about OpenCorr can be found at https://www.opencorr.org/
+ */
+
+#pragma once
+
+#ifndef _WORKSPACE_H_
+#define _WORKSPACE_H_
+
+#include <mutex>
+#include <vector>
+
+namespace opencorr
+{
+	//pool of workspaces, i.e. the instances holding temporary data of an engine. a caller acquires a free workspace
+	//before processing a POI and releases it afterwards, thus the engine can be driven by OpenMP, std::thread or
+	//any external thread pool. the engine allocates a new workspace and adds it to the pool if none is free,
+	//the number of workspaces therefore grows to the number of concurrent callers at most
+	template <class T>
+	class WorkspacePool
+	{
+	private:
+		std::vector<T*> workspace_queue; //all the workspaces owned by the pool
+		std::vector<T*> free_queue; //workspaces not in use, the most recently released one at the back
+		std::mutex pool_mutex;
+
+	public:
+		WorkspacePool() = default;
+		~WorkspacePool() = default;
+
+		//get the most recently released workspace, return nullptr if no workspace is free
+		T* acquire()
+		{
+			std::lock_guard<std::mutex> lock(pool_mutex);
+			if (free_queue.empty())
+			{
+				return nullptr;
+			}
+
+			T* workspace = free_queue.back();
+			free_queue.pop_back();
+			return workspace;
+		}
+
+		//get a free workspace satisfying the condition, the least recently released one is checked first
+		template <class Condition>
+		T* acquire(Condition condition)
+		{
+			std::lock_guard<std::mutex> lock(pool_mutex);
+			for (auto iter = free_queue.begin(); iter != free_queue.end(); iter++)
+			{
+				if (condition(*iter))
+				{
+					T* workspace = *iter;
+					free_queue.erase(iter);
+					return workspace;
+				}
+			}
+
+			return nullptr;
+		}
+
+		void release(T* workspace)
+		{
+			std::lock_guard<std::mutex> lock(pool_mutex);
+			free_queue.push_back(workspace);
+		}
+
+		//add a new workspace to the pool, it is regarded as in use by the caller
+		void add(T* workspace)
+		{
+			std::lock_guard<std::mutex> lock(pool_mutex);
+			workspace_queue.push_back(workspace);
+		}
+
+		//add a new workspace to the pool as a free one
+		void addFree(T* workspace)
+		{
+			std::lock_guard<std::mutex> lock(pool_mutex);
+			workspace_queue.push_back(workspace);
+			free_queue.push_back(workspace);
+		}
+
+		//create a workspace and add it to the pool as one in use if the pool holds fewer than size_limit workspaces,
+		//return nullptr otherwise. the check and the addition are done under the same lock
+		template <class Create>
+		T* addBelow(int size_limit, Create create)
+		{
+			std::lock_guard<std::mutex> lock(pool_mutex);
+			if ((int)workspace_queue.size() >= size_limit)
+			{
+				return nullptr;
+			}
+
+			T* workspace = create();
+			workspace_queue.push_back(workspace);
+			return workspace;
+		}
+
+		//take the free workspaces out of the pool, the least recently released first, until the pool holds no more
+		//than size_limit workspaces. the removed ones are returned to be deleted by the caller
+		std::vector<T*> removeAbove(int size_limit)
+		{
+			std::lock_guard<std::mutex> lock(pool_mutex);
+			std::vector<T*> removed;
+			while ((int)workspace_queue.size() > size_limit && !free_queue.empty())
+			{
+				T* workspace = free_queue.front();
+				free_queue.erase(free_queue.begin());
+				for (auto iter = workspace_queue.begin(); iter != workspace_queue.end(); iter++)
+				{
+					if (*iter == workspace)
+					{
+						workspace_queue.erase(iter);
+						break;
+					}
+				}
+				removed.push_back(workspace);
+			}
+
+			return removed;
+		}
+
+		int size()
+		{
+			std::lock_guard<std::mutex> lock(pool_mutex);
+			return (int)workspace_queue.size();
+		}
+
+		//all the workspaces, to be used only when no workspace is in use, e.g. in preparation and destruction
+		std::vector<T*>& getWorkspaces()
+		{
+			return workspace_queue;
+		}
+
+		void clear()
+		{
+			std::lock_guard<std::mutex> lock(pool_mutex);
+			workspace_queue.clear();
+			free_queue.clear();
+		}
+	};
+
+}//namespace opencorr
+
+#endif //_WORKSPACE_H_
\ No newline at end of file
@@ -35,9 +35,15 @@
 #include "oc_nr.h"
 #include "oc_poi.h"
 #include "oc_point.h"
+#include "oc_pyramid.h"
+#include "oc_reference_cache.h"
+#include "oc_reliability_guided.h"
+#include "oc_sequence.h"
 #include "oc_sift.h"
+#include "oc_simd.h"
 #include "oc_stereovision.h"
 #include "oc_strain.h"
 #include "oc_subset.h"
+#include "oc_tiled.h"
 
 #endif //_OPENCORR_